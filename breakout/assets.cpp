@@ -0,0 +1,40 @@
+#include "assets.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Defined in the generated embeddedassets.cpp, sorted by path
+extern const EmbeddedAsset EMBEDDED_ASSETS[];
+extern const size_t EMBEDDED_ASSET_COUNT;
+
+const EmbeddedAsset* Assets::Find(const char* path)
+{
+	const EmbeddedAsset* end = EMBEDDED_ASSETS + EMBEDDED_ASSET_COUNT;
+	const EmbeddedAsset* asset = std::lower_bound(EMBEDDED_ASSETS, end, path,
+		[](const EmbeddedAsset& asset, const char* path) { return strcmp(asset.Path, path) < 0; });
+	if (asset == end || strcmp(asset->Path, path) != 0)
+		return nullptr;
+	return asset;
+}
+
+VfsFile Assets::Open(const char* path)
+{
+	const EmbeddedAsset* asset = Find(path);
+	if (asset)
+		return VfsFile(asset->Data, asset->Size);
+	return Vfs::Open(path);
+}
+
+bool Assets::Read(const char* path, std::string& contents)
+{
+	VfsFile file = Open(path);
+	if (!file)
+		return false;
+	contents.assign((const char*)file.Data(), file.Size());
+	return true;
+}
+
+size_t Assets::EmbeddedCount()
+{
+	return EMBEDDED_ASSET_COUNT;
+}
@@ -0,0 +1,40 @@
+#ifndef _assets_HG_
+#define _assets_HG_
+
+#include <vfs/vfs.h>
+
+#include <cstddef>
+#include <string>
+
+// One file compiled into the executable, Data is followed by a terminating 0
+// that isn't counted in Size
+struct EmbeddedAsset
+{
+	const char*				Path;
+	const unsigned char*	Data;
+	size_t					Size;
+};
+
+// Shaders, levels, fonts, textures and particle files are embedded by a pre
+// build step (tools/embed_assets.py writes embeddedassets.cpp). Loaders ask
+// here first and only go to the Vfs (mounted packs, then loose files) for
+// paths that weren't embedded, so startup reads nothing from disk and works
+// from any directory. Editing an asset on disk needs a rebuild to show up.
+class Assets
+{
+public:
+	// Embedded file for a path relative to the game directory ("shaders/vert_text.glsl"),
+	// null if it wasn't embedded
+	static const EmbeddedAsset* Find(const char* path);
+	// A view of the embedded file, or whatever the Vfs finds. Empty if neither has it.
+	static VfsFile Open(const char* path);
+	// Copies what Open finds. False if nothing was found.
+	static bool Read(const char* path, std::string& contents);
+
+	static size_t EmbeddedCount();
+
+private:
+	Assets() {}
+};
+
+#endif
@@ -0,0 +1,250 @@
+#include "autopilot.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+	// How far off the worst player aims, past the paddle's half width it's a miss
+	const GLfloat MAX_AIM_ERROR = 160.0f;
+	// How long the worst player takes to react to a ball turning down
+	const double MAX_REACTION = 0.5;
+	// Close enough to the target to stop, about a frame of paddle movement
+	const GLfloat DEAD_ZONE = 6.0f;
+	// Seconds spent lining up a launch before launching from wherever the paddle is
+	const double LAUNCH_TIMEOUT = 3.0;
+}
+
+Autopilot::Autopilot(Game& game, GLfloat skill, GLfloat noise, uint32_t seed)
+	: m_game(game)
+	, m_skill(std::min(std::max(skill, 0.0f), 1.0f))
+	, m_noise(noise)
+	, m_random(seed ^ 0xA070B110ULL)	// apart from the game's own stream
+	, m_lastState(GAME_MENU)
+	, m_lastLives(0)
+	, m_advanced(false)
+	, m_held{ false, false }
+	, m_levelStart(0.0)
+	, m_givingUp(false)
+	, m_descending(false)
+	, m_aim(0.0f)
+	, m_reactAt(0.0)
+	, m_launching(false)
+	, m_launchAt(0.0f)
+	, m_launchBy(0.0)
+	, m_started(-1.0)
+	, m_played(0)
+	, m_cleared(0)
+	, m_lost(0)
+	, m_givenUp(0)
+	, m_missed(0)
+	, m_visited(game.Levels.size(), false)
+{
+}
+
+void Autopilot::Update(double now)
+{
+	if (m_started < 0.0)
+		m_started = now;
+
+	// How the last frame went for the level being played
+	GameState state = m_game.State;
+	if (m_lastState == GAME_ACTIVE)
+	{
+		if (state == GAME_WIN)
+		{
+			++m_cleared;
+		}
+		else if (state == GAME_MENU)
+		{
+			// Game over puts the lives back, the last ones were all missed
+			m_missed += m_lastLives;
+			if (m_givingUp)
+				++m_givenUp;
+			else
+				++m_lost;
+		}
+		else if (m_game.Lives < m_lastLives)
+		{
+			m_missed += m_lastLives - m_game.Lives;
+		}
+	}
+	m_lastState = state;
+	m_lastLives = m_game.Lives;
+
+	if (state == GAME_ACTIVE)
+	{
+		this->playLevel(now);
+		return;
+	}
+
+	this->setKey(GLFW_KEY_A, m_held[0], false, now);
+	this->setKey(GLFW_KEY_D, m_held[1], false, now);
+	if (state == GAME_WIN)
+		this->tap(GLFW_KEY_ENTER, now);
+	else
+		this->playMenu(now);
+}
+
+void Autopilot::playMenu(double now)
+{
+	// After a level the next one is picked first, a frame before starting it
+	if (m_played > 0 && !m_advanced)
+	{
+		this->tap(GLFW_KEY_W, now);
+		m_advanced = true;
+		return;
+	}
+
+	this->tap(GLFW_KEY_ENTER, now);
+	m_advanced = false;
+	if (m_game.CurrentLevel < m_visited.size())
+		m_visited[m_game.CurrentLevel] = true;
+	++m_played;
+	m_levelStart = now;
+	m_givingUp = false;
+	m_descending = false;
+	m_launching = false;
+}
+
+void Autopilot::playLevel(double now)
+{
+	BoardView view;
+	m_game.View(view);
+	GLfloat width = (GLfloat)m_game.Width;
+	GLfloat halfPaddle = view.PaddleSize.x / 2.0f;
+	GLfloat paddleCenter = view.PaddlePosition.x + halfPaddle;
+
+	if (!m_givingUp && now - m_levelStart > LEVEL_TIME_LIMIT)
+		m_givingUp = true;
+
+	GLfloat landing = 0.0f;
+	bool descending = false;
+	if (!this->predictLanding(view, landing, descending))
+	{
+		if (view.Stuck == 0)
+		{
+			this->steer(paddleCenter, paddleCenter, now);
+			return;
+		}
+		// Every ball is on the paddle: move somewhere random and launch from there
+		if (!m_launching)
+		{
+			m_launching = true;
+			m_launchAt = this->uniform(halfPaddle, width - halfPaddle);
+			m_launchBy = now + LAUNCH_TIMEOUT;
+		}
+		this->steer(m_launchAt, paddleCenter, now);
+		if (std::fabs(m_launchAt - paddleCenter) <= DEAD_ZONE || now >= m_launchBy)
+		{
+			this->tap(GLFW_KEY_SPACE, now);
+			m_launching = false;
+		}
+		return;
+	}
+	m_launching = false;
+
+	// A ball caught by a sticky paddle goes straight back up
+	if (view.Stuck > 0)
+		this->tap(GLFW_KEY_SPACE, now);
+
+	// A new return: draw where on the paddle to take it and how late to react
+	if (descending && !m_descending)
+	{
+		GLfloat error = (1.0f - m_skill) * this->uniform(-MAX_AIM_ERROR, MAX_AIM_ERROR);
+		m_aim = this->uniform(-m_noise, m_noise) + error;
+		m_reactAt = now + (1.0 - m_skill) * MAX_REACTION;
+	}
+	m_descending = descending;
+
+	GLfloat target = landing + m_aim;
+	if (m_givingUp)
+		target = landing < width / 2.0f ? width : 0.0f;
+	else if (m_descending && now < m_reactAt)
+		target = paddleCenter;
+	target = std::min(std::max(target, halfPaddle), width - halfPaddle);
+	this->steer(target, paddleCenter, now);
+}
+
+bool Autopilot::predictLanding(const BoardView& view, GLfloat& landing, bool& descending) const
+{
+	// Where the ball's top reaches the paddle's top, its left edge stays in [0, span]
+	GLfloat diameter = BALL_RADIUS * 2.0f;
+	GLfloat landingY = view.PaddlePosition.y - diameter;
+	GLfloat span = (GLfloat)m_game.Width - diameter;
+	GLuint balls = std::min(view.Balls, BoardView::MAX_BALLS);
+
+	bool found = false;
+	GLfloat soonest = 0.0f;
+	for (GLuint i = 0; i < balls; ++i)
+	{
+		glm::vec2 position = view.BallPositions[i];
+		glm::vec2 velocity = view.BallVelocities[i];
+		GLfloat time;
+		if (velocity.y > 0.0f)
+			time = (landingY - position.y) / velocity.y;
+		else if (velocity.y < 0.0f)
+			time = (position.y + landingY) / -velocity.y;	// up to the top and back down, bricks aside
+		else
+			continue;
+		// Already past the paddle
+		if (time < 0.0f || (found && time >= soonest))
+			continue;
+
+		// Unfold the side wall bounces: the path repeats every two spans
+		GLfloat x = position.x + velocity.x * time;
+		if (span > 0.0f)
+		{
+			x = std::fmod(x, 2.0f * span);
+			if (x < 0.0f)
+				x += 2.0f * span;
+			if (x > span)
+				x = 2.0f * span - x;
+		}
+		found = true;
+		soonest = time;
+		landing = x + BALL_RADIUS;
+		descending = velocity.y > 0.0f;
+	}
+	return found;
+}
+
+void Autopilot::steer(GLfloat target, GLfloat paddleCenter, double now)
+{
+	GLfloat offset = target - paddleCenter;
+	this->setKey(GLFW_KEY_A, m_held[0], offset < -DEAD_ZONE, now);
+	this->setKey(GLFW_KEY_D, m_held[1], offset > DEAD_ZONE, now);
+}
+
+void Autopilot::setKey(int key, bool& held, bool down, double now)
+{
+	if (held == down)
+		return;
+	held = down;
+	m_game.Input.Push(InputEvent{ now, key, down ? GLFW_PRESS : GLFW_RELEASE });
+}
+
+void Autopilot::tap(int key, double now)
+{
+	m_game.Input.Push(InputEvent{ now, key, GLFW_PRESS });
+	m_game.Input.Push(InputEvent{ now, key, GLFW_RELEASE });
+}
+
+GLfloat Autopilot::uniform(GLfloat low, GLfloat high)
+{
+	return low + (high - low) * (GLfloat)(m_random.Next() / 4294967296.0);
+}
+
+void Autopilot::Report() const
+{
+	GLuint visited = (GLuint)std::count(m_visited.begin(), m_visited.end(), true);
+	char line[256];
+	snprintf(line, sizeof(line), "AUTOPILOT: %u levels played (%u of %zu visited) in %.0f s, %u cleared, %u lost, %u given up, %u balls missed\n",
+		m_played, visited, m_visited.size(), m_started < 0.0 ? 0.0 : GameTime() - m_started,
+		m_cleared, m_lost, m_givenUp, m_missed);
+	std::cout << line;
+}
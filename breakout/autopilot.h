@@ -0,0 +1,85 @@
+#ifndef _autopilot_HG_
+#define _autopilot_HG_
+
+#include <glad/glad.h>
+
+#include "game.h"
+#include "random.h"
+
+#include <vector>
+
+// Plays single player on its own for unattended soak and performance runs.
+// It presses and releases A, D, SPACE, ENTER and W like a player would,
+// pushing the events into Game::Input, so the paddle moves through the same
+// ProcessInput path as the keyboard and --record-input records the run.
+//
+// Every frame it works out where the next ball to come down will reach the
+// paddle, bouncing it off the side walls and the top, and steers under it.
+// Skill 1 never misses; lower skill reacts later and aims further off, so
+// lives get lost. Besides that every return is aimed at a random spot on the
+// paddle so the ball doesn't settle into a loop. Decisions come from their
+// own generator seeded from --seed, the same run plays the same way.
+//
+// When a level is cleared or lost it presses W on the menu and starts the
+// next one, going round all levels. A level that takes longer than
+// LEVEL_TIME_LIMIT is given up: the paddle keeps out of the ball's way
+// until the lives run out.
+class Autopilot
+{
+public:
+	// Seconds of play before a level is given up
+	static constexpr double LEVEL_TIME_LIMIT = 300.0;
+
+	// skill 0 to 1, noise is the random aim offset in pixels either side of the paddle's centre
+	Autopilot(Game& game, GLfloat skill, GLfloat noise, uint32_t seed);
+
+	// Pushes this frame's key presses and releases, stamped now (GameTime).
+	// Call before Game::ProcessInput.
+	void Update(double now);
+	void Report() const;
+
+	Autopilot(const Autopilot&) = delete;
+	Autopilot& operator=(const Autopilot&) = delete;
+
+private:
+	Game&			m_game;
+	GLfloat			m_skill;
+	GLfloat			m_noise;
+	Random			m_random;
+
+	GameState		m_lastState;
+	GLuint			m_lastLives;
+	bool			m_advanced;			// W pressed on this menu, ENTER is next
+	bool			m_held[2];			// A and D as last pushed
+	double			m_levelStart;
+	bool			m_givingUp;
+
+	// The return being played: aim and reaction are drawn when a ball turns down
+	bool			m_descending;
+	GLfloat			m_aim;				// added to the predicted landing point
+	double			m_reactAt;			// the paddle waits until then
+	bool			m_launching;		// moving to m_launchAt before launching
+	GLfloat			m_launchAt;
+	double			m_launchBy;
+
+	// Totals for Report
+	double			m_started;
+	GLuint			m_played;
+	GLuint			m_cleared;
+	GLuint			m_lost;
+	GLuint			m_givenUp;
+	GLuint			m_missed;
+	std::vector<bool>	m_visited;		// per level
+
+	void playMenu(double now);
+	void playLevel(double now);
+	// Centre x of the ball that reaches the paddle's height first, false when none is moving
+	bool predictLanding(const BoardView& view, GLfloat& landing, bool& descending) const;
+	// Holds A or D towards target, releasing both once the paddle is there
+	void steer(GLfloat target, GLfloat paddleCenter, double now);
+	void setKey(int key, bool& held, bool down, double now);
+	void tap(int key, double now);
+	GLfloat uniform(GLfloat low, GLfloat high);
+};
+
+#endif
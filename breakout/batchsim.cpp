@@ -0,0 +1,571 @@
+#include "batchsim.h"
+
+#include "game.h"
+#include "options.h"
+#include "random.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef BATCHSIM_SSE2
+	#include <emmintrin.h>
+#endif
+
+#include <trace/trace.h>
+
+// Game's collision test, the scalar path uses it as it is
+Collision CheckCollision(const Transform& ball, GLfloat radius, const Transform& box);
+
+namespace
+{
+	const GLfloat BATCH_TICK = 1.0f / 60.0f;
+	// Boards the scalar reference steps, its speed is per board anyway
+	const GLuint REFERENCE_BOARDS = 256;
+	// The benchmark bot stops chasing once the ball is this close to where it aims
+	const GLfloat TRACK_DEAD_ZONE = 5.0f;
+	// Boards aim different parts of the paddle at the ball, from this far
+	// left of the middle to as far right. Past the ends they miss, so lives
+	// are lost and episodes end.
+	const GLfloat TRACK_SPREAD = 70.0f;
+	const GLuint TRACK_AIMS = 15;
+
+	typedef std::chrono::steady_clock Clock;
+
+	uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+#ifdef BATCHSIM_SSE2
+	// a where mask is set, b elsewhere
+	inline __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	// Sign bit flips, exactly what the scalar unary minus and std::abs do
+	inline __m128 negate(__m128 value)
+	{
+		return _mm_xor_ps(value, _mm_set1_ps(-0.0f));
+	}
+	inline __m128 absolute(__m128 value)
+	{
+		return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+	}
+	// glm::clamp is min(max(x, low), high) with std::max's order, the
+	// operands are swapped to match it when they're equal
+	inline __m128 clamp(__m128 value, __m128 low, __m128 high)
+	{
+		return _mm_min_ps(high, _mm_max_ps(low, value));
+	}
+	inline __m128 mask(__m128i value)
+	{
+		return _mm_castsi128_ps(value);
+	}
+#endif
+}
+
+BatchSim::BatchSim(const GameLevel& level, GLuint boards, GLuint width, GLuint height, GLuint threads, uint32_t seed, bool simd)
+	: m_boards((boards + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES)
+	, m_width((GLfloat)width)
+	, m_height((GLfloat)height)
+	, m_simd(simd && BATCH_LANES > 1)
+	, m_breakable(0)
+	, m_generation(0)
+	, m_pending(0)
+	, m_deltaTime(0.0f)
+	, m_quit(false)
+{
+	// The level is laid out the way Game spawns it, in the top half of the board
+	Registry bricks;
+	level.Spawn(bricks, width, height / 2, false);
+	bricks.Each<Brick, Transform>([&](Entity, Brick& brick, Transform& box)
+	{
+		m_brickBoxes.push_back(box);
+		m_brickSolid.push_back(brick.Solid ? 1 : 0);
+		if (!brick.Solid)
+			++m_breakable;
+	});
+
+	this->Actions.assign(m_boards, 0.0f);
+	m_ballX.resize(m_boards);
+	m_ballY.resize(m_boards);
+	m_velocityX.resize(m_boards);
+	m_velocityY.resize(m_boards);
+	m_paddleX.resize(m_boards);
+	m_alive.resize(m_brickSolid.size() * m_boards);
+	m_lives.resize(m_boards);
+	m_remaining.resize(m_boards);
+	m_episodes.assign(m_boards, 0);
+	m_broken.assign(m_boards, 0);
+
+	// Each board's paddle and first serve come from the seed, in board order
+	Random random(seed);
+	for (GLuint board = 0; board < m_boards; ++board)
+	{
+		this->endEpisode(board);
+		m_episodes[board] = 0;
+		m_paddleX[board] = (float)random.Below((uint32_t)(m_width - PLAYER_SIZE.x));
+		this->resetBall(board);
+		m_velocityX[board] = (float)random.Below(201) - 100.0f;
+	}
+
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, m_boards / BATCH_LANES);
+	for (GLuint worker = 1; worker < threads; ++worker)
+		m_workers.push_back(std::thread(&BatchSim::workerLoop, this, worker - 1));
+}
+
+BatchSim::~BatchSim()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+void BatchSim::Step(GLfloat deltaTime)
+{
+	TRACE_ZONE("BatchSim::Step");
+
+	if (m_workers.empty())
+	{
+		this->stepRange(0, m_boards, deltaTime);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_deltaTime = deltaTime;
+		m_pending = (GLuint)m_workers.size();
+		++m_generation;
+	}
+	m_wake.notify_all();
+
+	GLuint first = 0;
+	GLuint end = 0;
+	this->share(0, first, end);
+	this->stepRange(first, end, deltaTime);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+void BatchSim::TrackBall()
+{
+	for (GLuint board = 0; board < m_boards; ++board)
+	{
+		GLfloat aim = TRACK_SPREAD * (2.0f * (board % TRACK_AIMS) / (TRACK_AIMS - 1) - 1.0f);
+		GLfloat offset = (m_ballX[board] + BALL_RADIUS) - (m_paddleX[board] + PLAYER_SIZE.x / 2 + aim);
+		this->Actions[board] = offset > TRACK_DEAD_ZONE ? 1.0f : (offset < -TRACK_DEAD_ZONE ? -1.0f : 0.0f);
+	}
+}
+
+uint64_t BatchSim::Episodes() const
+{
+	uint64_t total = 0;
+	for (uint32_t episodes : m_episodes)
+		total += episodes;
+	return total;
+}
+
+uint64_t BatchSim::BricksBroken() const
+{
+	uint64_t total = 0;
+	for (uint32_t broken : m_broken)
+		total += broken;
+	return total;
+}
+
+GLuint BatchSim::Compare(const BatchSim& other) const
+{
+	GLuint boards = std::min(m_boards, other.m_boards);
+	GLuint bricks = (GLuint)m_brickSolid.size();
+	GLuint different = 0;
+	for (GLuint board = 0; board < boards; ++board)
+	{
+		bool same = floatBits(m_ballX[board]) == floatBits(other.m_ballX[board])
+			&& floatBits(m_ballY[board]) == floatBits(other.m_ballY[board])
+			&& floatBits(m_velocityX[board]) == floatBits(other.m_velocityX[board])
+			&& floatBits(m_velocityY[board]) == floatBits(other.m_velocityY[board])
+			&& floatBits(m_paddleX[board]) == floatBits(other.m_paddleX[board])
+			&& m_lives[board] == other.m_lives[board]
+			&& m_remaining[board] == other.m_remaining[board]
+			&& m_episodes[board] == other.m_episodes[board]
+			&& m_broken[board] == other.m_broken[board];
+		for (GLuint brick = 0; same && brick < bricks; ++brick)
+			same = m_alive[brick * m_boards + board] == other.m_alive[brick * other.m_boards + board];
+		if (!same)
+			++different;
+	}
+	return different;
+}
+
+void BatchSim::workerLoop(GLuint worker)
+{
+	uint64_t seen = 0;
+	for (;;)
+	{
+		GLfloat deltaTime = 0.0f;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&] { return m_quit || m_generation != seen; });
+			if (m_quit)
+				return;
+			seen = m_generation;
+			deltaTime = m_deltaTime;
+		}
+
+		GLuint first = 0;
+		GLuint end = 0;
+		this->share(worker + 1, first, end);
+		this->stepRange(first, end, deltaTime);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_pending == 0)
+			m_done.notify_one();
+	}
+}
+
+void BatchSim::share(GLuint part, GLuint& first, GLuint& end) const
+{
+	GLuint blocks = m_boards / BATCH_LANES;
+	GLuint parts = this->Threads();
+	first = (GLuint)((uint64_t)blocks * part / parts) * BATCH_LANES;
+	end = (GLuint)((uint64_t)blocks * (part + 1) / parts) * BATCH_LANES;
+}
+
+void BatchSim::stepRange(GLuint first, GLuint end, GLfloat deltaTime)
+{
+#ifdef BATCHSIM_SSE2
+	if (m_simd)
+	{
+		for (GLuint board = first; board < end; board += BATCH_LANES)
+			this->stepBlock(board, deltaTime);
+		return;
+	}
+#endif
+	for (GLuint board = first; board < end; ++board)
+		this->stepBoard(board, deltaTime);
+}
+
+// The physics of Game::Update for one board, written like Game writes it
+void BatchSim::stepBoard(GLuint board, GLfloat deltaTime)
+{
+	m_paddleX[board] = glm::clamp(m_paddleX[board] + this->Actions[board] * PLAYER_VELOCITY * deltaTime, 0.0f, m_width - PLAYER_SIZE.x);
+
+	// MovementSystem
+	Transform ball{ glm::vec2(m_ballX[board], m_ballY[board]), glm::vec2(BALL_RADIUS * 2) };
+	glm::vec2 velocity(m_velocityX[board], m_velocityY[board]);
+	ball.Position += velocity * deltaTime;
+	if (ball.Position.x <= 0.0f)
+	{
+		velocity.x = -velocity.x;
+		ball.Position.x = 0.0f;
+	}
+	else if (ball.Position.x + ball.Size.x >= m_width)
+	{
+		velocity.x = -velocity.x;
+		ball.Position.x = m_width - ball.Size.x;
+	}
+	if (ball.Position.y <= 0.0f)
+	{
+		velocity.y = -velocity.y;
+		ball.Position.y = 0.0f;
+	}
+
+	// Bricks, as Game::DoCollisions
+	GLuint bricks = (GLuint)m_brickSolid.size();
+	for (GLuint brick = 0; brick < bricks; ++brick)
+	{
+		uint32_t& alive = m_alive[brick * m_boards + board];
+		if (!alive)
+			continue;
+		Collision collision = CheckCollision(ball, BALL_RADIUS, m_brickBoxes[brick]);
+		if (!std::get<0>(collision))
+			continue;
+
+		if (!m_brickSolid[brick])
+		{
+			alive = 0;
+			--m_remaining[board];
+			++m_broken[board];
+		}
+
+		Direction dir = std::get<1>(collision);
+		glm::vec2 difference = std::get<2>(collision);
+		if (dir == LEFT || dir == RIGHT)
+		{
+			velocity.x = -velocity.x;
+			float penetration = BALL_RADIUS - std::abs(difference.x);
+			if (dir == LEFT)
+				ball.Position.x += penetration;
+			else
+				ball.Position.x -= penetration;
+		}
+		else
+		{
+			velocity.y = -velocity.y;
+			float penetration = BALL_RADIUS - std::abs(difference.y);
+			if (dir == UP)
+				ball.Position.y -= penetration;
+			else
+				ball.Position.y += penetration;
+		}
+	}
+
+	// Paddle
+	Transform paddle{ glm::vec2(m_paddleX[board], m_height - PLAYER_SIZE.y), PLAYER_SIZE };
+	if (std::get<0>(CheckCollision(ball, BALL_RADIUS, paddle)))
+	{
+		float centerBoard = paddle.Position.x + paddle.Size.x / 2;
+		float distance = (ball.Position.x + BALL_RADIUS) - centerBoard;
+		float percentage = distance / (paddle.Size.x / 2);
+		float strength = 2.0f;
+		glm::vec2 oldVelocity = velocity;
+		velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
+		velocity = glm::normalize(velocity) * glm::length(oldVelocity);
+		velocity.y = -1 * std::abs(velocity.y);
+	}
+
+	m_ballX[board] = ball.Position.x;
+	m_ballY[board] = ball.Position.y;
+	m_velocityX[board] = velocity.x;
+	m_velocityY[board] = velocity.y;
+
+	if (ball.Position.y >= m_height)
+	{
+		if (--m_lives[board] == 0)
+			this->endEpisode(board);
+		else
+			this->resetBall(board);
+	}
+	if (m_remaining[board] == 0)
+		this->endEpisode(board);
+}
+
+#ifdef BATCHSIM_SSE2
+// stepBoard for BATCH_LANES boards at once. Every operation is the one the
+// scalar code does, in the same order, so a lane ends up with the same bits.
+void BatchSim::stepBlock(GLuint board, GLfloat deltaTime)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 radius = _mm_set1_ps(BALL_RADIUS);
+	const __m128 ballSize = _mm_set1_ps(BALL_RADIUS * 2);
+	const __m128 width = _mm_set1_ps(m_width);
+	const __m128 height = _mm_set1_ps(m_height);
+
+	__m128 paddleX = _mm_loadu_ps(&m_paddleX[board]);
+	__m128 step = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&this->Actions[board]), _mm_set1_ps(PLAYER_VELOCITY)), _mm_set1_ps(deltaTime));
+	paddleX = clamp(_mm_add_ps(paddleX, step), zero, _mm_set1_ps(m_width - PLAYER_SIZE.x));
+
+	// Movement and walls
+	__m128 dt = _mm_set1_ps(deltaTime);
+	__m128 velocityX = _mm_loadu_ps(&m_velocityX[board]);
+	__m128 velocityY = _mm_loadu_ps(&m_velocityY[board]);
+	__m128 x = _mm_add_ps(_mm_loadu_ps(&m_ballX[board]), _mm_mul_ps(velocityX, dt));
+	__m128 y = _mm_add_ps(_mm_loadu_ps(&m_ballY[board]), _mm_mul_ps(velocityY, dt));
+
+	__m128 left = _mm_cmple_ps(x, zero);
+	velocityX = select(left, negate(velocityX), velocityX);
+	x = select(left, zero, x);
+	__m128 right = _mm_andnot_ps(left, _mm_cmpge_ps(_mm_add_ps(x, ballSize), width));
+	velocityX = select(right, negate(velocityX), velocityX);
+	x = select(right, _mm_sub_ps(width, ballSize), x);
+	__m128 top = _mm_cmple_ps(y, zero);
+	velocityY = select(top, negate(velocityY), velocityY);
+	y = select(top, zero, y);
+
+	// Bricks
+	__m128i remaining = _mm_loadu_si128((const __m128i*)&m_remaining[board]);
+	__m128i broken = _mm_loadu_si128((const __m128i*)&m_broken[board]);
+	const __m128i dirNone = _mm_set1_epi32(-1);
+	GLuint bricks = (GLuint)m_brickSolid.size();
+	for (GLuint brick = 0; brick < bricks; ++brick)
+	{
+		uint32_t* aliveAt = &m_alive[brick * m_boards + board];
+		__m128 alive = mask(_mm_loadu_si128((const __m128i*)aliveAt));
+		if (_mm_movemask_ps(alive) == 0)
+			continue;
+
+		// CheckCollision
+		const Transform& box = m_brickBoxes[brick];
+		__m128 halfX = _mm_set1_ps(box.Size.x / 2);
+		__m128 halfY = _mm_set1_ps(box.Size.y / 2);
+		__m128 boxX = _mm_set1_ps(box.Position.x + box.Size.x / 2);
+		__m128 boxY = _mm_set1_ps(box.Position.y + box.Size.y / 2);
+		__m128 centerX = _mm_add_ps(x, radius);
+		__m128 centerY = _mm_add_ps(y, radius);
+		__m128 differenceX = _mm_sub_ps(_mm_add_ps(boxX, clamp(_mm_sub_ps(centerX, boxX), negate(halfX), halfX)), centerX);
+		__m128 differenceY = _mm_sub_ps(_mm_add_ps(boxY, clamp(_mm_sub_ps(centerY, boxY), negate(halfY), halfY)), centerY);
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(differenceX, differenceX), _mm_mul_ps(differenceY, differenceY)));
+		__m128 hit = _mm_and_ps(_mm_cmplt_ps(length, radius), alive);
+		if (_mm_movemask_ps(hit) == 0)
+			continue;
+
+		if (!m_brickSolid[brick])
+		{
+			_mm_storeu_si128((__m128i*)aliveAt, _mm_castps_si128(_mm_andnot_ps(hit, alive)));
+			// A set mask is -1
+			remaining = _mm_add_epi32(remaining, _mm_castps_si128(hit));
+			broken = _mm_sub_epi32(broken, _mm_castps_si128(hit));
+		}
+
+		// VectorDirection: the compass direction with the largest positive dot product, first one wins a tie
+		__m128 inverse = _mm_div_ps(one, length);
+		__m128 normalX = _mm_mul_ps(differenceX, inverse);
+		__m128 normalY = _mm_mul_ps(differenceY, inverse);
+		__m128 best = zero;
+		__m128i dir = dirNone;
+		const __m128 dots[4] = { normalY, normalX, negate(normalY), negate(normalX) };
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128 better = _mm_cmpgt_ps(dots[i], best);
+			best = select(better, dots[i], best);
+			dir = _mm_castps_si128(select(better, mask(_mm_set1_epi32(i)), mask(dir)));
+		}
+		__m128 isLeft = mask(_mm_cmpeq_epi32(dir, _mm_set1_epi32(LEFT)));
+		__m128 isUp = mask(_mm_cmpeq_epi32(dir, _mm_set1_epi32(UP)));
+		__m128 horizontal = _mm_or_ps(isLeft, mask(_mm_cmpeq_epi32(dir, _mm_set1_epi32(RIGHT))));
+
+		__m128 hitX = _mm_and_ps(hit, horizontal);
+		__m128 penetrationX = _mm_sub_ps(radius, absolute(differenceX));
+		velocityX = select(hitX, negate(velocityX), velocityX);
+		x = select(hitX, select(isLeft, _mm_add_ps(x, penetrationX), _mm_sub_ps(x, penetrationX)), x);
+
+		__m128 hitY = _mm_andnot_ps(horizontal, hit);
+		__m128 penetrationY = _mm_sub_ps(radius, absolute(differenceY));
+		velocityY = select(hitY, negate(velocityY), velocityY);
+		y = select(hitY, select(isUp, _mm_sub_ps(y, penetrationY), _mm_add_ps(y, penetrationY)), y);
+	}
+	_mm_storeu_si128((__m128i*)&m_remaining[board], remaining);
+	_mm_storeu_si128((__m128i*)&m_broken[board], broken);
+
+	// Paddle
+	{
+		const __m128 halfX = _mm_set1_ps(PLAYER_SIZE.x / 2);
+		const __m128 halfY = _mm_set1_ps(PLAYER_SIZE.y / 2);
+		__m128 boxX = _mm_add_ps(paddleX, halfX);
+		__m128 boxY = _mm_set1_ps((m_height - PLAYER_SIZE.y) + PLAYER_SIZE.y / 2);
+		__m128 centerX = _mm_add_ps(x, radius);
+		__m128 centerY = _mm_add_ps(y, radius);
+		__m128 differenceX = _mm_sub_ps(_mm_add_ps(boxX, clamp(_mm_sub_ps(centerX, boxX), negate(halfX), halfX)), centerX);
+		__m128 differenceY = _mm_sub_ps(_mm_add_ps(boxY, clamp(_mm_sub_ps(centerY, boxY), negate(halfY), halfY)), centerY);
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(differenceX, differenceX), _mm_mul_ps(differenceY, differenceY)));
+		__m128 hit = _mm_cmplt_ps(length, radius);
+		if (_mm_movemask_ps(hit) != 0)
+		{
+			__m128 percentage = _mm_div_ps(_mm_sub_ps(centerX, boxX), halfX);
+			__m128 newX = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(INITIAL_BALL_VELOCITY.x), percentage), _mm_set1_ps(2.0f));
+			__m128 oldLength = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(velocityX, velocityX), _mm_mul_ps(velocityY, velocityY)));
+			__m128 inverse = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(newX, newX), _mm_mul_ps(velocityY, velocityY))));
+			__m128 bouncedX = _mm_mul_ps(_mm_mul_ps(newX, inverse), oldLength);
+			__m128 bouncedY = negate(absolute(_mm_mul_ps(_mm_mul_ps(velocityY, inverse), oldLength)));
+			velocityX = select(hit, bouncedX, velocityX);
+			velocityY = select(hit, bouncedY, velocityY);
+		}
+	}
+
+	_mm_storeu_ps(&m_paddleX[board], paddleX);
+	_mm_storeu_ps(&m_ballX[board], x);
+	_mm_storeu_ps(&m_ballY[board], y);
+	_mm_storeu_ps(&m_velocityX[board], velocityX);
+	_mm_storeu_ps(&m_velocityY[board], velocityY);
+
+	// Lost balls and cleared boards are rare, they're handled a lane at a time
+	int lost = _mm_movemask_ps(_mm_cmpge_ps(y, height));
+	int cleared = _mm_movemask_ps(mask(_mm_cmpeq_epi32(remaining, _mm_setzero_si128())));
+	for (GLuint lane = 0; lane < BATCH_LANES; ++lane)
+	{
+		if (lost & (1 << lane))
+		{
+			if (--m_lives[board + lane] == 0)
+				this->endEpisode(board + lane);
+			else
+				this->resetBall(board + lane);
+		}
+		if (m_remaining[board + lane] == 0 && (cleared & (1 << lane)))
+			this->endEpisode(board + lane);
+	}
+}
+#endif
+
+void BatchSim::endEpisode(GLuint board)
+{
+	GLuint bricks = (GLuint)m_brickSolid.size();
+	for (GLuint brick = 0; brick < bricks; ++brick)
+		m_alive[brick * m_boards + board] = 0xFFFFFFFFu;
+	m_remaining[board] = m_breakable;
+	m_lives[board] = LIVES;
+	++m_episodes[board];
+	this->resetBall(board);
+}
+
+void BatchSim::resetBall(GLuint board)
+{
+	// On the paddle where it is, launched straight away
+	m_ballX[board] = m_paddleX[board] + PLAYER_SIZE.x / 2 - BALL_RADIUS;
+	m_ballY[board] = m_height - PLAYER_SIZE.y - BALL_RADIUS * 2;
+	m_velocityX[board] = INITIAL_BALL_VELOCITY.x;
+	m_velocityY[board] = INITIAL_BALL_VELOCITY.y;
+}
+
+int RunBatchBenchmark(const LaunchOptions& options, GLuint width, GLuint height)
+{
+	GameLevel level;
+	if (!level.Load("levels/one.txt"))
+		return EXIT_FAILURE;
+
+	BatchSim batch(level, options.BatchSim, width, height, options.BatchThreads, options.Seed);
+	BatchSim reference(level, std::min(options.BatchSim, REFERENCE_BOARDS), width, height, 1, options.Seed, false);
+
+	Clock::time_point start = Clock::now();
+	for (GLuint tick = 0; tick < options.BatchTicks; ++tick)
+	{
+		batch.TrackBall();
+		batch.Step(BATCH_TICK);
+	}
+	double batchSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	start = Clock::now();
+	for (GLuint tick = 0; tick < options.BatchTicks; ++tick)
+	{
+		reference.TrackBall();
+		reference.Step(BATCH_TICK);
+	}
+	double referenceSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	double steps = (double)batch.Boards() * options.BatchTicks;
+	double referenceSteps = (double)reference.Boards() * options.BatchTicks;
+	char line[256];
+	snprintf(line, sizeof(line), "BATCHSIM: %u boards x %u ticks on %u threads, %u lanes%s: %.2f M board-steps/s, %.3f ms per tick\n",
+		batch.Boards(), options.BatchTicks, batch.Threads(), batch.Simd() ? BATCH_LANES : 1, batch.Simd() ? " (SSE2)" : "",
+		steps / batchSeconds / 1e6, batchSeconds * 1000.0 / options.BatchTicks);
+	std::cout << line;
+	snprintf(line, sizeof(line), "BATCHSIM: scalar reference, %u boards on 1 thread: %.2f M board-steps/s\n",
+		reference.Boards(), referenceSteps / referenceSeconds / 1e6);
+	std::cout << line;
+	snprintf(line, sizeof(line), "BATCHSIM: %llu episodes finished, %llu bricks broken\n",
+		(unsigned long long)batch.Episodes(), (unsigned long long)batch.BricksBroken());
+	std::cout << line;
+
+	GLuint different = batch.Compare(reference);
+	if (different > 0)
+	{
+		std::cout << "ERROR::BATCHSIM: " << different << " of " << reference.Boards() << " boards ended up different from the scalar reference\n";
+		return EXIT_FAILURE;
+	}
+	std::cout << "BATCHSIM: The first " << reference.Boards() << " boards match the scalar reference bit for bit\n";
+	return 0;
+}
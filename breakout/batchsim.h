@@ -0,0 +1,122 @@
+#ifndef _batchsim_HG_
+#define _batchsim_HG_
+
+#include <glad/glad.h>
+
+#include "components.h"
+#include "gamelevel.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Boards stepped together by one SIMD instruction
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define BATCHSIM_SSE2
+	const GLuint BATCH_LANES = 4;
+#else
+	const GLuint BATCH_LANES = 1;
+#endif
+
+// Many breakout boards stepped in lockstep, for playtesting bots and
+// training. It's only the ball, paddle and brick physics of Game (the same
+// movement, wall bounces, circle against box collisions and paddle
+// deflection), without power-ups, particles or rendering.
+//
+// State is laid out board by board in flat arrays (structure of arrays), so
+// a SIMD register holds the same value for BATCH_LANES neighbouring boards
+// and every board goes through the same bricks in the same order. A lane
+// whose ball missed a brick keeps its old values through a select. Boards
+// are split between a pool of worker threads; nothing is shared between
+// boards, so the workers never synchronise inside a tick.
+//
+// Every board plays the same level. A board that loses its last life or
+// clears every brick starts over, counting an episode. Boards start from a
+// seed and the board's index, the same board in two batches plays the same.
+class BatchSim
+{
+public:
+	static const GLuint LIVES = 3;
+
+	// Boards are rounded up to whole SIMD blocks, threads 0 for one per
+	// core. Without simd every board is stepped on its own with Game's
+	// CheckCollision, the reference the SIMD kernel must match bit for bit.
+	BatchSim(const GameLevel& level, GLuint boards, GLuint width, GLuint height, GLuint threads, uint32_t seed, bool simd = true);
+	~BatchSim();
+
+	// One tick for every board, Actions must be set first
+	void Step(GLfloat deltaTime);
+	// Sets every board's action to chase its ball, the benchmark's bot
+	void TrackBall();
+
+	GLuint Boards() const { return m_boards; }
+	GLuint Threads() const { return (GLuint)m_workers.size() + 1; }
+	bool Simd() const { return m_simd; }
+	// Finished episodes and bricks broken over every board
+	uint64_t Episodes() const;
+	uint64_t BricksBroken() const;
+	// Boards both batches have whose state differs in any bit
+	GLuint Compare(const BatchSim& other) const;
+
+	// Per board, -1 to 1: the paddle moves left or right at full speed
+	std::vector<float>	Actions;
+
+	BatchSim(const BatchSim&) = delete;
+	BatchSim& operator=(const BatchSim&) = delete;
+
+private:
+	GLuint					m_boards;		// a multiple of BATCH_LANES
+	GLfloat					m_width;
+	GLfloat					m_height;
+	bool					m_simd;
+
+	// Bricks are the same for every board, only whether they're still there differs
+	std::vector<Transform>	m_brickBoxes;
+	std::vector<uint8_t>	m_brickSolid;
+	int32_t					m_breakable;	// bricks to clear per episode
+
+	std::vector<float>		m_ballX;		// top left, like Transform::Position
+	std::vector<float>		m_ballY;
+	std::vector<float>		m_velocityX;
+	std::vector<float>		m_velocityY;
+	std::vector<float>		m_paddleX;
+	std::vector<uint32_t>	m_alive;		// [brick * boards + board], all bits set while the brick stands
+	std::vector<int32_t>	m_lives;
+	std::vector<int32_t>	m_remaining;
+	std::vector<uint32_t>	m_episodes;
+	std::vector<uint32_t>	m_broken;
+
+	// Workers step blocks of boards, the calling thread takes the first share
+	std::vector<std::thread>	m_workers;
+	std::mutex					m_mutex;
+	std::condition_variable		m_wake;
+	std::condition_variable		m_done;
+	uint64_t					m_generation;	// bumped for every Step
+	GLuint						m_pending;		// workers still stepping
+	GLfloat						m_deltaTime;
+	bool						m_quit;
+
+	void workerLoop(GLuint worker);
+	// Boards [first, end) of a share, split on SIMD blocks
+	void share(GLuint part, GLuint& first, GLuint& end) const;
+	void stepRange(GLuint first, GLuint end, GLfloat deltaTime);
+	void stepBoard(GLuint board, GLfloat deltaTime);
+#ifdef BATCHSIM_SSE2
+	void stepBlock(GLuint board, GLfloat deltaTime);
+#endif
+	// Lost or won: bricks, lives and ball back to the start
+	void endEpisode(GLuint board);
+	void resetBall(GLuint board);
+};
+
+struct LaunchOptions;
+
+// --batchsim: steps that many boards for a number of ticks on every core,
+// checks the SIMD kernel against the scalar one and prints board-steps per
+// second for both. Returns the process exit code.
+int RunBatchBenchmark(const LaunchOptions& options, GLuint width, GLuint height);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _components_HG_
+#define _components_HG_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "resourcemanager.h"
+
+// Plain data attached to entities in the Registry. Anything that behaves
+// differently does so because a system looks for a component, not because of
+// its type.
+
+struct Transform
+{
+	glm::vec2	Position;
+	glm::vec2	Size;
+};
+
+struct Velocity
+{
+	glm::vec2	Value;
+};
+
+// Sprites are drawn one layer at a time so the order between kinds of entity
+// stays fixed no matter how the pools are packed
+enum RenderLayer
+{
+	LAYER_BRICKS,
+	LAYER_PADDLE,
+	LAYER_POWERUPS,
+	LAYER_BALLS		// drawn after the particles
+};
+
+struct Sprite
+{
+	TextureHandle		Texture;
+	glm::vec3			Color;
+	GLfloat				Rotation;
+	RenderLayer			Layer;
+};
+
+struct Brick
+{
+	GLboolean	Solid;
+};
+
+// A player's paddle, there are two in versus
+struct Paddle
+{
+	GLuint		Player;
+};
+
+struct Ball
+{
+	GLfloat		Radius;
+	bool		Stuck;
+	bool		Sticky;
+	bool		PassThrough;
+	GLfloat		TrailCarry;		// trail particles owed but not emitted yet
+	GLuint		Owner;			// player whose paddle it left last, bricks it breaks score for them
+};
+
+enum PowerUpType
+{
+	POWERUP_SPEED,
+	POWERUP_STICKY,
+	POWERUP_PASS_THROUGH,
+	POWERUP_PAD_SIZE_INCREASE,
+	POWERUP_CONFUSE,
+	POWERUP_CHAOS,
+	POWERUP_COUNT
+};
+
+const glm::vec2 POWER_UP_SIZE(60, 20);
+const glm::vec2 POWER_UP_VELOCITY(0.0f, 150.0f);
+
+// A falling power-up also has a Transform, Velocity and Sprite. Once the paddle
+// catches it those are removed and only this remains while the effect lasts.
+struct PowerUp
+{
+	PowerUpType	Type;
+	GLfloat		Duration;
+	bool		Activated;
+	GLfloat		TrailCarry;		// trail particles owed but not emitted yet
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include "ecs.h"
+
+#include <iostream>
+
+uint32_t Registry::nextComponentId()
+{
+	static uint32_t next = 0;
+	return next++;
+}
+
+Entity Registry::Create()
+{
+	uint32_t index;
+	if (!m_free.empty())
+	{
+		index = m_free.back();
+		m_free.pop_back();
+	}
+	else
+	{
+		index = (uint32_t)m_generations.size();
+		if (index > ENTITY_INDEX_MASK)
+		{
+			std::cout << "ERROR::ECS: Out of entity ids\n";
+			return NULL_ENTITY;
+		}
+		m_generations.push_back(0);
+	}
+	return (m_generations[index] << ENTITY_INDEX_BITS) | index;
+}
+
+void Registry::Destroy(Entity entity)
+{
+	if (!this->Valid(entity))
+		return;
+
+	for (std::unique_ptr<ComponentPoolBase>& pool : m_pools)
+	{
+		if (pool)
+			pool->Remove(entity);
+	}
+	uint32_t index = EntityIndex(entity);
+	m_generations[index] = (m_generations[index] + 1) & (0xFFFFFFFFu >> ENTITY_INDEX_BITS);
+	m_free.push_back(index);
+}
+
+void Registry::Reserve(size_t entities)
+{
+	m_reserved = entities;
+	m_generations.reserve(entities);
+	m_free.reserve(entities);
+	for (std::unique_ptr<ComponentPoolBase>& pool : m_pools)
+	{
+		if (pool)
+			pool->Reserve(entities);
+	}
+}
+
+bool Registry::Valid(Entity entity) const
+{
+	uint32_t index = EntityIndex(entity);
+	return entity != NULL_ENTITY && index < m_generations.size()
+		&& (m_generations[index] << ENTITY_INDEX_BITS) == (entity & ~ENTITY_INDEX_MASK);
+}
+
+void Registry::Clear()
+{
+	for (std::unique_ptr<ComponentPoolBase>& pool : m_pools)
+	{
+		if (pool)
+			pool->Clear();
+	}
+	m_free.clear();
+	for (uint32_t index = 0; index < m_generations.size(); ++index)
+	{
+		m_generations[index] = (m_generations[index] + 1) & (0xFFFFFFFFu >> ENTITY_INDEX_BITS);
+		m_free.push_back(index);
+	}
+}
+
+void Registry::Save(SnapshotWriter& out) const
+{
+	out.Write((uint32_t)m_generations.size());
+	out.Write(m_generations.data(), m_generations.size() * sizeof(uint32_t));
+	out.Write((uint32_t)m_free.size());
+	out.Write(m_free.data(), m_free.size() * sizeof(uint32_t));
+	out.Write((uint32_t)m_pools.size());
+	for (const std::unique_ptr<ComponentPoolBase>& pool : m_pools)
+	{
+		// Pools that were never used are saved as empty
+		if (pool)
+			pool->Save(out);
+		else
+			out.Write((uint32_t)0);
+	}
+}
+
+bool Registry::Load(SnapshotReader& in)
+{
+	uint32_t slots = 0;
+	if (!in.Read(slots) || !in.Has((size_t)slots * sizeof(uint32_t)))
+		return false;
+	m_generations.resize(slots);
+	in.Read(m_generations.data(), slots * sizeof(uint32_t));
+
+	uint32_t freeSlots = 0;
+	if (!in.Read(freeSlots) || !in.Has((size_t)freeSlots * sizeof(uint32_t)))
+		return false;
+	m_free.resize(freeSlots);
+	in.Read(m_free.data(), freeSlots * sizeof(uint32_t));
+
+	uint32_t pools = 0;
+	if (!in.Read(pools))
+		return false;
+	for (uint32_t id = 0; id < pools; ++id)
+	{
+		if (id < m_pools.size() && m_pools[id])
+		{
+			if (!m_pools[id]->Load(in))
+				return false;
+			continue;
+		}
+		// A component type this registry hasn't made a pool for can only be skipped if it was empty
+		uint32_t count = 0;
+		if (!in.Read(count) || count != 0)
+		{
+			std::cout << "ERROR::ECS: Snapshot holds components of a type this registry has no pool for\n";
+			return false;
+		}
+	}
+	// Pools made after the snapshot was taken were empty then
+	for (size_t id = pools; id < m_pools.size(); ++id)
+	{
+		if (m_pools[id])
+			m_pools[id]->Clear();
+	}
+	return true;
+}
+
+size_t Registry::SaveCapacity() const
+{
+	size_t entities = std::max(m_reserved, m_generations.size());
+	size_t bytes = 3 * sizeof(uint32_t) + 2 * entities * sizeof(uint32_t);
+	for (const std::unique_ptr<ComponentPoolBase>& pool : m_pools)
+		bytes += pool ? pool->SaveSize(entities) : sizeof(uint32_t);
+	return bytes;
+}
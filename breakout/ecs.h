@@ -0,0 +1,247 @@
+#ifndef _ecs_HG_
+#define _ecs_HG_
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// An entity is just an id: the low 24 bits index the registry's slots and the
+// high 8 bits count how often that slot has been reused, so a handle kept
+// around after its entity was destroyed doesn't match whatever reuses the slot.
+typedef uint32_t Entity;
+const Entity NULL_ENTITY = 0xFFFFFFFFu;
+
+const uint32_t ENTITY_INDEX_BITS = 24;
+const uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+
+inline uint32_t EntityIndex(Entity entity) { return entity & ENTITY_INDEX_MASK; }
+
+// Sparse entry of an entity that has no component in the pool
+const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+class ComponentPoolBase
+{
+public:
+	virtual ~ComponentPoolBase() {}
+	virtual void Remove(Entity entity) = 0;
+	virtual void Clear() = 0;
+	virtual void Reserve(size_t entities) = 0;
+	virtual void Save(SnapshotWriter& out) const = 0;
+	virtual bool Load(SnapshotReader& in) = 0;
+	// Bytes Save writes for this many components
+	virtual size_t SaveSize(size_t entities) const = 0;
+};
+
+// Sparse set of one component type. Components are packed tightly in
+// m_components (with their owners at the same position in m_entities), m_sparse
+// maps an entity index to that position. Removing swaps the last component into
+// the hole, so adding or removing invalidates references into the pool.
+template <typename T>
+class ComponentPool : public ComponentPoolBase
+{
+	static_assert(std::is_trivially_copyable<T>::value, "components are plain data, snapshots copy them as bytes");
+
+public:
+	T& Add(Entity entity, const T& component)
+	{
+		uint32_t index = EntityIndex(entity);
+		if (index >= m_sparse.size())
+			m_sparse.resize(index + 1, NO_SLOT);
+		if (this->Has(entity))
+			return m_components[m_sparse[index]] = component;
+
+		m_sparse[index] = (uint32_t)m_entities.size();
+		m_entities.push_back(entity);
+		m_components.push_back(component);
+		return m_components.back();
+	}
+
+	void Remove(Entity entity) override
+	{
+		if (!this->Has(entity))
+			return;
+
+		uint32_t slot = m_sparse[EntityIndex(entity)];
+		uint32_t last = (uint32_t)m_entities.size() - 1;
+		if (slot != last)
+		{
+			m_entities[slot] = m_entities[last];
+			m_components[slot] = m_components[last];
+			m_sparse[EntityIndex(m_entities[slot])] = slot;
+		}
+		m_entities.pop_back();
+		m_components.pop_back();
+		m_sparse[EntityIndex(entity)] = NO_SLOT;
+	}
+
+	bool Has(Entity entity) const
+	{
+		uint32_t index = EntityIndex(entity);
+		return index < m_sparse.size() && m_sparse[index] != NO_SLOT && m_entities[m_sparse[index]] == entity;
+	}
+
+	T* Get(Entity entity)
+	{
+		return this->Has(entity) ? &m_components[m_sparse[EntityIndex(entity)]] : nullptr;
+	}
+
+	void Clear() override
+	{
+		m_sparse.clear();
+		m_entities.clear();
+		m_components.clear();
+	}
+
+	void Reserve(size_t entities) override
+	{
+		m_sparse.reserve(entities);
+		m_entities.reserve(entities);
+		m_components.reserve(entities);
+	}
+
+	// The packed arrays as they are, so a Load restores the iteration order too.
+	// The sparse map is rebuilt from the owners rather than stored.
+	void Save(SnapshotWriter& out) const override
+	{
+		out.Write((uint32_t)m_entities.size());
+		out.Write(m_entities.data(), m_entities.size() * sizeof(Entity));
+		out.Write(m_components.data(), m_components.size() * sizeof(T));
+	}
+
+	bool Load(SnapshotReader& in) override
+	{
+		uint32_t count = 0;
+		if (!in.Read(count) || !in.Has((size_t)count * (sizeof(Entity) + sizeof(T))))
+			return false;
+		m_entities.resize(count);
+		m_components.resize(count);
+		in.Read(m_entities.data(), count * sizeof(Entity));
+		in.Read(m_components.data(), count * sizeof(T));
+		std::fill(m_sparse.begin(), m_sparse.end(), NO_SLOT);
+		for (uint32_t slot = 0; slot < count; ++slot)
+		{
+			uint32_t index = EntityIndex(m_entities[slot]);
+			if (index >= m_sparse.size())
+				m_sparse.resize(index + 1, NO_SLOT);
+			m_sparse[index] = slot;
+		}
+		return true;
+	}
+
+	size_t SaveSize(size_t entities) const override
+	{
+		return sizeof(uint32_t) + entities * (sizeof(Entity) + sizeof(T));
+	}
+
+	size_t Size() const { return m_entities.size(); }
+	Entity EntityAt(size_t slot) const { return m_entities[slot]; }
+	T& At(size_t slot) { return m_components[slot]; }
+
+private:
+	std::vector<uint32_t>	m_sparse;
+	std::vector<Entity>		m_entities;
+	std::vector<T>			m_components;
+};
+
+// Owns every entity and one pool per component type. Components are plain
+// structs, behaviour lives in systems that iterate the pools with Each.
+class Registry
+{
+public:
+	Registry() {}
+
+	Entity Create();
+	// Removes the entity's components right away and frees its id for reuse
+	void Destroy(Entity entity);
+	bool Valid(Entity entity) const;
+	// Makes room for this many entities in the registry and every pool, so
+	// creating entities and adding components up to that count never allocates
+	void Reserve(size_t entities);
+	// Destroys every entity
+	void Clear();
+	size_t Alive() const { return m_generations.size() - m_free.size(); }
+
+	// Every id, free slot and component as raw bytes. Load puts the registry
+	// back exactly as it was saved, so entities created and pools iterated
+	// afterwards come out in the same order. Only loads into the registry
+	// that saved it (or one that made the same pools).
+	void Save(SnapshotWriter& out) const;
+	bool Load(SnapshotReader& in);
+	// Bytes Save needs with the reserved number of entities
+	size_t SaveCapacity() const;
+
+	template <typename T>
+	ComponentPool<T>& Pool()
+	{
+		uint32_t id = componentId<T>();
+		if (id >= m_pools.size())
+			m_pools.resize(id + 1);
+		if (!m_pools[id])
+		{
+			m_pools[id].reset(new ComponentPool<T>());
+			m_pools[id]->Reserve(m_reserved);
+		}
+		return *static_cast<ComponentPool<T>*>(m_pools[id].get());
+	}
+
+	template <typename T>
+	T& Add(Entity entity, const T& component = T()) { return this->Pool<T>().Add(entity, component); }
+	template <typename T>
+	void Remove(Entity entity) { this->Pool<T>().Remove(entity); }
+	template <typename T>
+	T* Get(Entity entity) { return this->Pool<T>().Get(entity); }
+	template <typename T>
+	bool Has(Entity entity) { return this->Pool<T>().Has(entity); }
+
+	// Calls fn(entity, First&, Rest&...) for every entity that has all the
+	// listed components. Only the First pool is walked, so list the rarest
+	// component first. Iteration runs back to front, so fn may destroy the
+	// entity it was given, but it must not add components of the listed types.
+	template <typename First, typename... Rest, typename Fn>
+	void Each(Fn fn)
+	{
+		ComponentPool<First>& pool = this->Pool<First>();
+		for (size_t slot = pool.Size(); slot-- > 0;)
+		{
+			if (slot >= pool.Size())
+				continue;
+			Entity entity = pool.EntityAt(slot);
+			if (this->hasAll<Rest...>(entity))
+				fn(entity, pool.At(slot), *this->Get<Rest>(entity)...);
+		}
+	}
+
+	Registry(const Registry&) = delete;
+	Registry& operator=(const Registry&) = delete;
+
+private:
+	std::vector<uint32_t>		m_generations;	// per slot
+	std::vector<uint32_t>		m_free;			// slots of destroyed entities
+	std::vector<std::unique_ptr<ComponentPoolBase>> m_pools;
+	size_t						m_reserved = 0;
+
+	static uint32_t nextComponentId();
+	template <typename T>
+	static uint32_t componentId()
+	{
+		static const uint32_t id = nextComponentId();
+		return id;
+	}
+
+	template <typename... Ts>
+	bool hasAll(Entity entity)
+	{
+		bool all = true;
+		int expand[] = { 0, (all = all && this->Has<Ts>(entity), 0)... };
+		(void)expand;
+		(void)entity;	// unused when Each has a single component
+		return all;
+	}
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "framearena.h"
+
+#include <cstdint>
+#include <iostream>
+
+namespace
+{
+	unsigned char*	g_block = nullptr;
+	size_t			g_capacity = 0;
+	size_t			g_used = 0;
+	size_t			g_highWater = 0;
+	bool			g_reportedFull = false;
+
+	bool inBlock(void* p)
+	{
+		return p >= g_block && p < g_block + g_capacity;
+	}
+
+	class ArenaResource : public std::pmr::memory_resource
+	{
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			void* p = FrameArena::Allocate(bytes, alignment);
+			return p ? p : std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override
+		{
+			// Arena memory goes back all at once in Reset, only overflow needs freeing
+			if (!inBlock(p))
+				std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+
+	ArenaResource g_resource;
+}
+
+void FrameArena::Init(size_t capacity)
+{
+	delete[] g_block;
+	g_block = new unsigned char[capacity];
+	g_capacity = capacity;
+	g_used = 0;
+	g_highWater = 0;
+	g_reportedFull = false;
+}
+
+void FrameArena::Shutdown()
+{
+	delete[] g_block;
+	g_block = nullptr;
+	g_capacity = 0;
+	g_used = 0;
+}
+
+void FrameArena::Reset()
+{
+	g_used = 0;
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment)
+{
+	uintptr_t base = (uintptr_t)g_block;
+	uintptr_t aligned = (base + g_used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	size_t end = (size_t)(aligned - base) + bytes;
+	if (g_block == nullptr || end > g_capacity)
+	{
+		if (!g_reportedFull)
+		{
+			std::cout << "ERROR::FRAMEARENA: Out of space allocating " << bytes << " bytes ("
+				<< g_used << " of " << g_capacity << " used)\n";
+			g_reportedFull = true;
+		}
+		return nullptr;
+	}
+
+	g_used = end;
+	if (g_used > g_highWater)
+		g_highWater = g_used;
+	return (void*)aligned;
+}
+
+std::pmr::memory_resource* FrameArena::Resource()
+{
+	return &g_resource;
+}
+
+size_t FrameArena::Used()
+{
+	return g_used;
+}
+
+size_t FrameArena::HighWater()
+{
+	return g_highWater;
+}
+
+size_t FrameArena::Capacity()
+{
+	return g_capacity;
+}
@@ -0,0 +1,38 @@
+#ifndef _framearena_HG_
+#define _framearena_HG_
+
+#include <cstddef>
+#include <memory_resource>
+
+// Bump allocator for data that only lives until the end of the frame. Every
+// allocation is a pointer increment into one block made at startup, nothing is
+// freed on its own, Reset at the top of the next frame takes it all back.
+// Containers use it through the std::pmr resource:
+//
+//	std::pmr::vector<Entity> doomed(FrameArena::Resource());
+//
+// Nothing allocated from it may be kept past the frame. Main thread only. When
+// the block runs out Allocate returns null and the pmr resource falls back to
+// the heap (reported once), so an undersized arena costs speed, not correctness.
+class FrameArena
+{
+public:
+	static void Init(size_t capacity);
+	static void Shutdown();
+	// Frees everything allocated since the last Reset
+	static void Reset();
+
+	// Null once the block is full
+	static void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	// Adapter for std::pmr containers, deallocating through it is a no-op
+	static std::pmr::memory_resource* Resource();
+
+	static size_t Used();
+	static size_t HighWater();	// most used by any frame so far
+	static size_t Capacity();
+
+private:
+	FrameArena() {}
+};
+
+#endif
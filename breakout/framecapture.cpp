@@ -0,0 +1,392 @@
+#include "framecapture.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <trace/trace.h>
+
+namespace
+{
+	const size_t DEFLATE_STORED_MAX = 65535;
+
+	// fopen is deprecated under MSVC's /sdl
+	FILE* openFile(const char* path, const char* mode)
+	{
+#ifdef _MSC_VER
+		FILE* file = nullptr;
+		return fopen_s(&file, path, mode) == 0 ? file : nullptr;
+#else
+		return fopen(path, mode);
+#endif
+	}
+
+	std::array<uint32_t, 256> crcTable()
+	{
+		std::array<uint32_t, 256> table;
+		for (uint32_t n = 0; n < 256; ++n)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k)
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		return table;
+	}
+
+	uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+	{
+		static const std::array<uint32_t, 256> table = crcTable();
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void putU32(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	void putChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size)
+	{
+		putU32(out, (uint32_t)size);
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + size);
+		putU32(out, crc32(out.data() + start, size + 4));
+	}
+
+	// An RGB PNG with the image data in stored (uncompressed) deflate blocks.
+	// Bigger than a compressed PNG but needs no zlib and costs next to nothing
+	// to write, which is what keeps a recording from falling behind.
+	bool writePng(const char* path, const unsigned char* rgb, GLuint width, GLuint height,
+		std::vector<unsigned char>& scanlines, std::vector<unsigned char>& file)
+	{
+		size_t rowBytes = (size_t)width * 3;
+		scanlines.resize(height * (rowBytes + 1));
+		for (GLuint y = 0; y < height; ++y)
+		{
+			unsigned char* row = &scanlines[y * (rowBytes + 1)];
+			row[0] = 0;		// filter type none
+			memcpy(row + 1, rgb + y * rowBytes, rowBytes);
+		}
+
+		uint32_t a = 1;
+		uint32_t b = 0;
+		for (unsigned char value : scanlines)
+		{
+			a = (a + value) % 65521;
+			b = (b + a) % 65521;
+		}
+
+		std::vector<unsigned char> zlib;
+		zlib.reserve(scanlines.size() + scanlines.size() / DEFLATE_STORED_MAX * 5 + 16);
+		zlib.push_back(0x78);
+		zlib.push_back(0x01);
+		for (size_t offset = 0; offset < scanlines.size(); offset += DEFLATE_STORED_MAX)
+		{
+			size_t length = scanlines.size() - offset < DEFLATE_STORED_MAX ? scanlines.size() - offset : DEFLATE_STORED_MAX;
+			zlib.push_back(offset + length == scanlines.size() ? 1 : 0);
+			zlib.push_back((unsigned char)length);
+			zlib.push_back((unsigned char)(length >> 8));
+			zlib.push_back((unsigned char)~length);
+			zlib.push_back((unsigned char)(~length >> 8));
+			zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+		}
+		putU32(zlib, (b << 16) | a);
+
+		static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		unsigned char header[13];
+		const uint32_t dimensions[2] = { width, height };
+		for (int i = 0; i < 2; ++i)
+		{
+			header[i * 4 + 0] = (unsigned char)(dimensions[i] >> 24);
+			header[i * 4 + 1] = (unsigned char)(dimensions[i] >> 16);
+			header[i * 4 + 2] = (unsigned char)(dimensions[i] >> 8);
+			header[i * 4 + 3] = (unsigned char)dimensions[i];
+		}
+		header[8] = 8;		// bits per channel
+		header[9] = 2;		// truecolour
+		header[10] = 0;		// deflate
+		header[11] = 0;		// adaptive filtering
+		header[12] = 0;		// not interlaced
+
+		file.clear();
+		file.insert(file.end(), SIGNATURE, SIGNATURE + 8);
+		putChunk(file, "IHDR", header, sizeof(header));
+		putChunk(file, "IDAT", zlib.data(), zlib.size());
+		putChunk(file, "IEND", nullptr, 0);
+
+		FILE* out = openFile(path, "wb");
+		if (!out)
+			return false;
+		bool written = fwrite(file.data(), 1, file.size(), out) == file.size();
+		return fclose(out) == 0 && written;
+	}
+}
+
+FrameCapture::FrameCapture(GLuint width, GLuint height)
+	: m_width(width)
+	, m_height(height)
+	, m_nextSlot(0)
+	, m_inFlight(0)
+	, m_recording(false)
+	, m_recordedFrames(0)
+	, m_screenshotRequested(false)
+	, m_screenshots(0)
+	, m_captured(0)
+	, m_dropped(0)
+	, m_freeCount(QUEUE)
+	, m_queueHead(0)
+	, m_queueCount(0)
+	, m_encoding(false)
+	, m_stop(false)
+	, m_format(CAPTURE_PNG)
+	, m_raw(nullptr)
+{
+	GLsizeiptr bytes = (GLsizeiptr)width * height * 4;
+	for (Slot& slot : m_slots)
+	{
+		slot.Buffer = GLBuffer::Create("FrameCapture readback");
+		slot.Fence = 0;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer.ID());
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+		slot.Buffer.SetBytes(bytes);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_frames.resize(QUEUE);
+	for (GLuint i = 0; i < QUEUE; ++i)
+	{
+		m_frames[i].resize(bytes);
+		m_free[i] = i;
+	}
+	m_encoder = std::thread(&FrameCapture::encodeLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+	this->StopRecording();
+	this->collect(SLOTS);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_one();
+	m_encoder.join();
+	if (m_dropped > 0)
+		std::cout << "WARNING::CAPTURE: " << m_dropped << " of " << m_captured + m_dropped << " frames dropped, the encoder fell behind\n";
+}
+
+bool FrameCapture::StartRecording(const std::string& path, CaptureFormat format)
+{
+	this->StopRecording();
+	FILE* raw = nullptr;
+	if (format == CAPTURE_RAW)
+	{
+		raw = openFile(path.c_str(), "wb");
+		if (!raw)
+		{
+			std::cout << "ERROR::CAPTURE: Can't write " << path << "\n";
+			return false;
+		}
+	}
+	// The encoder is idle after StopRecording, nothing reads these until the next frame is queued
+	m_path = path;
+	m_format = format;
+	m_raw = raw;
+	m_recording = true;
+	m_recordedFrames = 0;
+	return true;
+}
+
+void FrameCapture::StopRecording()
+{
+	if (!m_recording)
+		return;
+	m_recording = false;
+	// Everything already read belongs to this recording, let it all reach the file
+	this->collect(SLOTS);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_queueCount == 0 && !m_encoding; });
+	if (m_raw)
+	{
+		fclose(m_raw);
+		m_raw = nullptr;
+		std::cout << "CAPTURE: " << m_recordedFrames << " frames in " << m_path << ", play with ffmpeg -f rawvideo -pixel_format rgb24 -video_size "
+			<< m_width << "x" << m_height << " -framerate 60 -i " << m_path << "\n";
+	}
+	else
+	{
+		std::cout << "CAPTURE: " << m_recordedFrames << " frames in " << m_path << "\n";
+	}
+}
+
+void FrameCapture::Screenshot()
+{
+	m_screenshotRequested = true;
+}
+
+void FrameCapture::EndFrame(GLuint framebuffer)
+{
+	this->collect(0);
+	if (!m_recording && !m_screenshotRequested)
+		return;
+
+	TRACE_ZONE("FrameCapture::ReadPixels");
+	// Every slot still in flight means the GPU is SLOTS frames behind, wait for the oldest
+	if (m_inFlight == SLOTS)
+		this->collect(1);
+
+	Slot& slot = m_slots[m_nextSlot];
+	slot.Pending.Record = m_recording;
+	slot.Pending.Frame = m_recording ? m_recordedFrames++ : 0;
+	slot.Pending.Screenshot = m_screenshotRequested ? ++m_screenshots : 0;
+	m_screenshotRequested = false;
+
+	GLint previous;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer.ID());
+	// Into the buffer, so this only queues the copy
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+	slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_nextSlot = (m_nextSlot + 1) % SLOTS;
+	++m_inFlight;
+}
+
+void FrameCapture::collect(GLuint waitFor)
+{
+	GLsizeiptr bytes = (GLsizeiptr)m_width * m_height * 4;
+	for (GLuint collected = 0; m_inFlight > 0; ++collected)
+	{
+		Slot& slot = m_slots[(m_nextSlot + SLOTS - m_inFlight) % SLOTS];
+		GLenum result = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (collected < waitFor && result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		if (result == GL_TIMEOUT_EXPIRED)
+			break;
+		glDeleteSync(slot.Fence);
+		slot.Fence = 0;
+		--m_inFlight;
+
+		GLuint frame;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_freeCount == 0)
+			{
+				++m_dropped;
+				continue;
+			}
+			frame = m_free[--m_freeCount];
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer.ID());
+		const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+		if (mapped)
+		{
+			memcpy(m_frames[frame].data(), mapped, bytes);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (mapped)
+			{
+				m_requests[frame] = slot.Pending;
+				m_queue[(m_queueHead + m_queueCount) % QUEUE] = frame;
+				++m_queueCount;
+			}
+			else
+			{
+				m_free[m_freeCount++] = frame;
+			}
+		}
+		if (mapped)
+		{
+			++m_captured;
+			m_wake.notify_one();
+		}
+		else
+		{
+			std::cout << "ERROR::CAPTURE: Mapping a readback buffer failed\n";
+		}
+	}
+}
+
+void FrameCapture::encodeLoop()
+{
+	TRACE_THREAD_NAME("FrameCapture");
+	m_rgb.resize((size_t)m_width * m_height * 3);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_wake.wait(lock, [this]() { return m_stop || m_queueCount > 0; });
+		if (m_queueCount == 0)
+			break;
+		GLuint frame = m_queue[m_queueHead];
+		m_queueHead = (m_queueHead + 1) % QUEUE;
+		--m_queueCount;
+		Request request = m_requests[frame];
+		m_encoding = true;
+
+		lock.unlock();
+		this->encode(m_frames[frame].data(), request);
+		lock.lock();
+
+		m_free[m_freeCount++] = frame;
+		m_encoding = false;
+		if (m_queueCount == 0)
+			m_idle.notify_all();
+	}
+}
+
+void FrameCapture::encode(const unsigned char* rgba, const Request& request)
+{
+	TRACE_ZONE("FrameCapture::Encode");
+	// GL rows start at the bottom, files start at the top
+	for (GLuint y = 0; y < m_height; ++y)
+	{
+		const unsigned char* source = rgba + (size_t)(m_height - 1 - y) * m_width * 4;
+		unsigned char* target = &m_rgb[(size_t)y * m_width * 3];
+		for (GLuint x = 0; x < m_width; ++x)
+		{
+			target[x * 3 + 0] = source[x * 4 + 0];
+			target[x * 3 + 1] = source[x * 4 + 1];
+			target[x * 3 + 2] = source[x * 4 + 2];
+		}
+	}
+
+	char name[512];
+	if (request.Record)
+	{
+		if (m_format == CAPTURE_RAW)
+		{
+			if (fwrite(m_rgb.data(), 1, m_rgb.size(), m_raw) != m_rgb.size())
+				std::cout << "ERROR::CAPTURE: Writing frame " << request.Frame << " to " << m_path << " failed\n";
+		}
+		else
+		{
+			snprintf(name, sizeof(name), "%s/frame_%06u.png", m_path.c_str(), request.Frame);
+			if (!writePng(name, m_rgb.data(), m_width, m_height, m_scanlines, m_file))
+				std::cout << "ERROR::CAPTURE: Can't write " << name << "\n";
+		}
+	}
+	if (request.Screenshot)
+	{
+		snprintf(name, sizeof(name), "screenshot_%04u.png", request.Screenshot);
+		if (writePng(name, m_rgb.data(), m_width, m_height, m_scanlines, m_file))
+			std::cout << "CAPTURE: Saved " << name << "\n";
+		else
+			std::cout << "ERROR::CAPTURE: Can't write " << name << "\n";
+	}
+}
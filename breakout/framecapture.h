@@ -0,0 +1,120 @@
+#ifndef _framecapture_HG_
+#define _framecapture_HG_
+
+#include <glad/glad.h>
+
+#include <globject/globject.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum CaptureFormat
+{
+	CAPTURE_PNG,	// one numbered .png per frame in a directory
+	CAPTURE_RAW		// every frame appended to one file as raw RGB24, top row first
+};
+
+// Reads finished frames back without stalling the frame loop. EndFrame
+// issues glReadPixels into one of SLOTS pixel pack buffers and fences it;
+// the copy out of a buffer happens SLOTS - 1 frames later, once its fence
+// has signalled, so the CPU never waits on the GPU to catch up. Copies are
+// handed to an encoder thread that writes them out.
+//
+// Frame memory is allocated up front (QUEUE frames), a frame loop that
+// captures doesn't touch the heap. When the encoder falls behind and every
+// frame is queued the new frame is dropped and counted rather than
+// slowing the game down. Works the same on a software GL (llvmpipe).
+class FrameCapture
+{
+public:
+	static const GLuint SLOTS = 3;
+	static const GLuint QUEUE = 8;
+
+	// Needs a current context, width and height are the framebuffer's
+	FrameCapture(GLuint width, GLuint height);
+	// Collects the readbacks still in flight, lets the encoder finish and
+	// joins it. Needs the context to still be current.
+	~FrameCapture();
+
+	// Every following frame is written to path, a directory for CAPTURE_PNG
+	// (which has to exist) or a file for CAPTURE_RAW
+	bool StartRecording(const std::string& path, CaptureFormat format);
+	void StopRecording();
+	bool Recording() const { return m_recording; }
+	// The next frame is also written to screenshot_<n>.png in the working directory
+	void Screenshot();
+
+	// Call after the frame is drawn, before the swap. framebuffer is what to
+	// read, 0 for the back buffer.
+	void EndFrame(GLuint framebuffer);
+
+	GLuint Captured() const { return m_captured; }
+	GLuint Dropped() const { return m_dropped; }
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+private:
+	// What a frame is written as, set when its readback is issued
+	struct Request
+	{
+		bool	Record;
+		GLuint	Frame;			// numbers the PNG in a recording
+		GLuint	Screenshot;		// 0 for none, otherwise the file number
+	};
+
+	struct Slot
+	{
+		GLBuffer	Buffer;
+		GLsync		Fence;
+		Request		Pending;
+	};
+
+	GLuint			m_width;
+	GLuint			m_height;
+	Slot			m_slots[SLOTS];
+	GLuint			m_nextSlot;		// oldest in flight once all are busy
+	GLuint			m_inFlight;
+
+	bool			m_recording;
+	GLuint			m_recordedFrames;
+	bool			m_screenshotRequested;
+	GLuint			m_screenshots;
+	GLuint			m_captured;
+	GLuint			m_dropped;
+
+	// Shared with the encoder thread, everything below is guarded by m_mutex
+	std::mutex					m_mutex;
+	std::condition_variable		m_wake;
+	std::condition_variable		m_idle;
+	std::vector<std::vector<unsigned char>> m_frames;		// QUEUE frames of RGBA
+	Request						m_requests[QUEUE];
+	GLuint						m_free[QUEUE];				// stack of unused frames
+	GLuint						m_freeCount;
+	GLuint						m_queue[QUEUE];				// ring of frames to encode
+	GLuint						m_queueHead;
+	GLuint						m_queueCount;
+	bool						m_encoding;					// the encoder holds a frame
+	bool						m_stop;
+	CaptureFormat				m_format;
+	std::string					m_path;
+	FILE*						m_raw;
+	std::thread					m_encoder;
+
+	// Scratch only the encoder thread touches
+	std::vector<unsigned char>	m_rgb;
+	std::vector<unsigned char>	m_scanlines;
+	std::vector<unsigned char>	m_file;
+
+	// Copies out every readback whose fence has signalled, oldest first. The
+	// oldest waitFor readbacks are waited on if they haven't finished yet.
+	void collect(GLuint waitFor);
+	void encodeLoop();
+	void encode(const unsigned char* rgba, const Request& request);
+};
+
+#endif
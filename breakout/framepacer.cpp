@@ -0,0 +1,183 @@
+#include "framepacer.h"
+#include "globals.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#include <mmsystem.h>	// timeBeginPeriod, glad pulls in windows.h with WIN32_LEAN_AND_MEAN
+	#pragma comment(lib, "winmm.lib")
+#endif
+
+// Sleeping is only trusted up to this close to the deadline, the rest is spun
+const std::chrono::microseconds SPIN_THRESHOLD(1500);
+
+// A frame counts as a stutter if it took this much longer than the median
+const double STUTTER_FACTOR = 1.5;
+
+const unsigned int FramePacer::BUCKET_US;
+const unsigned int FramePacer::BUCKETS;
+
+FramePacer::FramePacer(PresentMode mode, float targetFps)
+	: m_mode(mode)
+	, m_frameBudget(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps)))
+	, m_first(true)
+	, m_fence(0)
+	, m_histogram(new unsigned int[BUCKETS])
+	, m_frameCount(0)
+	, m_maxMs(0.0)
+	, m_totalMs(0.0)
+{
+	std::fill(m_histogram, m_histogram + BUCKETS, 0u);
+#ifdef _WIN32
+	// Default scheduler granularity is ~15ms which makes sleep useless for pacing
+	timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer()
+{
+	delete[] m_histogram;
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::Init(void)
+{
+	bool vsync = m_mode == PRESENT_VSYNC || m_mode == PRESENT_LOW_LATENCY;
+	// A headless pbuffer is never presented, there is nothing to sync to
+	if (!Headless::Active())
+		glfwSwapInterval(vsync ? 1 : 0);
+	std::cout << "Present mode: " << ModeName(m_mode) << "\n";
+}
+
+void FramePacer::BeginFrame(void)
+{
+	if (m_mode == PRESENT_CAPPED)
+	{
+		waitForDeadline();
+	}
+	else if (m_mode == PRESENT_LOW_LATENCY && m_fence)
+	{
+		// Don't start sampling input for the next frame until the GPU has finished
+		// the last one: at most one frame is ever in flight
+		glClientWaitSync(m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(m_fence);
+		m_fence = 0;
+	}
+
+	Clock::time_point now = Clock::now();
+	if (!m_first)
+		record(std::chrono::duration<double, std::milli>(now - m_lastFrame).count());
+	m_first = false;
+	m_lastFrame = now;
+}
+
+void FramePacer::EndFrame(void)
+{
+	if (m_mode == PRESENT_LOW_LATENCY)
+		m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FramePacer::Shutdown(void)
+{
+	if (m_fence)
+		glDeleteSync(m_fence);
+	m_fence = 0;
+}
+
+void FramePacer::waitForDeadline(void)
+{
+	Clock::time_point now = Clock::now();
+	if (m_first || now - m_nextFrame > m_frameBudget)
+	{
+		// First frame or we fell more than a frame behind: don't try to catch up
+		m_nextFrame = now + m_frameBudget;
+		return;
+	}
+
+	// Sleep in small steps while there is plenty of time, then spin the rest
+	while (m_nextFrame - now > SPIN_THRESHOLD)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		now = Clock::now();
+	}
+	while (Clock::now() < m_nextFrame)
+		std::this_thread::yield();
+
+	m_nextFrame += m_frameBudget;
+}
+
+void FramePacer::record(double ms)
+{
+	unsigned int bucket = std::min((unsigned int)(ms * 1000.0 / BUCKET_US), BUCKETS - 1);
+	++m_histogram[bucket];
+	++m_frameCount;
+	m_maxMs = std::max(m_maxMs, ms);
+	m_totalMs += ms;
+}
+
+double FramePacer::percentile(double fraction) const
+{
+	unsigned long long target = (unsigned long long)(fraction * m_frameCount);
+	unsigned long long seen = 0;
+	for (unsigned int i = 0; i < BUCKETS; ++i)
+	{
+		seen += m_histogram[i];
+		if (seen > target)
+			return (i + 0.5) * BUCKET_US / 1000.0;
+	}
+	return m_maxMs;
+}
+
+void FramePacer::Report(void) const
+{
+	if (m_frameCount == 0)
+		return;
+
+	double median = percentile(0.5);
+	unsigned int firstStutter = std::min((unsigned int)(median * STUTTER_FACTOR * 1000.0 / BUCKET_US) + 1, BUCKETS);
+	unsigned long long stutters = 0;
+	for (unsigned int i = firstStutter; i < BUCKETS; ++i)
+		stutters += m_histogram[i];
+
+	std::cout << "------------------------------------------------\n"
+		<< "Frame times (" << ModeName(m_mode) << ", " << m_frameCount << " frames, "
+		<< m_frameCount / (m_totalMs / 1000.0) << " fps average)\n"
+		<< "  p50 " << median << " ms\n"
+		<< "  p95 " << percentile(0.95) << " ms\n"
+		<< "  p99 " << percentile(0.99) << " ms\n"
+		<< "  max " << m_maxMs << " ms\n"
+		<< "  stutters (> " << STUTTER_FACTOR << "x median) " << stutters << "\n"
+		<< "------------------------------------------------\n";
+}
+
+bool FramePacer::ParseMode(const char* name, PresentMode& mode)
+{
+	const PresentMode modes[] = { PRESENT_VSYNC, PRESENT_UNCAPPED, PRESENT_CAPPED, PRESENT_LOW_LATENCY };
+	for (PresentMode candidate : modes)
+	{
+		if (strcmp(name, ModeName(candidate)) == 0)
+		{
+			mode = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* FramePacer::ModeName(PresentMode mode)
+{
+	switch (mode)
+	{
+	case PRESENT_VSYNC:			return "vsync";
+	case PRESENT_UNCAPPED:		return "uncapped";
+	case PRESENT_CAPPED:		return "cap";
+	case PRESENT_LOW_LATENCY:	return "lowlatency";
+	}
+	return "unknown";
+}
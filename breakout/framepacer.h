@@ -0,0 +1,64 @@
+#ifndef _framepacer_HG_
+#define _framepacer_HG_
+
+#include <glad/glad.h>
+
+#include <chrono>
+
+enum PresentMode
+{
+	PRESENT_VSYNC,			// swap interval 1, the driver decides how far the CPU may run ahead
+	PRESENT_UNCAPPED,		// swap interval 0, no limiter
+	PRESENT_CAPPED,			// swap interval 0, sleep then spin up to a fixed frame rate
+	PRESENT_LOW_LATENCY		// swap interval 1, wait for the previous frame's fence before sampling input
+};
+
+// Paces the main loop according to a PresentMode and keeps frame time statistics.
+// BeginFrame goes at the very top of the loop (before input is polled) and
+// EndFrame right after the buffers are swapped.
+class FramePacer
+{
+public:
+	FramePacer(PresentMode mode, float targetFps);
+	~FramePacer();
+
+	// Applies the swap interval, needs a current GL context
+	void Init(void);
+	void BeginFrame(void);
+	void EndFrame(void);
+	// Releases the pending fence, call while the context is still current
+	void Shutdown(void);
+
+	// Prints p50/p95/p99/max frame times and the number of stutters
+	void Report(void) const;
+
+	static bool ParseMode(const char* name, PresentMode& mode);
+	static const char* ModeName(PresentMode mode);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// Frame times land in 10us buckets up to 250ms, anything longer in the last
+	// one. Percentiles come out of the histogram so recording never allocates,
+	// however long the session.
+	static const unsigned int BUCKET_US = 10;
+	static const unsigned int BUCKETS = 25000;
+
+	PresentMode m_mode;
+	Clock::duration m_frameBudget;
+	Clock::time_point m_nextFrame;
+	Clock::time_point m_lastFrame;
+	bool m_first;
+	GLsync m_fence;
+
+	unsigned int* m_histogram;
+	unsigned long long m_frameCount;
+	double m_maxMs;
+	double m_totalMs;
+
+	void waitForDeadline(void);
+	void record(double ms);
+	double percentile(double fraction) const;
+};
+
+#endif
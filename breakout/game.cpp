@@ -1,8 +1,24 @@
 #include "game.h"
 
 #include <algorithm>
-#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 #include "resourcemanager.h"
+#include "systems.h"
+#include "framearena.h"
+
+#include <globject/globject.h>
+#include <memtrack/memtrack.h>
+#include <texupload/texupload.h>
+#include <trace/trace.h>
+
+namespace
+{
+	// Player 2's paddle is tinted so the two can be told apart
+	const glm::vec3 PADDLE_COLORS[MAX_PLAYERS] = { glm::vec3(1.0f), glm::vec3(0.6f, 0.8f, 1.0f) };
+}
 
 Game::Game(GLuint width, GLuint height)
 	: State(GAME_MENU)
@@ -11,87 +27,211 @@ Game::Game(GLuint width, GLuint height)
 	, Height(height)
 	, CurrentLevel(0)
 	, Lives(3)
+	, Players(1)
+	, Score()
+	, RollbackFrames(0)
+	, ResimMs(0.0f)
+	, m_paddles()
+	, m_lastInputs()
+	, m_resimulating(false)
+	, m_ballCount(1)
 {
 }
 
 Game::~Game()
+{
+	this->Shutdown();
+}
+
+void Game::Shutdown()
 {
 	delete m_renderer;
-	delete m_player;
-	delete m_ball;
+	delete m_particles;
 	delete m_particleGenerator;
 	delete m_effects;
 	delete m_text;
+	delete m_hud;
+	delete m_stream;
+	FrameArena::Shutdown();
+	TextureUploads::Shutdown();
+	Session.Stop();
+	m_renderer = nullptr;
+	m_particles = nullptr;
+	m_particleGenerator = nullptr;
+	m_effects = nullptr;
+	m_text = nullptr;
+	m_hud = nullptr;
+	m_stream = nullptr;
 }
 
-void Game::Init(void)
+void Game::Init(const LaunchOptions& options)
 {
-	// Load shaders
-	ResourceManager::LoadShader("shaders/vert_sprite.glsl", "shaders/frag_sprite.glsl", nullptr, "sprite");
-	ResourceManager::LoadShader("shaders/vert_particle.glsl", "shaders/frag_particle.glsl", nullptr, "particle");
-	ResourceManager::LoadShader("shaders/vert_post_processing.glsl", "shaders/frag_post_processing.glsl", nullptr, "postprocessing");
+	TRACE_ZONE("Game::Init");
+	GLObjects::SetBudget((size_t)options.VramBudget * 1024 * 1024);
+	TextureUploads::Init((size_t)options.UploadBudget * 1024);
+
+	// Load shaders, all of them are submitted before waiting on any
+	ShaderHandle particleShader = ResourceManager::LoadShader("shaders/vert_particle.glsl", "shaders/frag_particle.glsl", nullptr, "particle");
+	ShaderHandle postShader = ResourceManager::LoadShader("shaders/vert_post_processing.glsl", "shaders/frag_post_processing.glsl", nullptr, "postprocessing");
+	ShaderHandle spriteShader = ResourceManager::LoadShader("shaders/vert_sprite_batch.glsl", "shaders/frag_sprite_batch.glsl", nullptr, "sprite_batch");
+	ShaderHandle textShader = ResourceManager::LoadShader("shaders/vert_text.glsl", "shaders/frag_text.glsl", nullptr, "text");
+	ResourceManager::FinishShaders();
 
 	// Configure shaders
 	glm::mat4 projection = glm::ortho(0.0f, static_cast<GLfloat>(this->Width),
 		static_cast<GLfloat>(this->Height), 0.0f, -1.0f, 1.0f);
-	ResourceManager::GetShader("sprite").SetInteger("image", 0, true);
-	ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
-	ResourceManager::GetShader("particle").SetInteger("sprite", 0, true);
-	ResourceManager::GetShader("particle").SetMatrix4("projection", projection);
+	ResourceManager::GetShader(spriteShader).SetInteger("image", 0, true);
+	ResourceManager::GetShader(spriteShader).SetMatrix4("projection", projection);
+	ResourceManager::GetShader(particleShader).SetInteger("sprite", 0, true);
+	ResourceManager::GetShader(particleShader).SetMatrix4("projection", projection);
 	
 	// Load textures
-	ResourceManager::LoadTexture("textures/background.jpg", GL_FALSE, "background");
-	ResourceManager::LoadTexture("textures/awesomeface.png", GL_TRUE, "face");
+	m_backgroundTexture = ResourceManager::LoadTexture("textures/background.jpg", GL_FALSE, "background");
+	m_ballTexture = ResourceManager::LoadTexture("textures/awesomeface.png", GL_TRUE, "face");
 	ResourceManager::LoadTexture("textures/block.png", GL_FALSE, "block");
 	ResourceManager::LoadTexture("textures/block_solid.png", GL_FALSE, "block_solid");
-	ResourceManager::LoadTexture("textures/paddle.png", GL_TRUE, "paddle");
-	ResourceManager::LoadTexture("textures/particle.png", GL_TRUE, "particle");
-	ResourceManager::LoadTexture("textures/powerup_speed.png", GL_TRUE, "powerup_speed");
-	ResourceManager::LoadTexture("textures/powerup_sticky.png", GL_TRUE, "powerup_sticky");
-	ResourceManager::LoadTexture("textures/powerup_increase.png", GL_TRUE, "powerup_increase");
-	ResourceManager::LoadTexture("textures/powerup_confuse.png", GL_TRUE, "powerup_confuse");
-	ResourceManager::LoadTexture("textures/powerup_chaos.png", GL_TRUE, "powerup_chaos");
-	ResourceManager::LoadTexture("textures/powerup_passthrough.png", GL_TRUE, "powerup_passthrough");
+	TextureHandle paddleTexture = ResourceManager::LoadTexture("textures/paddle.png", GL_TRUE, "paddle");
+	TextureHandle particleTexture = ResourceManager::LoadTexture("textures/particle.png", GL_TRUE, "particle");
+	m_powerUpTextures[POWERUP_SPEED] = ResourceManager::LoadTexture("textures/powerup_speed.png", GL_TRUE, "powerup_speed");
+	m_powerUpTextures[POWERUP_STICKY] = ResourceManager::LoadTexture("textures/powerup_sticky.png", GL_TRUE, "powerup_sticky");
+	m_powerUpTextures[POWERUP_PAD_SIZE_INCREASE] = ResourceManager::LoadTexture("textures/powerup_increase.png", GL_TRUE, "powerup_increase");
+	m_powerUpTextures[POWERUP_CONFUSE] = ResourceManager::LoadTexture("textures/powerup_confuse.png", GL_TRUE, "powerup_confuse");
+	m_powerUpTextures[POWERUP_CHAOS] = ResourceManager::LoadTexture("textures/powerup_chaos.png", GL_TRUE, "powerup_chaos");
+	m_powerUpTextures[POWERUP_PASS_THROUGH] = ResourceManager::LoadTexture("textures/powerup_passthrough.png", GL_TRUE, "powerup_passthrough");
 
 	// Set render specific controls
-	m_renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"));
-	m_particleGenerator = new ParticleGenerator(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), 500);
-	m_effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), this->Width, this->Height);
-	m_text = new TextRenderer(this->Width, this->Height);
+	FrameArena::Init(FRAME_ARENA_BYTES);
+	m_stream = new StreamBuffer(STREAM_BYTES_PER_FRAME);
+	m_renderer = new SpriteRenderer(ResourceManager::GetShader(spriteShader), *m_stream);
+	m_particles = new ParticleSystem(ResourceManager::GetShader(particleShader), *m_stream, options.ParticleBudget);
+	m_particles->Load("particles/emitters.txt");
+
+	// A replay brings the settings it was recorded with, the simulation must start out identical
+	ReplaySettings settings = { options.Seed, options.Balls, this->Width, this->Height, 0.0 };
+	if (options.Replay && this->Session.StartPlayback(options.Replay))
+	{
+		settings = this->Session.Settings();
+		if (settings.Width != this->Width || settings.Height != this->Height)
+			std::cout << "ERROR::GAME: Replay was recorded at " << settings.Width << "x" << settings.Height << "\n";
+	}
+	m_random.Seed(settings.Seed);
+	// Particles stay on rand(), seeding it makes their shapes repeat as well
+	srand(settings.Seed);
+
+	m_trailEmitter = m_particles->Find("ball_trail");
+	m_burstEmitter = m_particles->Find("brick_burst");
+	m_powerUpEmitter = m_particles->Find("powerup_trail");
+	m_trailCarry = 0.0f;
+	m_particleGenerator = nullptr;
+	if (options.Particles == PARTICLES_GPU)
+	{
+		m_particleGenerator = new ParticleGenerator(ResourceManager::GetShader(particleShader), ResourceManager::GetTexture(particleTexture),
+			options.ParticleCount, *m_stream, PARTICLES_GPU);
+		// Bigger trails spawn proportionally faster than the 500 particle CPU trail
+		m_trailRate = m_trailEmitter >= 0 ? m_particles->Descriptor(m_trailEmitter).Rate * options.ParticleCount / 500.0f : 0.0f;
+	}
+	m_effects = new PostProcessor(ResourceManager::GetShader(postShader), this->Width, this->Height);
+	m_text = new TextRenderer(ResourceManager::GetShader(textShader), this->Width, this->Height, *m_stream);
 	m_text->Load("fonts/OCRAEXT.TTF", 24);
+	m_hud = new PerfHud();
+	m_inputTime = this->Session.Playing() ? settings.StartTime : GameTime();
+
+
+	// Load levels, everything from here on is level memory
+	MEMTRACK_SCOPE(MEM_LEVEL);
+	const GLchar* levelFiles[] = { "levels/one.txt", "levels/two.txt", "levels/three.txt", "levels/four.txt" };
+	size_t maxTiles = 0;
+	for (const GLchar* file : levelFiles)
+	{
+		GameLevel level;
+		level.Load(file);
+		size_t tiles = 0;
+		for (const std::vector<GLuint>& row : level.Tiles)
+			tiles += row.size();
+		maxTiles = std::max(maxTiles, tiles);
+		this->Levels.push_back(level);
+	}
+	// Sized up front so spawning during play never grows the pools
+	this->Players = options.Versus >= 0 ? MAX_PLAYERS : 1;
+	m_registry.Reserve(maxTiles + (options.Balls + 1) * this->Players + SPARE_ENTITIES);
+	m_quickSave.reserve(this->StateCapacity());
+	this->ResetLevel();
+
+	// Players
+	for (GLuint player = 0; player < this->Players; ++player)
+	{
+		m_paddles[player] = m_registry.Create();
+		m_registry.Add(m_paddles[player], Transform());
+		m_registry.Add(m_paddles[player], Sprite{ paddleTexture, PADDLE_COLORS[player], 0.0f, LAYER_PADDLE });
+		m_registry.Add(m_paddles[player], Paddle{ player });
+	}
+	// Balls
+	m_ballCount = settings.Balls;
+	this->ResetPlayer();
+
+	if (options.RecordInput)
+	{
+		settings.StartTime = m_inputTime;
+		this->Session.StartRecording(options.RecordInput, settings);
+	}
 
+	// Init is the loading screen, the first frame gets every texture whole.
+	// Anything loaded later streams in under the per frame budget.
+	TextureUploads::Flush();
+}
 
-	// Load levels
-	GameLevel one;
-	GameLevel two;
-	GameLevel three;
-	GameLevel four;
-	one.Load("levels/one.txt", this->Width, this->Height * 0.5);
-	two.Load("levels/two.txt", this->Width, this->Height * 0.5);
-	three.Load("levels/three.txt", this->Width, this->Height * 0.5);
-	four.Load("levels/four.txt", this->Width, this->Height * 0.5);
-	this->Levels.push_back(one);
-	this->Levels.push_back(two);
-	this->Levels.push_back(three);
-	this->Levels.push_back(four);
-
-	// Player
-	glm::vec2 playerPos = glm::vec2(this->Width / 2 - PLAYER_SIZE.x / 2, this->Height - PLAYER_SIZE.y);
-	m_player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::GetTexture("paddle"));
-	// Ball
-	glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2 - BALL_RADIUS, -BALL_RADIUS * 2);
-	m_ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, ResourceManager::GetTexture("face"));
+void Game::BeginFrame(GLfloat deltaTime)
+{
+	FrameArena::Reset();
+	TextureUploads::Pump();
+	m_hud->BeginFrame(deltaTime);
 }
 
 void Game::Update(GLfloat deltaTime)
 {
-	m_ball->Move(deltaTime, this->Width);
+	TRACE_ZONE("Game::Update");
+
+	MovementSystem(m_registry, deltaTime, this->Width);
 
 	this->DoCollisions();
 
-	m_particleGenerator->Update(deltaTime, *m_ball, 2, glm::vec2(m_ball->Radius / 2));
+	if (m_resimulating)
+	{
+		// Trails were emitted when this tick first ran
+	}
+	else if (m_particleGenerator)
+	{
+		// The GPU trail has a single emitter, it follows the first ball
+		m_trailCarry += m_trailRate * deltaTime;
+		GLuint spawn = (GLuint)m_trailCarry;
+		m_trailCarry -= spawn;
+		glm::vec2 position(0.0f);
+		glm::vec2 velocity(0.0f);
+		ComponentPool<Ball>& balls = m_registry.Pool<Ball>();
+		if (balls.Size() > 0)
+		{
+			Entity ball = balls.EntityAt(0);
+			position = m_registry.Get<Transform>(ball)->Position + glm::vec2(balls.At(0).Radius / 2);
+			velocity = m_registry.Get<Velocity>(ball)->Value;
+		}
+		else
+		{
+			spawn = 0;
+		}
+		m_particleGenerator->Update(deltaTime, position, velocity, spawn);
+	}
+	else
+	{
+		m_registry.Each<Ball, Transform, Velocity>([&](Entity, Ball& ball, Transform& transform, Velocity& velocity)
+		{
+			m_particles->Emit(m_trailEmitter, ball.TrailCarry, deltaTime,
+				transform.Position + glm::vec2(ball.Radius / 2), velocity.Value);
+		});
+	}
 
 	this->UpdatePowerUps(deltaTime);
+	if (!m_resimulating)
+		m_particles->Update(deltaTime);
 
 	// Reduce the shake time
 	if (m_shakeTime > 0.0f)
@@ -103,8 +243,16 @@ void Game::Update(GLfloat deltaTime)
 		}
 	}
 	
-	// loss condition - did ball reach bottom edge?
-	if (m_ball->Position.y >= this->Height)
+	// Balls that reach the bottom edge are gone
+	GLfloat height = (GLfloat)this->Height;
+	m_registry.Each<Ball, Transform>([&](Entity entity, Ball&, Transform& transform)
+	{
+		if (transform.Position.y >= height)
+			m_registry.Destroy(entity);
+	});
+
+	// loss condition - no balls left
+	if (m_registry.Pool<Ball>().Size() == 0)
 	{
 		--this->Lives;
 
@@ -118,7 +266,7 @@ void Game::Update(GLfloat deltaTime)
 	}
 	
 	// Win condition
-	if (this->State == GAME_ACTIVE && this->Levels[this->CurrentLevel].IsCompleted())
+	if (this->State == GAME_ACTIVE && this->bricksRemaining() == 0)
 	{
 		this->ResetLevel();
 		this->ResetPlayer();
@@ -129,378 +277,837 @@ void Game::Update(GLfloat deltaTime)
 
 void Game::Render(void)
 {
+	TRACE_ZONE("Game::Render");
+
+	m_stream->BeginFrame();
+
 	// Effects render 
 	if (this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_WIN)
 	{
 		m_effects->BeginRender();	// begin rendering to postprocessing quad
-			m_renderer->DrawSprite(ResourceManager::GetTexture("background"),
+			m_renderer->DrawSprite(ResourceManager::GetTexture(m_backgroundTexture),
 				glm::vec2(0, 0), glm::vec2(this->Width, this->Height), 0.0f);
 
-			this->Levels[this->CurrentLevel].Draw(*m_renderer);
-			m_player->Draw(*m_renderer);
-
-			for (PowerUp& powerUp : this->PowerUps)
-				if (!powerUp.Destroyed)
-					powerUp.Draw(*m_renderer);
+			RenderSystem(m_registry, *m_renderer, LAYER_BRICKS);
+			RenderSystem(m_registry, *m_renderer, LAYER_PADDLE);
+			RenderSystem(m_registry, *m_renderer, LAYER_POWERUPS);
+			m_renderer->Flush();
 
-			m_particleGenerator->Draw();
-			m_ball->Draw(*m_renderer);
+			if (m_particleGenerator)
+				m_particleGenerator->Draw();
+			m_particles->Draw();
+			RenderSystem(m_registry, *m_renderer, LAYER_BALLS);
+			m_renderer->Flush();
 		// End rendering to postprocessing quad
 		m_effects->EndRender();	
 		// Render postprocessing quad
-		m_effects->Render(glfwGetTime());
+		m_effects->Render(GameTime());
 		// Render text (don't include in post processing)
-		std::stringstream ss; 
-		ss << this->Lives;
-		m_text->RenderText("Lives:" + ss.str(), 5.0f, 5.0f, 1.0f);
+		char lives[16];
+		snprintf(lives, sizeof(lives), "Lives:%u", this->Lives);
+		m_text->RenderText(lives, 5.0f, 5.0f, 1.0f);
+		if (this->Players > 1)
+		{
+			char score[32];
+			snprintf(score, sizeof(score), "P1:%u  P2:%u", this->Score[0], this->Score[1]);
+			m_text->RenderText(score, this->Width - 220.0f, 5.0f, 1.0f);
+		}
 	}
 	if (this->State == GAME_MENU)
 	{
 		m_text->RenderText("Press ENTER to start", 250.0f, this->Height / 2, 1.0f);
-		m_text->RenderText("Press W or S to select level", 245.0f, this->Height / 2 + 20.0f, 0.75f);
+		if (this->Players == 1)
+			m_text->RenderText("Press W or S to select level", 245.0f, this->Height / 2 + 20.0f, 0.75f);
 	}
 	if (this->State == GAME_WIN)
 	{
-		m_text->RenderText("You WON!!!!", 320.0f, this->Height / 2 - 20.0f, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+		if (this->Players == 1)
+		{
+			m_text->RenderText("You WON!!!!", 320.0f, this->Height / 2 - 20.0f, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+		}
+		else
+		{
+			char winner[48];
+			if (this->Score[0] == this->Score[1])
+				snprintf(winner, sizeof(winner), "Draw, %u all", this->Score[0]);
+			else
+				snprintf(winner, sizeof(winner), "Player %u WON %u to %u", this->Score[0] > this->Score[1] ? 1 : 2,
+					std::max(this->Score[0], this->Score[1]), std::min(this->Score[0], this->Score[1]));
+			m_text->RenderText(winner, 250.0f, this->Height / 2 - 20.0f, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+		}
 		m_text->RenderText("Press ENTER to retry or ESC to quit", 130.0f, this->Height / 2, 1.0f, glm::vec3(1.0f, 1.0f, 1.0f));
 	}
+
+	// Performance overlay goes on top of everything and isn't part of its own timings
+	m_hud->EndFrame();
+	if (m_hud->Visible)
+	{
+		HudCounters counters;
+		counters.LiveParticles = m_particles->LiveCount() + (m_particleGenerator ? m_particleGenerator->LiveCount() : 0);
+		counters.ActivePowerUps = 0;
+		m_registry.Each<PowerUp>([&](Entity, PowerUp& powerUp)
+		{
+			if (powerUp.Activated)
+				++counters.ActivePowerUps;
+		});
+		counters.BricksRemaining = this->bricksRemaining();
+		counters.RollbackFrames = this->RollbackFrames;
+		counters.ResimMs = this->ResimMs;
+		m_hud->Draw(*m_renderer, *m_text, counters);
+	}
+
+	m_stream->EndFrame();
+}
+
+void Game::ProcessInput(void)
+{
+	TRACE_ZONE("Game::ProcessInput");
+
+	this->consumeInput(GameTime());
+
+	// Holding space keeps releasing the ball, even off a sticky paddle. In
+	// versus that's INPUT_LAUNCH, applied by Tick.
+	if (this->State == GAME_ACTIVE && this->Players == 1 && this->Keys[GLFW_KEY_SPACE])
+	{
+		m_registry.Each<Ball>([](Entity, Ball& ball) { ball.Stuck = false; });
+	}
+}
+
+void Game::LateLatchInput(void)
+{
+	TRACE_ZONE("Game::LateLatchInput");
+
+	this->consumeInput(GameTime());
+
+	// The input above was the last thing to change the simulation this tick
+	if (this->Session.Recording() || this->Session.Playing())
+		this->Session.EndTick(this->HashState());
+}
+
+void Game::consumeInput(double until)
+{
+	until = this->Session.BeginInput(until);
+	InputEvent event;
+	while (this->nextInput(until, event))
+	{
+		// Move with the keys as they were up to this event, then apply it
+		this->movePaddle(event.Time);
+		this->handleKeyEvent(event);
+	}
+	this->movePaddle(until);
+}
+
+bool Game::nextInput(double until, InputEvent& event)
+{
+	if (this->Session.Playing())
+	{
+		// The keyboard is ignored during playback, it is drained so the queue never fills
+		InputEvent live;
+		while (this->Input.Pop(live))
+		{
+		}
+		return this->Session.NextEvent(event);
+	}
+	if (!this->Input.Peek(event) || event.Time > until)
+		return false;
+	this->Input.Pop(event);
+	this->Session.RecordEvent(event);
+	return true;
 }
 
-void Game::ProcessInput(GLfloat deltaTime)
+void Game::handleKeyEvent(const InputEvent& event)
 {
+	if (event.Key < 0 || event.Key >= 1024)
+		return;
+
+	if (event.Action == GLFW_RELEASE)
+	{
+		this->Keys[event.Key] = GL_FALSE;
+		return;
+	}
+	if (event.Action != GLFW_PRESS)
+		return;
+
+	this->Keys[event.Key] = GL_TRUE;
+
+	// F3 toggles the performance overlay in every state
+	if (event.Key == GLFW_KEY_F3)
+	{
+		m_hud->Visible = !m_hud->Visible;
+	}
+	// F4 lists every live GL object and, if it's tracked, memory per subsystem
+	else if (event.Key == GLFW_KEY_F4)
+	{
+		GLObjects::Report("live");
+		MEMTRACK_REPORT("live");
+	}
+	// F5 quick-saves, F9 goes back to the quick-save with the keyboard as it is now
+	else if (event.Key == GLFW_KEY_F5 && this->Players == 1)
+	{
+		this->SaveState(m_quickSave);
+	}
+	else if (event.Key == GLFW_KEY_F9 && this->Players == 1 && !m_quickSave.empty())
+	{
+		GLboolean keys[1024];
+		std::copy(this->Keys, this->Keys + 1024, keys);
+		double inputTime = m_inputTime;
+		this->LoadState(m_quickSave);
+		std::copy(keys, keys + 1024, this->Keys);
+		m_inputTime = inputTime;
+		return;
+	}
+
+	// Versus state only changes in Tick, from both players' input
+	if (this->Players > 1)
+		return;
+
 	if (this->State == GAME_MENU)
 	{
-		if (this->Keys[GLFW_KEY_ENTER] && !this->KeysProcessed[GLFW_KEY_ENTER])
+		if (event.Key == GLFW_KEY_ENTER)
 		{
-			this->State = GAME_ACTIVE;
-			this->KeysProcessed[GLFW_KEY_ENTER] = GL_TRUE;
+			this->startGame();
 		}
-		if (this->Keys[GLFW_KEY_W] && !this->KeysProcessed[GLFW_KEY_W])
+		else if (event.Key == GLFW_KEY_W)
 		{
-			this->CurrentLevel = (this->CurrentLevel + 1) % 4;
-			this->KeysProcessed[GLFW_KEY_W] = GL_TRUE;
+			this->CurrentLevel = (this->CurrentLevel + 1) % this->Levels.size();
+			this->ResetLevel();
 		}
-
-		if (this->Keys[GLFW_KEY_S] && !this->KeysProcessed[GLFW_KEY_S])
+		else if (event.Key == GLFW_KEY_S)
 		{
 			if (this->CurrentLevel > 0)
 				--this->CurrentLevel;
 			else
-				this->CurrentLevel = 3;
-		
-			this->KeysProcessed[GLFW_KEY_S] = GL_TRUE;
+				this->CurrentLevel = (GLuint)this->Levels.size() - 1;
+			this->ResetLevel();
 		}
 	}
-	if (this->State == GAME_WIN)
+	else if (this->State == GAME_WIN)
 	{
-		if (this->Keys[GLFW_KEY_ENTER])
+		if (event.Key == GLFW_KEY_ENTER)
 		{
-			this->KeysProcessed[GLFW_KEY_ENTER] = GL_TRUE;
 			m_effects->Chaos = false;
 			this->State = GAME_MENU;
 		}
 	}
-	if (this->State == GAME_ACTIVE)
+	else if (this->State == GAME_ACTIVE)
+	{
+		if (event.Key == GLFW_KEY_SPACE)
+		{
+			m_registry.Each<Ball>([](Entity, Ball& ball) { ball.Stuck = false; });
+		}
+	}
+}
+
+void Game::movePaddle(double until)
+{
+	GLfloat dt = (GLfloat)(until - m_inputTime);
+	if (dt <= 0.0f)
+		return;
+	m_inputTime = until;
+
+	if (this->State != GAME_ACTIVE || this->Players > 1)
+		return;
+
+	GLfloat velocity = PLAYER_VELOCITY * dt;
+	GLfloat direction = 0.0f;
+	if (this->Keys[GLFW_KEY_A])
+		direction -= 1.0f;
+	if (this->Keys[GLFW_KEY_D])
+		direction += 1.0f;
+	if (direction == 0.0f)
+		return;
+
+	this->moveBy(0, direction * velocity);
+}
+
+void Game::moveBy(GLuint player, GLfloat distance)
+{
+	Transform& paddle = *m_registry.Get<Transform>(m_paddles[player]);
+	GLfloat oldX = paddle.Position.x;
+	paddle.Position.x = glm::clamp(oldX + distance, 0.0f, this->Width - paddle.Size.x);
+	GLfloat moved = paddle.Position.x - oldX;
+	m_registry.Each<Ball, Transform>([moved, player](Entity, Ball& ball, Transform& transform)
 	{
-		GLfloat velocity = PLAYER_VELOCITY * deltaTime;
+		if (ball.Stuck && ball.Owner == player)
+			transform.Position.x += moved;
+	});
+}
+
+void Game::startGame(void)
+{
+	this->State = GAME_ACTIVE;
+	std::fill(this->Score, this->Score + MAX_PLAYERS, 0u);
+}
+
+void Game::Tick(const PlayerInput* inputs, GLfloat deltaTime, bool resimulating)
+{
+	TRACE_ZONE("Game::Tick");
+
+	m_resimulating = resimulating;
+	for (GLuint player = 0; player < this->Players; ++player)
+	{
+		PlayerInput input = inputs[player];
+		bool start = (input & INPUT_START) && !(m_lastInputs[player] & INPUT_START);
+		m_lastInputs[player] = input;
 
-		if (this->Keys[GLFW_KEY_A])
+		if (start && this->State == GAME_MENU)
 		{
-			if (m_player->Position.x >= 0)
-			{
-				m_player->Position.x -= velocity;
-				if (m_ball->Stuck)
-				{
-					m_ball->Position.x -= velocity;
-				}
-			}
+			this->startGame();
 		}
-		if (this->Keys[GLFW_KEY_D])
+		else if (start && this->State == GAME_WIN)
 		{
-			if (m_player->Position.x <= this->Width - m_player->Size.x)
-			{
-				m_player->Position.x += velocity;
-				if (m_ball->Stuck)
-				{
-					m_ball->Position.x += velocity;
-				}
-			}
+			m_effects->Chaos = false;
+			this->State = GAME_MENU;
 		}
-		if (this->Keys[GLFW_KEY_SPACE])
+		if (this->State != GAME_ACTIVE)
+			continue;
+
+		GLfloat direction = 0.0f;
+		if (input & INPUT_LEFT)
+			direction -= 1.0f;
+		if (input & INPUT_RIGHT)
+			direction += 1.0f;
+		if (direction != 0.0f)
+			this->moveBy(player, direction * PLAYER_VELOCITY * deltaTime);
+		if (input & INPUT_LAUNCH)
 		{
-			m_ball->Stuck = false;
+			m_registry.Each<Ball>([player](Entity, Ball& ball)
+			{
+				if (ball.Owner == player)
+					ball.Stuck = false;
+			});
 		}
 	}
+	this->Update(deltaTime);
+	m_resimulating = false;
+}
+
+PlayerInput Game::LocalInput(void) const
+{
+	PlayerInput input = 0;
+	if (this->Keys[GLFW_KEY_A])
+		input |= INPUT_LEFT;
+	if (this->Keys[GLFW_KEY_D])
+		input |= INPUT_RIGHT;
+	if (this->Keys[GLFW_KEY_SPACE])
+		input |= INPUT_LAUNCH;
+	if (this->Keys[GLFW_KEY_ENTER])
+		input |= INPUT_START;
+	return input;
 }
 
 void Game::ResetLevel(void)
 {
-	if (this->CurrentLevel == 0)
+	m_registry.Each<Brick>([&](Entity entity, Brick&) { m_registry.Destroy(entity); });
+	this->Levels[this->CurrentLevel].Spawn(m_registry, this->Width, this->Height / 2);
+
+	this->Lives = 3;
+}
+
+void Game::ResetPlayer(void)
+{
+	m_registry.Each<Ball>([&](Entity entity, Ball&) { m_registry.Destroy(entity); });
+	for (GLuint player = 0; player < this->Players; ++player)
 	{
-		this->Levels[0].Load("levels/one.txt", this->Width, this->Height * 0.5);
+		// Each paddle starts in the middle of its share of the board, with its own balls
+		Transform& paddle = *m_registry.Get<Transform>(m_paddles[player]);
+		GLfloat center = this->Width * (2 * player + 1) / (2.0f * this->Players);
+		paddle.Size = PLAYER_SIZE;
+		paddle.Position = glm::vec2(center - PLAYER_SIZE.x / 2, this->Height - PLAYER_SIZE.y);
+		glm::vec2 ballPos = paddle.Position + glm::vec2(PLAYER_SIZE.x / 2 - BALL_RADIUS, -(BALL_RADIUS * 2));
+
+		for (GLuint i = 0; i < m_ballCount; ++i)
+		{
+			// Extra balls fan out over 90 degrees so they don't all fly the same path
+			GLfloat angle = m_ballCount > 1 ? glm::radians(-45.0f + 90.0f * i / (m_ballCount - 1)) : 0.0f;
+			glm::vec2 velocity(INITIAL_BALL_VELOCITY.x * cos(angle) - INITIAL_BALL_VELOCITY.y * sin(angle),
+							   INITIAL_BALL_VELOCITY.x * sin(angle) + INITIAL_BALL_VELOCITY.y * cos(angle));
+			this->spawnBall(ballPos, velocity, player);
+		}
 	}
-	else if (this->CurrentLevel == 1)
+}
+
+Entity Game::spawnBall(glm::vec2 position, glm::vec2 velocity, GLuint owner)
+{
+	Entity ball = m_registry.Create();
+	m_registry.Add(ball, Transform{ position, glm::vec2(BALL_RADIUS * 2) });
+	m_registry.Add(ball, Velocity{ velocity });
+	m_registry.Add(ball, Sprite{ m_ballTexture, glm::vec3(1.0f), 0.0f, LAYER_BALLS });
+	m_registry.Add(ball, Ball{ BALL_RADIUS, true, false, false, 0.0f, owner });
+	return ball;
+}
+
+GLuint Game::bricksRemaining(void)
+{
+	GLuint remaining = 0;
+	m_registry.Each<Brick>([&](Entity, Brick& brick)
+	{
+		if (!brick.Solid)
+			++remaining;
+	});
+	return remaining;
+}
+
+void Game::View(BoardView& view)
+{
+	const Transform& paddle = *m_registry.Get<Transform>(m_paddles[0]);
+	view.PaddlePosition = paddle.Position;
+	view.PaddleSize = paddle.Size;
+	view.Stuck = 0;
+	view.Balls = 0;
+	m_registry.Each<Ball, Transform, Velocity>([&](Entity, Ball& ball, Transform& transform, Velocity& velocity)
+	{
+		if (ball.Stuck)
+		{
+			++view.Stuck;
+			return;
+		}
+		if (view.Balls < BoardView::MAX_BALLS)
+		{
+			view.BallPositions[view.Balls] = transform.Position;
+			view.BallVelocities[view.Balls] = velocity.Value;
+		}
+		++view.Balls;
+	});
+}
+
+uint64_t Game::HashState(void)
+{
+	StateHash hash;
+	hash.Add(this->State);
+	hash.Add(this->Lives);
+	hash.Add(this->CurrentLevel);
+	// Versus peers read their keyboards at different times, only the ticks' inputs are shared
+	if (this->Players == 1)
+		hash.Add(m_inputTime);
+	for (GLuint player = 0; player < this->Players; ++player)
 	{
-		this->Levels[1].Load("levels/two.txt", this->Width, this->Height * 0.5);
+		const Transform& paddle = *m_registry.Get<Transform>(m_paddles[player]);
+		hash.Add(paddle.Position);
+		hash.Add(paddle.Size);
+		hash.Add(this->Score[player]);
 	}
-	else if (this->CurrentLevel == 2)
+	m_registry.Each<Ball, Transform, Velocity>([&](Entity entity, Ball& ball, Transform& transform, Velocity& velocity)
+	{
+		hash.Add(entity);
+		hash.Add(transform.Position);
+		hash.Add(velocity.Value);
+		hash.Add(ball.Stuck);
+		hash.Add(ball.Sticky);
+		hash.Add(ball.PassThrough);
+		hash.Add(ball.Owner);
+	});
+	m_registry.Each<Brick, Transform>([&](Entity entity, Brick& brick, Transform& transform)
+	{
+		hash.Add(entity);
+		hash.Add(brick.Solid);
+		hash.Add(transform.Position);
+	});
+	m_registry.Each<PowerUp>([&](Entity entity, PowerUp& powerUp)
+	{
+		hash.Add(entity);
+		hash.Add(powerUp.Type);
+		hash.Add(powerUp.Duration);
+		hash.Add(powerUp.Activated);
+		// Only falling power-ups still have a position
+		Transform* transform = m_registry.Get<Transform>(entity);
+		if (transform)
+			hash.Add(transform->Position);
+	});
+	return hash.Value();
+}
+
+namespace
+{
+	const uint32_t STATE_VERSION = 2;
+
+	// The scalars of a snapshot, written as one block
+	struct SavedState
+	{
+		uint32_t		Version;
+		GameState		State;
+		GLuint			Lives;
+		GLuint			CurrentLevel;
+		GLuint			BallCount;
+		GLuint			Players;
+		Entity			Paddles[MAX_PLAYERS];
+		GLuint			Score[MAX_PLAYERS];
+		PlayerInput		LastInputs[MAX_PLAYERS];
+		double			InputTime;
+		Random			Generator;
+		float			ShakeTime;
+		GLfloat			TrailCarry;
+		bool			Shake;
+		bool			Confuse;
+		bool			Chaos;
+		unsigned char	Keys[1024 / 8];		// one bit per key
+	};
+}
+
+void Game::SaveState(Snapshot& snapshot)
+{
+	// Zeroed first so the padding doesn't vary and the delta between ticks stays small
+	SavedState state;
+	memset((void*)&state, 0, sizeof(state));
+	state.Version = STATE_VERSION;
+	state.State = this->State;
+	state.Lives = this->Lives;
+	state.CurrentLevel = this->CurrentLevel;
+	state.BallCount = m_ballCount;
+	state.Players = this->Players;
+	std::copy(m_paddles, m_paddles + MAX_PLAYERS, state.Paddles);
+	std::copy(this->Score, this->Score + MAX_PLAYERS, state.Score);
+	std::copy(m_lastInputs, m_lastInputs + MAX_PLAYERS, state.LastInputs);
+	state.InputTime = m_inputTime;
+	state.Generator = m_random;
+	state.ShakeTime = m_shakeTime;
+	state.TrailCarry = m_trailCarry;
+	state.Shake = m_effects->Shake;
+	state.Confuse = m_effects->Confuse;
+	state.Chaos = m_effects->Chaos;
+	for (GLuint key = 0; key < 1024; ++key)
 	{
-		this->Levels[2].Load("levels/three.txt", this->Width, this->Height * 0.5);
+		if (this->Keys[key])
+			state.Keys[key / 8] |= (unsigned char)(1 << (key % 8));
 	}
-	else if (this->CurrentLevel == 3)
+
+	SnapshotWriter out(snapshot);
+	out.Write(state);
+	m_registry.Save(out);
+}
+
+bool Game::LoadState(const Snapshot& snapshot)
+{
+	SnapshotReader in(snapshot);
+	SavedState state;
+	if (!in.Read(state) || state.Version != STATE_VERSION || state.Players != this->Players || !m_registry.Load(in) || !in.Done())
 	{
-		this->Levels[3].Load("levels/four.txt", this->Width, this->Height * 0.5);
+		std::cout << "ERROR::GAME: Snapshot of " << snapshot.size() << " bytes couldn't be loaded\n";
+		return false;
 	}
 
-	this->Lives = 3;
+	this->State = state.State;
+	this->Lives = state.Lives;
+	this->CurrentLevel = state.CurrentLevel;
+	m_ballCount = state.BallCount;
+	std::copy(state.Paddles, state.Paddles + MAX_PLAYERS, m_paddles);
+	std::copy(state.Score, state.Score + MAX_PLAYERS, this->Score);
+	std::copy(state.LastInputs, state.LastInputs + MAX_PLAYERS, m_lastInputs);
+	m_random = state.Generator;
+	m_shakeTime = state.ShakeTime;
+	m_trailCarry = state.TrailCarry;
+	m_effects->Shake = state.Shake;
+	m_effects->Confuse = state.Confuse;
+	m_effects->Chaos = state.Chaos;
+	// Versus keyboards are local, rolling the game back leaves them as they are
+	if (this->Players > 1)
+		return true;
+	m_inputTime = state.InputTime;
+	for (GLuint key = 0; key < 1024; ++key)
+		this->Keys[key] = (state.Keys[key / 8] >> (key % 8)) & 1 ? GL_TRUE : GL_FALSE;
+	return true;
 }
 
-void Game::ResetPlayer(void)
+size_t Game::StateCapacity(void) const
 {
-	m_player->Size = PLAYER_SIZE;
-	m_player->Position = glm::vec2(this->Width / 2 - PLAYER_SIZE.x / 2, this->Height - PLAYER_SIZE.y);
-	m_ball->Reset(m_player->Position + glm::vec2(PLAYER_SIZE.x / 2 - BALL_RADIUS, -(BALL_RADIUS * 2)), INITIAL_BALL_VELOCITY);
+	return sizeof(SavedState) + m_registry.SaveCapacity();
 }
 
 // Power ups
 // ---------------------------------------------------------------
-bool isOtherPowerUpActive(std::vector<PowerUp> &powerUps, std::string type);
-
 void Game::UpdatePowerUps(float deltaTime)
 {
-	for (PowerUp& powerUp : this->PowerUps)
+	TRACE_ZONE("Game::UpdatePowerUps");
+
+	m_registry.Each<PowerUp>([&](Entity entity, PowerUp& powerUp)
 	{
-		powerUp.Position += powerUp.Velocity * deltaTime;
-		if (powerUp.Activated)
+		if (!powerUp.Activated)
 		{
-			powerUp.Duration -= deltaTime;
-			if (powerUp.Duration <= 0.0f)
+			// Still falling
+			Transform* transform = m_registry.Get<Transform>(entity);
+			if (transform && !m_resimulating)
 			{
-				// Remove the powerup from the list (will be removed later on)
-				powerUp.Activated = false;
-
-				if (powerUp.Type == "sticky")
-				{
-					if (!isOtherPowerUpActive(this->PowerUps, "sticky"))
-					{
-						// Only reset if no other powerup of type sticky is active
-						m_ball->Sticky = false;
-						m_player->Color = glm::vec3(1.0f);
-					}
-				}
-				else if (powerUp.Type == "pass-through")
-				{
-					if (!isOtherPowerUpActive(this->PowerUps, "pass-through"))
-					{
-						m_ball->PassThrough = false;
-						m_ball->Color = glm::vec3(1.0f);
-					}
-				}
-				else if (powerUp.Type == "confuse")
-				{
-					if (!isOtherPowerUpActive(this->PowerUps, "confuse"))
-					{
-						m_effects->Confuse = false;
-					}
-				}
-				else if (powerUp.Type == "chaos")
-				{
-					if (!isOtherPowerUpActive(this->PowerUps, "chaos"))
-					{
-						m_effects->Chaos = false;
-					}
-				}
+				m_particles->Emit(m_powerUpEmitter, powerUp.TrailCarry, deltaTime,
+					transform->Position + glm::vec2(transform->Size.x * 0.5f, 0.0f),
+					m_registry.Get<Velocity>(entity)->Value, m_registry.Get<Sprite>(entity)->Color);
 			}
+			return;
 		}
-	}
 
-	// Remove all PowerUps from vector that are destroyed AND !activated (thus either off the map or finished)
-	// Note we use a lambda expression to remove each PowerUp which is destroyed and not activated
-	this->PowerUps.erase(std::remove_if(this->PowerUps.begin(), this->PowerUps.end(),
-		[](const PowerUp & powerUp) { return powerUp.Destroyed && !powerUp.Activated; }
-	), this->PowerUps.end());
+		powerUp.Duration -= deltaTime;
+		if (powerUp.Duration <= 0.0f)
+		{
+			powerUp.Activated = false;
+			this->deactivatePowerUp(powerUp);
+			m_registry.Destroy(entity);
+		}
+	});
 }
 
-bool shouldSpawn(unsigned int chance)
+bool shouldSpawn(Random& random, unsigned int chance)
 {
-	unsigned int random = rand() % chance;
-	return random == 0;
+	return random.Below(chance) == 0;
 }
 
-void Game::SpawnPowerUps(GameObject& block)
+void Game::SpawnPowerUps(glm::vec2 position)
 {
-	if (shouldSpawn(25)) // 1 in 75 chance
-		this->PowerUps.push_back(PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, block.Position, ResourceManager::GetTexture("powerup_speed")));
-	if (shouldSpawn(10))
-		this->PowerUps.push_back(PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, block.Position, ResourceManager::GetTexture("powerup_sticky")));
-	if (shouldSpawn(30))
-		this->PowerUps.push_back(PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, block.Position, ResourceManager::GetTexture("powerup_passthrough")));
-	if (shouldSpawn(20))
-		this->PowerUps.push_back(PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, block.Position, ResourceManager::GetTexture("powerup_increase")));
-	if (shouldSpawn(50)) // Negative powerups should spawn more often
-		this->PowerUps.push_back(PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_confuse")));
-	if (shouldSpawn(55))
-		this->PowerUps.push_back(PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_chaos")));
+	if (shouldSpawn(m_random, 25)) // 1 in 75 chance
+		this->spawnPowerUp(POWERUP_SPEED, glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, position);
+	if (shouldSpawn(m_random, 10))
+		this->spawnPowerUp(POWERUP_STICKY, glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, position);
+	if (shouldSpawn(m_random, 30))
+		this->spawnPowerUp(POWERUP_PASS_THROUGH, glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, position);
+	if (shouldSpawn(m_random, 20))
+		this->spawnPowerUp(POWERUP_PAD_SIZE_INCREASE, glm::vec3(1.0f, 0.6f, 0.4), 0.0f, position);
+	if (shouldSpawn(m_random, 50)) // Negative powerups should spawn more often
+		this->spawnPowerUp(POWERUP_CONFUSE, glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, position);
+	if (shouldSpawn(m_random, 55))
+		this->spawnPowerUp(POWERUP_CHAOS, glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, position);
 
 }
 
-bool isOtherPowerUpActive(std::vector<PowerUp> &powerUps, std::string type)
+void Game::spawnPowerUp(PowerUpType type, glm::vec3 color, float duration, glm::vec2 position)
 {
-	for (const PowerUp &powerUp : powerUps)
-	{ 
-		if (powerUp.Activated)
-			if (powerUp.Type == type)
-				return true;
-	}
-	return false;
+	Entity powerUp = m_registry.Create();
+	m_registry.Add(powerUp, Transform{ position, POWER_UP_SIZE });
+	m_registry.Add(powerUp, Velocity{ POWER_UP_VELOCITY });
+	m_registry.Add(powerUp, Sprite{ m_powerUpTextures[type], color, 0.0f, LAYER_POWERUPS });
+	m_registry.Add(powerUp, PowerUp{ type, duration, false, 0.0f });
+}
+
+bool Game::isPowerUpActive(PowerUpType type)
+{
+	bool active = false;
+	m_registry.Each<PowerUp>([&](Entity, PowerUp& powerUp)
+	{
+		if (powerUp.Activated && powerUp.Type == type)
+			active = true;
+	});
+	return active;
 }
 
-void Game::activatePowerUp(PowerUp& powerUp)
+void Game::activatePowerUp(const PowerUp& powerUp, GLuint player)
 {
 	//Initiate a powerup based on type of powerup
-	if (powerUp.Type == "speed")
+	if (powerUp.Type == POWERUP_SPEED)
 	{
-		m_ball->Velocity *= 1.2;
+		m_registry.Each<Ball, Velocity>([](Entity, Ball&, Velocity& velocity) { velocity.Value *= 1.2; });
 	}
-	else if (powerUp.Type == "sticky")
+	else if (powerUp.Type == POWERUP_STICKY)
 	{
-		m_ball->Sticky = true;
-		m_player->Color = glm::vec3(1.0f, 0.5f, 1.0f);
+		m_registry.Each<Ball>([](Entity, Ball& ball) { ball.Sticky = true; });
+		for (GLuint i = 0; i < this->Players; ++i)
+			m_registry.Get<Sprite>(m_paddles[i])->Color = glm::vec3(1.0f, 0.5f, 1.0f);
 	}
-	else if (powerUp.Type == "pass-through")
+	else if (powerUp.Type == POWERUP_PASS_THROUGH)
 	{
-		m_ball->PassThrough = true;
-		m_ball->Color = glm::vec3(1.0f, 0.5f, 0.5f);
+		m_registry.Each<Ball, Sprite>([](Entity, Ball& ball, Sprite& sprite)
+		{
+			ball.PassThrough = true;
+			sprite.Color = glm::vec3(1.0f, 0.5f, 0.5f);
+		});
 	}
-	else if (powerUp.Type == "pad-size-increase")
+	else if (powerUp.Type == POWERUP_PAD_SIZE_INCREASE)
 	{
-		m_player->Size.x += 100;
+		// Only the paddle that caught it grows
+		m_registry.Get<Transform>(m_paddles[player])->Size.x += 100;
 	}
-	else if (powerUp.Type == "confuse")
+	else if (powerUp.Type == POWERUP_CONFUSE)
 	{
 		if (!m_effects->Chaos)
 			m_effects->Confuse = true; // Only activate if chaos wasn't already active
 	}
-	else if (powerUp.Type == "chaos")
+	else if (powerUp.Type == POWERUP_CHAOS)
 	{
 		if (!m_effects->Confuse)
 			m_effects->Chaos = true;
 	}
 }
 
+void Game::deactivatePowerUp(const PowerUp& powerUp)
+{
+	// Only reset if no other powerup of the same type is still active
+	if (this->isPowerUpActive(powerUp.Type))
+		return;
+
+	if (powerUp.Type == POWERUP_STICKY)
+	{
+		m_registry.Each<Ball>([](Entity, Ball& ball) { ball.Sticky = false; });
+		for (GLuint i = 0; i < this->Players; ++i)
+			m_registry.Get<Sprite>(m_paddles[i])->Color = PADDLE_COLORS[i];
+	}
+	else if (powerUp.Type == POWERUP_PASS_THROUGH)
+	{
+		m_registry.Each<Ball, Sprite>([](Entity, Ball& ball, Sprite& sprite)
+		{
+			ball.PassThrough = false;
+			sprite.Color = glm::vec3(1.0f);
+		});
+	}
+	else if (powerUp.Type == POWERUP_CONFUSE)
+	{
+		m_effects->Confuse = false;
+	}
+	else if (powerUp.Type == POWERUP_CHAOS)
+	{
+		m_effects->Chaos = false;
+	}
+}
+
 
 // Collision detection
 // ---------------------------------------------------------------
-bool CheckCollision(GameObject& one, GameObject& two);
-Collision CheckCollision(BallObject& one, GameObject& two);
+bool CheckCollision(const Transform& one, const Transform& two);
+Collision CheckCollision(const Transform& ball, GLfloat radius, const Transform& box);
 Direction VectorDirection(glm::vec2 target);
 
 void Game::DoCollisions(void)
 {
-	for (GameObject& box : this->Levels[this->CurrentLevel].Bricks)
+	TRACE_ZONE("Game::DoCollisions");
+
+	// Nothing is added or destroyed inside the loops below (a destroy could
+	// move the component another loop is holding on to), it's queued instead
+	std::pmr::vector<Entity> pendingDestroy(FrameArena::Resource());
+	std::pmr::vector<Entity> caughtPowerUps(FrameArena::Resource());
+	std::pmr::vector<glm::vec2> powerUpSpawns(FrameArena::Resource());
+
+	ComponentPool<Brick>& bricks = m_registry.Pool<Brick>();
+	m_registry.Each<Ball, Transform, Velocity>([&](Entity, Ball& ball, Transform& transform, Velocity& velocity)
 	{
-		if (!box.Destroyed)
+		m_registry.Each<Brick, Transform, Sprite>([&](Entity entity, Brick& brick, Transform& box, Sprite& sprite)
 		{
-			Collision collision = CheckCollision(*m_ball, box);
-			if (std::get<0>(collision))
+			Collision collision = CheckCollision(transform, ball.Radius, box);
+			if (!std::get<0>(collision))
+				return;
+
+			bool solid = brick.Solid != GL_FALSE;
+			if (!solid)
 			{
-				if (!box.IsSolid)
-				{
-					box.Destroyed = GL_TRUE;
-					this->SpawnPowerUps(box);
-				}
-				else
+				if (!m_resimulating)
+					m_particles->Burst(m_burstEmitter, box.Position + box.Size * 0.5f, velocity.Value, sprite.Color);
+				++this->Score[ball.Owner];
+				powerUpSpawns.push_back(box.Position);
+				pendingDestroy.push_back(entity);
+				// Out of the Brick pool right away so no other ball hits it this frame
+				bricks.Remove(entity);
+			}
+			else
+			{
+				// SCREEN SHAKE
+				m_shakeTime = 0.05f;
+				m_effects->Shake = true;
+
+			}
+
+			// Collision resolution
+			Direction dir = std::get<1>(collision);
+			glm::vec2 diff_vector = std::get<2>(collision);
+			if (!(ball.PassThrough && !solid))
+			{
+				if (dir == LEFT || dir == RIGHT) // Horizontal collision
 				{
-					// SCREEN SHAKE
-					m_shakeTime = 0.05f;
-					m_effects->Shake = true;
+					velocity.Value.x = -velocity.Value.x; // reverse the horizontal velocity
 
-				}
+					// Relocate
+					float penetration = ball.Radius - std::abs(diff_vector.x);
 
-				// Collision resolution
-				Direction dir = std::get<1>(collision);
-				glm::vec2 diff_vector = std::get<2>(collision);
-				if (!(m_ball->PassThrough && !box.IsSolid))
+					if (dir == LEFT)
+					{
+						transform.Position.x += penetration; // move the ball to right
+					}
+					else
+					{
+						transform.Position.x -= penetration; // move the ball to left
+					}
+				}
+				else
 				{
-					if (dir == LEFT || dir == RIGHT) // Horizontal collision
+					// Vertical Collision
+					velocity.Value.y = -velocity.Value.y; // Reverse vertical velocity
+					// Relocate
+					float penetration = ball.Radius - std::abs(diff_vector.y);
+					if (dir == UP)
 					{
-						m_ball->Velocity.x = -m_ball->Velocity.x; // reverse the horizontal velocity
-
-						// Relocate
-						float penetration = m_ball->Radius - std::abs(diff_vector.x);
-
-						if (dir == LEFT)
-						{
-							m_ball->Position.x += penetration; // move the ball to right
-						}
-						else
-						{
-							m_ball->Position.x -= penetration; // move the ball to left
-						}
+						transform.Position.y -= penetration; // move the ball to up
 					}
 					else
 					{
-						// Vertical Collision
-						m_ball->Velocity.y = -m_ball->Velocity.y; // Reverse vertical velocity
-						// Relocate
-						float penetration = m_ball->Radius - std::abs(diff_vector.y);
-						if (dir == UP)
-						{
-							m_ball->Position.y -= penetration; // move the ball to up
-						}
-						else
-						{
-							m_ball->Position.y += penetration; // move the ball to down
-						}
+						transform.Position.y += penetration; // move the ball to down
 					}
 				}
 			}
-		}
-	}
+		});
+	});
 
 	// Also check collisions for Powerups 
-	for (PowerUp &powerUp : this->PowerUps)
+	m_registry.Each<PowerUp, Transform>([&](Entity entity, PowerUp& powerUp, Transform& transform)
 	{
-		if (!powerUp.Destroyed)
+		// check if powerup passed bottom edge, if so: keep it inactive and destroy it
+		if (transform.Position.y >= this->Height)
 		{
-			// check if powerup passed bottom edge, if so: keep it inactive and destroy it
-			if (powerUp.Position.y >= this->Height)
-				powerUp.Destroyed = true;
-
-			if (CheckCollision(*m_player, powerUp))
-			{
-				activatePowerUp(powerUp);
-				powerUp.Destroyed = true;
-				powerUp.Activated = true;
-			}
+			pendingDestroy.push_back(entity);
+			return;
 		}
-	}
+		// In versus the first paddle to touch it gets it
+		for (GLuint player = 0; player < this->Players; ++player)
+		{
+			if (!CheckCollision(*m_registry.Get<Transform>(m_paddles[player]), transform))
+				continue;
+			activatePowerUp(powerUp, player);
+			powerUp.Activated = true;
+			caughtPowerUps.push_back(entity);
+			break;
+		}
+	});
 
-	// Also check collisions for player pad (unless stuck)
-	Collision result = CheckCollision(*m_ball, *m_player);
-	if (!m_ball->Stuck && std::get<0>(result))
+	// Also check collisions for player pads (unless stuck)
+	m_registry.Each<Ball, Transform, Velocity>([&](Entity, Ball& ball, Transform& transform, Velocity& velocity)
 	{
-		// Check where it hit the board, and change velocity based on where it hit the board
-		float centerBoard = m_player->Position.x + m_player->Size.x / 2;
-		float distance = (m_ball->Position.x + m_ball->Radius) - centerBoard;
-		float percentage = distance / (m_player->Size.x / 2);
-		// Move accordingly
-		float strength = 2.0f;
-		glm::vec2 oldVelocity = m_ball->Velocity;
-		m_ball->Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
-		// m_ball->Velocity.y = -m_ball->Velocity.y;
-		// Keep the speed consistent over both axes (multiply by length of old velocity, so total strength is not changed)
-		m_ball->Velocity = glm::normalize(m_ball->Velocity) * glm::length(oldVelocity); 
-		// Fix sticky paddle
-		m_ball->Velocity.y = -1 * abs(m_ball->Velocity.y);
+		if (ball.Stuck)
+			return;
+		for (GLuint player = 0; player < this->Players; ++player)
+		{
+			const Transform& paddle = *m_registry.Get<Transform>(m_paddles[player]);
+			Collision result = CheckCollision(transform, ball.Radius, paddle);
+			if (!std::get<0>(result))
+				continue;
+
+			// Check where it hit the board, and change velocity based on where it hit the board
+			float centerBoard = paddle.Position.x + paddle.Size.x / 2;
+			float distance = (transform.Position.x + ball.Radius) - centerBoard;
+			float percentage = distance / (paddle.Size.x / 2);
+			// Move accordingly
+			float strength = 2.0f;
+			glm::vec2 oldVelocity = velocity.Value;
+			velocity.Value.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
+			// Keep the speed consistent over both axes (multiply by length of old velocity, so total strength is not changed)
+			velocity.Value = glm::normalize(velocity.Value) * glm::length(oldVelocity); 
+			// Fix sticky paddle
+			velocity.Value.y = -1 * abs(velocity.Value.y);
 
-		// if sticky powerup is activated also stick ball to paddle once new velocity vectors were calculated
-		m_ball->Stuck = m_ball->Sticky;
+			// if sticky powerup is activated also stick ball to paddle once new velocity vectors were calculated
+			ball.Stuck = ball.Sticky;
+			// Whoever returned it scores the bricks it breaks next
+			ball.Owner = player;
+			break;
+		}
+	});
+
+	for (Entity entity : pendingDestroy)
+		m_registry.Destroy(entity);
+	// A caught power-up stops being drawn and moved, only its timer is left
+	for (Entity entity : caughtPowerUps)
+	{
+		m_registry.Remove<Transform>(entity);
+		m_registry.Remove<Velocity>(entity);
+		m_registry.Remove<Sprite>(entity);
 	}
+	for (const glm::vec2& position : powerUpSpawns)
+		this->SpawnPowerUps(position);
 }
 
 
-bool CheckCollision(GameObject &one, GameObject &two)
+bool CheckCollision(const Transform& one, const Transform& two)
 {
 	bool collisionX = one.Position.x + one.Size.x >= two.Position.x &&
 						two.Position.x + two.Size.x >= one.Position.x;
@@ -511,13 +1118,13 @@ bool CheckCollision(GameObject &one, GameObject &two)
 	return collisionX && collisionY;
 }
 
-Collision CheckCollision(BallObject& one, GameObject& two)
+Collision CheckCollision(const Transform& ball, GLfloat radius, const Transform& box)
 {
 	// Get center point circle first
-	glm::vec2 center(one.Position + one.Radius);
+	glm::vec2 center(ball.Position + radius);
 	// Calcualte AABB info (center, half-extents)
-	glm::vec2 aabb_half_extents(two.Size.x / 2, two.Size.y / 2);
-	glm::vec2 aabb_center(two.Position.x + aabb_half_extents.x, two.Position.y + aabb_half_extents.y);
+	glm::vec2 aabb_half_extents(box.Size.x / 2, box.Size.y / 2);
+	glm::vec2 aabb_center(box.Position.x + aabb_half_extents.x, box.Position.y + aabb_half_extents.y);
 	// Get difference vector between both centers
 	glm::vec2 difference = center - aabb_center;
 	glm::vec2 clamped = glm::clamp(difference, -aabb_half_extents, aabb_half_extents);
@@ -528,7 +1135,7 @@ Collision CheckCollision(BallObject& one, GameObject& two)
 
 	// not <= since in that case a collision also occurs when object one exactly touches object two,
 	// which they are at the end of each collision resolution stage.
-	if (glm::length(difference) < one.Radius)
+	if (glm::length(difference) < radius)
 	{
 		return std::make_tuple(GL_TRUE, VectorDirection(difference), difference);
 	}
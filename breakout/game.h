@@ -1,17 +1,23 @@
 #ifndef _game_HG_
 #define _game_HG_
 
-#include "gameobject.h"
 #include "globals.h"
 
+#include "ecs.h"
+#include "components.h"
 #include "spriterenderer.h"
 #include "gamelevel.h"
-#include "ballobject.h"
-#include "powerup.h"
 
 #include "particlegenerator.h"
+#include "particlesystem.h"
 #include "postprocessor.h"
 #include "textrenderer.h"
+#include "perfhud.h"
+#include "inputqueue.h"
+#include "options.h"
+#include "random.h"
+#include "replay.h"
+#include "snapshot.h"
 
 #include <glm/glm.hpp>
 
@@ -33,10 +39,41 @@ typedef std::tuple<GLboolean, Direction, glm::vec2> Collision; // <collision?, w
 
 const glm::vec2 PLAYER_SIZE(100, 20);
 const GLfloat PLAYER_VELOCITY(500.0f);
+// Versus has two paddles on the same board
+const GLuint MAX_PLAYERS = 2;
+
+// One player's controls for one tick, a bit per INPUT_ button. Versus
+// simulates from these rather than from key events, they're what goes over
+// the network.
+typedef uint8_t PlayerInput;
+const PlayerInput INPUT_LEFT = 1;
+const PlayerInput INPUT_RIGHT = 2;
+const PlayerInput INPUT_LAUNCH = 4;
+const PlayerInput INPUT_START = 8;	// acts when pressed, not while held
+
+// Room for a frame's worth of sprite, text and particle vertices
+const GLsizeiptr STREAM_BYTES_PER_FRAME = 1024 * 1024;
+// Scratch memory for containers that only live for one frame, see FrameArena
+const size_t FRAME_ARENA_BYTES = 1024 * 1024;
+// Entities reserved on top of the bricks and balls, mostly falling power-ups
+const size_t SPARE_ENTITIES = 1024;
 
 const glm::vec2 INITIAL_BALL_VELOCITY(100.0f, -350.0f);
 const float BALL_RADIUS = 12.5f;
 
+// What an automatic player gets to see of a single player board
+struct BoardView
+{
+	static constexpr GLuint MAX_BALLS = 16;
+
+	glm::vec2	PaddlePosition;		// top left, like Transform
+	glm::vec2	PaddleSize;
+	GLuint		Stuck;				// balls waiting on the paddle
+	GLuint		Balls;				// moving balls, the first MAX_BALLS are listed
+	glm::vec2	BallPositions[MAX_BALLS];
+	glm::vec2	BallVelocities[MAX_BALLS];
+};
+
 // Game holds all game-related state and functinality.
 // combines all game-related data into a single class for
 // easy access to each of the components
@@ -44,42 +81,112 @@ class Game
 {
 public:
 	GameState				State;
-	GLboolean				Keys[1024];
-	GLboolean				KeysProcessed[1024];
+	GLboolean				Keys[1024];		// held state, updated as Input is consumed
+	InputQueue				Input;			// filled by the key callback
+	Replay					Session;		// --record-input / --replay, idle otherwise
 	GLuint					Width;
 	GLuint					Height;
 	std::vector<GameLevel>	Levels;
 	GLuint					CurrentLevel;
-	std::vector<PowerUp>	PowerUps;
 	GLuint					Lives;
+	GLuint					Players;		// 2 in versus
+	GLuint					Score[MAX_PLAYERS];	// bricks broken by each player's balls
+	// Set by the RollbackSession every frame for the HUD
+	GLuint					RollbackFrames;
+	GLfloat					ResimMs;
 
 	Game(GLuint width, GLuint height);
 	~Game();
 
-	void Init(void);
+	void Init(const LaunchOptions& options);
+	// Releases the renderers and their GL objects, call while the context is still current
+	void Shutdown();
 
-	void ProcessInput(GLfloat deltaTime);
+	// Starts frame timing for the performance overlay, call before ProcessInput
+	void BeginFrame(GLfloat deltaTime);
+	// Applies queued key events in the order they happened, moving the paddle
+	// for exactly as long as each key was held
+	void ProcessInput(void);
 	void Update(GLfloat deltaTime);
+	// Catches up on input that arrived during Update, call right before Render
+	// after polling events again so the paddle is drawn where it is now
+	void LateLatchInput(void);
 	void Render(void);
 
+	// One versus tick: applies every player's input, then Update. resimulating
+	// is set when the tick is being run again after a rollback; particles were
+	// already emitted the first time so they're left alone.
+	void Tick(const PlayerInput* inputs, GLfloat deltaTime, bool resimulating = false);
+	// The local keyboard as a PlayerInput: A, D, SPACE and ENTER
+	PlayerInput LocalInput(void) const;
+
+	// Systems with gameplay side effects, the rest live in systems.h
 	void DoCollisions(void);
+	void UpdatePowerUps(float deltaTime);
 
+	// Respawns the current level's bricks from its tiles
 	void ResetLevel(void);
+	// Puts the paddle back in the middle with fresh balls stuck to it
 	void ResetPlayer(void);
 
-	void SpawnPowerUps(GameObject &block);
-	void UpdatePowerUps(float deltaTime);
+	void SpawnPowerUps(glm::vec2 position);
+
+	// Hash of everything the simulation carries from one tick to the next:
+	// state, lives, level, the paddle, balls, bricks and power-ups
+	uint64_t HashState(void);
+	// Copies all of that, plus the held keys, the power-up generator and the
+	// effect flags, into snapshot; LoadState puts it back. Levels never change
+	// and particles are only looks, neither is saved. Reserve StateCapacity
+	// bytes and saving doesn't allocate.
+	void SaveState(Snapshot& snapshot);
+	bool LoadState(const Snapshot& snapshot);
+	size_t StateCapacity(void) const;
+
+	// The first player's paddle and the balls, for the autopilot
+	void View(BoardView& view);
 
 private:
+	Registry m_registry;	// bricks, paddles, balls and power-ups
+	Entity m_paddles[MAX_PLAYERS];
+	PlayerInput m_lastInputs[MAX_PLAYERS];	// previous tick's, for INPUT_START
+	bool m_resimulating;
+	GLuint m_ballCount;		// balls put on the paddle each life
+	TextureHandle m_backgroundTexture;
+	TextureHandle m_ballTexture;
+	TextureHandle m_powerUpTextures[POWERUP_COUNT];
+	StreamBuffer* m_stream;
 	SpriteRenderer* m_renderer;
-	GameObject* m_player;
-	BallObject* m_ball;
-	ParticleGenerator* m_particleGenerator;
+	ParticleSystem* m_particles;
+	ParticleGenerator* m_particleGenerator;	// GPU ball trail, null unless --particles gpu
 	PostProcessor* m_effects;
 	TextRenderer* m_text;
+	PerfHud* m_hud;
+	GLint m_trailEmitter;
+	GLint m_burstEmitter;
+	GLint m_powerUpEmitter;
+	GLfloat m_trailRate;	// ball trail particles per second
+	GLfloat m_trailCarry;	// GPU trail only, CPU trails keep theirs in the Ball
 	float m_shakeTime = 0.0f;
-
-	void activatePowerUp(PowerUp& powerUp);
+	double m_inputTime = 0.0;	// time the paddle has been moved up to
+	Random m_random;			// power-up spawns, seeded from --seed or the replay
+	Snapshot m_quickSave;		// F5 saves, F9 loads
+
+	Entity spawnBall(glm::vec2 position, glm::vec2 velocity, GLuint owner);
+	void spawnPowerUp(PowerUpType type, glm::vec3 color, float duration, glm::vec2 position);
+	// player caught it
+	void activatePowerUp(const PowerUp& powerUp, GLuint player);
+	void deactivatePowerUp(const PowerUp& powerUp);
+	bool isPowerUpActive(PowerUpType type);
+	GLuint bricksRemaining(void);
+
+	void consumeInput(double until);
+	// The next event up to until, from the queue or from the replay being played
+	bool nextInput(double until, InputEvent& event);
+	void handleKeyEvent(const InputEvent& event);
+	void movePaddle(double until);
+	// Moves a paddle and the balls stuck to it, kept on the board
+	void moveBy(GLuint player, GLfloat distance);
+	void startGame(void);
 };
 
 #endif
\ No newline at end of file
@@ -1,24 +1,29 @@
 #include "gamelevel.h"
 
+#include "assets.h"
+#include "components.h"
 #include "resourcemanager.h"
 
-#include <fstream>
+#include <iostream>
 #include <sstream>
 
-void GameLevel::Load(const GLchar* file, GLuint levelWidth, GLuint levelHeight)
+#include <memtrack/memtrack.h>
+
+bool GameLevel::Load(const GLchar* file)
 {
+	MEMTRACK_SCOPE(MEM_LEVEL);
+
 	// Clear the old level data
-	this->Bricks.clear();
+	this->Tiles.clear();
 
 	GLuint tileCode;
-	GameLevel level;
 	std::string line;
-	std::ifstream fstream(file);
-	std::vector<std::vector<GLuint>> tileData;
+	std::string contents;
 
-	if (fstream)
+	if (Assets::Read(file, contents))
 	{
-		while (std::getline(fstream, line))
+		std::istringstream stream(contents);
+		while (std::getline(stream, line))
 		{
 			std::istringstream sstream(line);
 			std::vector<GLuint> row;	
@@ -26,80 +31,62 @@ void GameLevel::Load(const GLchar* file, GLuint levelWidth, GLuint levelHeight)
 			{
 				row.push_back(tileCode);
 			}
-			tileData.push_back(row);
-		}
-		
-		if (tileData.size() > 0)
-		{
-			this->init(tileData, levelWidth, levelHeight);
+			if (!row.empty())
+				this->Tiles.push_back(row);
 		}
 	}
-}
 
-void GameLevel::Draw(SpriteRenderer& renderer)
-{
-	for (GameObject& tile : this->Bricks)
+	if (this->Tiles.empty())
 	{
-		if (!tile.Destroyed)
-		{
-			tile.Draw(renderer);
-		}
+		std::cout << "ERROR::LEVEL: No tiles in " << file << "\n";
+		return false;
 	}
+	return true;
 }
 
-GLboolean GameLevel::IsCompleted()
+void GameLevel::Spawn(Registry& registry, GLuint levelWidth, GLuint levelHeight, bool sprites) const
 {
-	for (GameObject& tile : this->Bricks)
-	{
-		if (!tile.IsSolid && !tile.Destroyed)
-		{
-			return GL_FALSE;
-		}
-	}
-	return GL_TRUE;
-}
+	MEMTRACK_SCOPE(MEM_LEVEL);
+
+	if (this->Tiles.empty())
+		return;
 
-void GameLevel::init(std::vector<std::vector<GLuint>> tileData, GLuint lvlWidth, GLuint lvlHeight)
-{
 	// Calculate the dimensions
-	GLuint height = (GLuint)tileData.size();
-	GLuint width = (GLuint)tileData[0].size();
+	GLuint height = (GLuint)this->Tiles.size();
+	GLuint width = (GLuint)this->Tiles[0].size();
 	// fit the blocks nicely together
-	GLfloat unit_width = lvlWidth / static_cast<GLfloat>(width);
-	GLfloat unit_height = lvlHeight / height;				
+	GLfloat unit_width = levelWidth / static_cast<GLfloat>(width);
+	GLfloat unit_height = levelHeight / height;				
+
+	TextureHandle solid = sprites ? ResourceManager::FindTexture("block_solid") : TextureHandle();
+	TextureHandle block = sprites ? ResourceManager::FindTexture("block") : TextureHandle();
 
-	// Init level tiles based on tile Data
+	// Create level bricks based on tile Data
 	for (GLuint y = 0; y < height; ++y)
 	{
-		for (GLuint x = 0; x < width; ++x)
+		for (GLuint x = 0; x < width && x < this->Tiles[y].size(); ++x)
 		{
-			// Check the block type
-			if (tileData[y][x] == 1) // Solid block
-			{
-				glm::vec2 pos(unit_width * x, unit_height * y);
-				glm::vec2 size(unit_width, unit_height);
-				GameObject obj( pos, size,
-								ResourceManager::GetTexture("block_solid"),
-								glm::vec3(0.8f, 0.8f, 0.7f));
-				obj.IsSolid = GL_TRUE;
-				this->Bricks.push_back(obj);
-			}
-			else if (tileData[y][x] > 1)
-			{
-				glm::vec3 color = glm::vec3(1.0f); // original : white
-				if (tileData[y][x] == 2)
-					color = glm::vec3(0.2f, 0.6f, 1.0f);
-				else if (tileData[y][x] == 3)
-					color = glm::vec3(0.0f, 0.7f, 0.0f);
-				else if (tileData[y][x] == 4)
-					color = glm::vec3(0.8f, 0.8f, 0.4f);
-				else if (tileData[y][x] == 5)
-					color = glm::vec3(1.0f, 0.5f, 0.0f);
+			GLuint tile = this->Tiles[y][x];
+			if (tile == 0)
+				continue;
 
-				glm::vec2 pos(unit_width * x, unit_height * y);
-				glm::vec2 size(unit_width, unit_height);
-				this->Bricks.push_back(GameObject(pos, size, ResourceManager::GetTexture("block"), color));
-			}
+			glm::vec3 color = glm::vec3(1.0f); // original : white
+			if (tile == 1) // Solid block
+				color = glm::vec3(0.8f, 0.8f, 0.7f);
+			else if (tile == 2)
+				color = glm::vec3(0.2f, 0.6f, 1.0f);
+			else if (tile == 3)
+				color = glm::vec3(0.0f, 0.7f, 0.0f);
+			else if (tile == 4)
+				color = glm::vec3(0.8f, 0.8f, 0.4f);
+			else if (tile == 5)
+				color = glm::vec3(1.0f, 0.5f, 0.0f);
+
+			Entity brick = registry.Create();
+			registry.Add(brick, Transform{ glm::vec2(unit_width * x, unit_height * y), glm::vec2(unit_width, unit_height) });
+			if (sprites)
+				registry.Add(brick, Sprite{ tile == 1 ? solid : block, color, 0.0f, LAYER_BRICKS });
+			registry.Add(brick, Brick{ (GLboolean)(tile == 1) });
 		}
 	}
-}
\ No newline at end of file
+}
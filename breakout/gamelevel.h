@@ -1,21 +1,25 @@
 #ifndef _gamelevel_HG_
 #define _gamelevel_HG_
 
-#include "gameobject.h"
+#include <glad/glad.h>
+
+#include "ecs.h"
 #include <vector>
 
 class GameLevel
 {
 public:
-	std::vector<GameObject> Bricks;
+	// Tile codes as read from the level file, one row per line
+	std::vector<std::vector<GLuint>> Tiles;
 
 	GameLevel() { }
 	
-	void Load(const GLchar* file, GLuint levelWidth, GLuint levleHeight);
-	void Draw(SpriteRenderer &renderer);
-	GLboolean IsCompleted();
-private:
-	void init(std::vector<std::vector<GLuint>> tileData, GLuint lvlWidth, GLuint lvlHeight);
+	// Returns false if the file couldn't be read or holds no tiles
+	bool Load(const GLchar* file);
+	// Creates a brick entity for every tile, scaled so the level fills
+	// levelWidth x levelHeight. Without sprites the bricks are only there to
+	// collide with, no textures need to be loaded.
+	void Spawn(Registry& registry, GLuint levelWidth, GLuint levelHeight, bool sprites = true) const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,30 +0,0 @@
-#include "gameobject.h"
-
-GameObject::GameObject()
-	: Position(0, 0)
-	, Size(1, 1)
-	, Velocity(0.0f)
-	, Color(1.0f)
-	, Rotation(0.0f)
-	, Sprite()
-	, IsSolid(false)
-	, Destroyed(false)
-{
-}
-
-GameObject::GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, glm::vec3 color, glm::vec2 velocity)
-	: Position(pos) 
-	, Size(size)
-	, Sprite(sprite)
-	, Color(color)
-	, Velocity(velocity)
-	, Rotation(0.0f)
-	, IsSolid(false)
-	, Destroyed(false)
-{
-}
-
-void GameObject::Draw(SpriteRenderer& renderer)
-{
-	renderer.DrawSprite(this->Sprite, this->Position, this->Size, this->Rotation, this->Color);
-}
\ No newline at end of file
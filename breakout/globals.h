@@ -4,4 +4,13 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <headless/headless.h>
+
+// Seconds since start: what input is stamped with and effects animate by.
+// A headless run has no GLFW, its frames follow the fixed Headless clock.
+inline double GameTime()
+{
+	return Headless::Active() ? Headless::Time() : glfwGetTime();
+}
+
 #endif
\ No newline at end of file
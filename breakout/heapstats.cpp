@@ -0,0 +1,112 @@
+#include "heapstats.h"
+
+#include <memtrack/memtrack.h>
+
+#if defined(MEMTRACK_ENABLED)
+
+// MemTrack already owns operator new and counts per thread
+bool HeapStats::Counting()
+{
+	return true;
+}
+
+size_t HeapStats::Allocations()
+{
+	return (size_t)MemTrack::ThreadAllocations();
+}
+
+#elif defined(_DEBUG)
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	thread_local size_t t_allocations = 0;
+
+	void* countedAlloc(size_t size)
+	{
+		++t_allocations;
+		return std::malloc(size ? size : 1);
+	}
+}
+
+void* operator new(size_t size)
+{
+	void* p = countedAlloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	void* p = countedAlloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+bool HeapStats::Counting()
+{
+	return true;
+}
+
+size_t HeapStats::Allocations()
+{
+	return t_allocations;
+}
+
+#else
+
+bool HeapStats::Counting()
+{
+	return false;
+}
+
+size_t HeapStats::Allocations()
+{
+	return 0;
+}
+
+#endif
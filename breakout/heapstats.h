@@ -0,0 +1,21 @@
+#ifndef _heapstats_HG_
+#define _heapstats_HG_
+
+#include <cstddef>
+
+// Counts calls to the global operator new made by the calling thread, so the
+// frame loop can check that a settled frame never touches the heap. Debug
+// builds (_DEBUG) replace operator new/delete in heapstats.cpp to do the
+// counting, unless MEMTRACK_ENABLED is set and MemTrack already counts. Other
+// builds leave the allocator alone and Counting() is false.
+class HeapStats
+{
+public:
+	static bool Counting();
+	static size_t Allocations();
+
+private:
+	HeapStats() {}
+};
+
+#endif
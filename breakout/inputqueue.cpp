@@ -0,0 +1,38 @@
+#include "inputqueue.h"
+
+InputQueue::InputQueue()
+	: m_head(0)
+	, m_tail(0)
+	, m_dropped(0)
+{
+}
+
+bool InputQueue::Push(const InputEvent& event)
+{
+	unsigned int head = m_head.load(std::memory_order_relaxed);
+	if (head - m_tail.load(std::memory_order_acquire) == CAPACITY)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	m_events[head & (CAPACITY - 1)] = event;
+	m_head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+bool InputQueue::Peek(InputEvent& event) const
+{
+	unsigned int tail = m_tail.load(std::memory_order_relaxed);
+	if (tail == m_head.load(std::memory_order_acquire))
+		return false;
+	event = m_events[tail & (CAPACITY - 1)];
+	return true;
+}
+
+bool InputQueue::Pop(InputEvent& event)
+{
+	if (!this->Peek(event))
+		return false;
+	m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,39 @@
+#ifndef _inputqueue_HG_
+#define _inputqueue_HG_
+
+#include <atomic>
+
+// A key press or release and the time (GameTime) it was reported at
+struct InputEvent
+{
+	double	Time;
+	int		Key;
+	int		Action;	// GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+};
+
+// Fixed size single producer / single consumer ring buffer. The producer only
+// writes m_head and the consumer only writes m_tail, so neither side locks.
+class InputQueue
+{
+public:
+	InputQueue();
+
+	// Producer side, returns false (and drops the event) when the ring is full
+	bool Push(const InputEvent& event);
+
+	// Consumer side
+	bool Peek(InputEvent& event) const;
+	bool Pop(InputEvent& event);
+
+	unsigned int Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+	static const unsigned int CAPACITY = 256; // must be a power of two
+
+	InputEvent m_events[CAPACITY];
+	std::atomic<unsigned int> m_head;	// next slot to write
+	std::atomic<unsigned int> m_tail;	// next slot to read
+	std::atomic<unsigned int> m_dropped;
+};
+
+#endif
@@ -2,39 +2,86 @@
 
 #include "game.h"
 #include "resourcemanager.h"
+#include "heapstats.h"
+#include "autopilot.h"
+#include "batchsim.h"
+#include "framecapture.h"
+#include "framepacer.h"
+#include "netplay.h"
+#include "options.h"
+#include "snapshot.h"
 
+#include <globject/globject.h>
+#include <memtrack/memtrack.h>
+#include <shadercache/shadercache.h>
+#include <trace/trace.h>
+#include <vfs/vfs.h>
+
+#include <cassert>
+#include <cstring>
 #include <iostream>
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
 
 const GLuint SCREEN_WIDTH = 1080;
 const GLuint SCREEN_HEIGHT = 720;
+// Frames the driver gets to finish lazy setup before the heap check starts
+const GLuint SETTLE_FRAMES = 60;
 
 Game Breakout(SCREEN_WIDTH, SCREEN_HEIGHT);
+// Screenshots (F12) and --record, created once there is a context
+FrameCapture* Capture = nullptr;
 
-int main(void)
+int main(int argc, char** argv)
 {
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-
-	GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Breakout", nullptr, nullptr);
-	if (!window)
-	{
-		std::cout << "Failed to create GLFW window\n";
-		glfwTerminate();
+	LaunchOptions options;
+	if (!ParseOptions(argc, argv, options))
 		return EXIT_FAILURE;
+
+	// The batch simulator needs no window and no GL, only the level
+	if (options.BatchSim)
+	{
+		Vfs::Mount("breakout.pak");
+		int result = RunBatchBenchmark(options, SCREEN_WIDTH, SCREEN_HEIGHT);
+		Vfs::UnmountAll();
+		return result;
+	}
+
+	GLFWwindow* window = nullptr;
+	GLADloadproc loader = nullptr;
+	if (options.Headless)
+	{
+		// No window and no GLFW: an offscreen pbuffer the size of the window, nothing paces it
+		if (!Headless::Create(SCREEN_WIDTH, SCREEN_HEIGHT, options.Headless))
+			return EXIT_FAILURE;
+		loader = Headless::Loader();
+		options.Present = PRESENT_UNCAPPED;
+	}
+	else
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+
+		window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Breakout", nullptr, nullptr);
+		if (!window)
+		{
+			std::cout << "Failed to create GLFW window\n";
+			glfwTerminate();
+			return EXIT_FAILURE;
+		}
+
+		glfwMakeContextCurrent(window);
+		glfwSetKeyCallback(window, key_callback);
+		loader = (GLADloadproc)glfwGetProcAddress;
 	}
-	
-	glfwMakeContextCurrent(window);
-	glfwSetKeyCallback(window, key_callback);
 
 
 	// glad: load all OpenGL function pointers
 	// ---------------------------------------
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	if (!gladLoadGLLoader(loader))
 	{
 		std::cout << "Failed to initialize GLAD\n";
 		return EXIT_FAILURE;
@@ -51,38 +98,147 @@ int main(void)
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 
+	FramePacer pacer(options.Present, options.TargetFps);
+	pacer.Init();
+
+	TRACE_THREAD_NAME("Main");
+
+	// Program binaries are kept next to the game, a warm start compiles no GLSL
+	ShaderCache::Init("shadercache");
+	// Anything that isn't embedded comes from the pack when there is one, loose files otherwise
+	Vfs::Mount("breakout.pak");
+
 	// Init the game
-	Breakout.Init();
+	Breakout.Init(options);
+	if (options.Replay && !Breakout.Session.Playing())
+		return EXIT_FAILURE;
+	SnapshotBenchmark* snapshots = options.SnapshotBench ? new SnapshotBenchmark(Breakout) : nullptr;
+	// Recorded with --record-input like any other keys, the replay plays back without it
+	Autopilot* autopilot = options.Autopilot >= 0.0f ? new Autopilot(Breakout, options.Autopilot, options.AutopilotNoise, options.Seed) : nullptr;
+	RollbackSession* versus = nullptr;
+	if (options.Versus >= 0)
+	{
+		versus = new RollbackSession(Breakout, (GLuint)options.Versus, options.NetDelay);
+		LinkConditions conditions = { options.NetLatency, options.NetJitter, options.NetLoss };
+		if (!versus->Connect(options.NetPort, conditions))
+			return EXIT_FAILURE;
+	}
+
+	Capture = new FrameCapture(SCREEN_WIDTH, SCREEN_HEIGHT);
+	if (options.Record)
+	{
+		size_t length = strlen(options.Record);
+		bool raw = length > 4 && strcmp(options.Record + length - 4, ".rgb") == 0;
+		Capture->StartRecording(options.Record, raw ? CAPTURE_RAW : CAPTURE_PNG);
+	}
 
 	GLfloat deltaTime = 0.0f;
 	GLfloat lastFrame = 0.0f;
 
 	//Breakout.State = GAME_MENU;
 
-	while (!glfwWindowShouldClose(window))
+	GLuint frame = 0;
+	// A replay ends the session once its last tick has been played
+	while (!Breakout.Session.Finished() && (options.Headless ? Headless::Running() : !glfwWindowShouldClose(window)))
 	{
+		TRACE_ZONE("Frame");
+
+		size_t heapAllocations = HeapStats::Allocations();
+		pacer.BeginFrame();
+		if (options.Headless)
+			Headless::BeginFrame();
+
 		// deltaTime = 0.001f;
-		GLfloat currentFrame = (float)glfwGetTime();
+		GLfloat currentFrame = (float)GameTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
-		glfwPollEvents();
+		// Recorded with the tick, or replaced by the recorded one
+		deltaTime = Breakout.Session.TickDelta(deltaTime);
+		if (!options.Headless)
+			glfwPollEvents();
 
-		Breakout.ProcessInput(deltaTime);
-		Breakout.Update(deltaTime);
+		Breakout.BeginFrame(deltaTime);
+		if (autopilot)
+			autopilot->Update(GameTime());
+		Breakout.ProcessInput();
+		// Versus runs fixed ticks on both players' input, rolling back when needed
+		if (versus)
+			versus->Advance(deltaTime);
+		else
+			Breakout.Update(deltaTime);
 
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
-		
+
+		// Pick up whatever was pressed while the frame was simulated
+		if (!options.Headless)
+			glfwPollEvents();
+		Breakout.LateLatchInput();
+		// The tick's simulation is done, this is where a rollback would snapshot
+		if (snapshots)
+			snapshots->Sample();
+
 		Breakout.Render(); // All rendering done here
+		// Queues a read of the finished frame, it is copied out a couple of frames later
+		Capture->EndFrame(0);
+
+		TRACE_ZONE("SwapBuffers");
+		if (options.Headless)
+			Headless::EndFrame();
+		else
+			glfwSwapBuffers(window);
+		pacer.EndFrame();
 
-		glfwSwapBuffers(window);
+		// Once settled a frame must not touch the heap, anything it needs goes
+		// in the FrameArena or in storage reserved at Init (debug builds only)
+		heapAllocations = HeapStats::Allocations() - heapAllocations;
+		if (++frame > SETTLE_FRAMES && heapAllocations > 0)
+		{
+			std::cout << "ERROR::MAIN: Frame " << frame << " made " << heapAllocations << " heap allocations\n";
+			assert(!"heap allocation in a steady state frame");
+		}
+	}
+
+	pacer.Shutdown();
+	if (options.Headless)
+		Headless::Report();
+	else
+		pacer.Report();
+	if (snapshots)
+	{
+		snapshots->Report();
+		delete snapshots;
 	}
+	bool desynced = false;
+	if (autopilot)
+	{
+		autopilot->Report();
+		delete autopilot;
+	}
+	if (versus)
+	{
+		versus->Report();
+		desynced = versus->Desynced();
+		delete versus;
+	}
+
+	TRACE_DUMP("breakout_trace.json");
 
 
-	// Clean up
+	// Clean up, everything still alive after this was leaked
+	delete Capture;
+	Capture = nullptr;
+	bool diverged = Breakout.Session.Diverged();
+	Breakout.Shutdown();
 	ResourceManager::Clear();
-	glfwTerminate();
-	return 0;
+	Vfs::UnmountAll();
+	GLObjects::Report("at shutdown");
+	MEMTRACK_REPORT("at exit");
+	if (options.Headless)
+		Headless::Destroy();
+	else
+		glfwTerminate();
+	return diverged || desynced ? EXIT_FAILURE : 0;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
@@ -90,18 +246,31 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
 
-	
-	if (key >= 0 && key < 1024)
+#ifdef TRACE_ENABLED
+	// F2 stops the running capture and writes it out, pressing it again starts a fresh one
+	if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
 	{
-		if (action == GLFW_PRESS)
+		if (Trace::IsCapturing())
 		{
-			Breakout.Keys[key] = GL_TRUE;
+			Trace::Stop();
+			Trace::Dump("breakout_trace.json");
 		}
-		else if (action == GLFW_RELEASE)
+		else
 		{
-			Breakout.Keys[key] = GL_FALSE;
-			Breakout.KeysProcessed[key] = GL_FALSE;
+			Trace::Clear();
+			Trace::Start();
 		}
 	}
+#endif
+
+	if (key == GLFW_KEY_F12 && action == GLFW_PRESS && Capture)
+		Capture->Screenshot();
+
+	// Stamp the event now, the game applies it at this time rather than at the next frame
+	if (key >= 0 && key < 1024 && action != GLFW_REPEAT)
+	{
+		InputEvent event = { glfwGetTime(), key, action };
+		Breakout.Input.Push(event);
+	}
 	
 }
@@ -0,0 +1,454 @@
+#include "netplay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <trace/trace.h>
+
+#ifdef _WIN32
+	// glad pulls in windows.h with WIN32_LEAN_AND_MEAN, which leaves winsock out
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#pragma comment(lib, "ws2_32.lib")
+	typedef int socklen_t;
+#else
+	#include <arpa/inet.h>
+	#include <fcntl.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+#endif
+
+namespace
+{
+	const uint32_t PACKET_MAGIC = 0x504E5242;	// "BRNP"
+	const intptr_t NO_SOCKET = -1;
+	// Frame times wobble a little around TICK_TIME, a tick that's this close is run now
+	const double TICK_SLACK = 0.002;
+	// Ticks run in one Advance after a hitch, the rest of the time is dropped
+	const GLuint MAX_CATCH_UP = 2;
+
+	// Every packet: the header, then Count local inputs from FirstFrame on
+	struct PacketHeader
+	{
+		uint32_t	Magic;
+		int32_t		FirstFrame;
+		int32_t		Ack;		// every input up to this one has arrived
+		int32_t		HashFrame;	// last tick whose inputs are all confirmed, -1 for none
+		uint64_t	Hash;		// state after HashFrame
+		uint8_t		Count;
+	};
+
+	void closeSocket(intptr_t socket)
+	{
+#ifdef _WIN32
+		closesocket((SOCKET)socket);
+		WSACleanup();
+#else
+		close((int)socket);
+#endif
+	}
+
+	sockaddr_in loopback(unsigned int port)
+	{
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons((unsigned short)port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		return address;
+	}
+
+	double milliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+NetLink::NetLink()
+	: m_socket(NO_SOCKET)
+	, m_remotePort(0)
+	, m_conditions()
+	, m_queued(0)
+	, m_sent(0)
+	, m_dropped(0)
+	, m_received(0)
+{
+}
+
+NetLink::~NetLink()
+{
+	this->Close();
+}
+
+bool NetLink::Open(unsigned int localPort, unsigned int remotePort, const LinkConditions& conditions)
+{
+	this->Close();
+#ifdef _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+	{
+		std::cout << "ERROR::NET: Winsock didn't start\n";
+		return false;
+	}
+	SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == INVALID_SOCKET)
+	{
+		std::cout << "ERROR::NET: Couldn't create a UDP socket\n";
+		WSACleanup();
+		return false;
+	}
+	m_socket = (intptr_t)handle;
+	u_long nonBlocking = 1;
+	ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+	int handle = socket(AF_INET, SOCK_DGRAM, 0);
+	if (handle < 0)
+	{
+		std::cout << "ERROR::NET: Couldn't create a UDP socket\n";
+		return false;
+	}
+	m_socket = handle;
+	fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	sockaddr_in address = loopback(localPort);
+	if (bind(handle, (const sockaddr*)&address, sizeof(address)) != 0)
+	{
+		std::cout << "ERROR::NET: Couldn't listen on port " << localPort << ", is the other player using it?\n";
+		closeSocket(m_socket);
+		m_socket = NO_SOCKET;
+		return false;
+	}
+
+	m_remotePort = remotePort;
+	m_conditions = conditions;
+	m_random.Seed(localPort);
+	m_queued = 0;
+	return true;
+}
+
+void NetLink::Close()
+{
+	if (m_socket == NO_SOCKET)
+		return;
+	closeSocket(m_socket);
+	m_socket = NO_SOCKET;
+}
+
+void NetLink::Send(const void* data, size_t size)
+{
+	if (m_socket == NO_SOCKET || size > MAX_PACKET)
+		return;
+	if (m_conditions.Loss > 0.0f && m_random.Next() / 4294967296.0 < m_conditions.Loss)
+	{
+		++m_dropped;
+		return;
+	}
+
+	double delay = m_conditions.LatencyMs + m_conditions.JitterMs * (m_random.Next() / 4294967296.0);
+	// A full queue means the latency is far longer than the game can wait anyway
+	if (delay <= 0.0 || m_queued == QUEUE)
+	{
+		this->sendNow(data, size);
+		return;
+	}
+	Delayed& packet = m_queue[m_queued++];
+	packet.Due = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(delay));
+	packet.Size = size;
+	memcpy(packet.Data, data, size);
+}
+
+void NetLink::Pump()
+{
+	Clock::time_point now = Clock::now();
+	GLuint kept = 0;
+	for (GLuint i = 0; i < m_queued; ++i)
+	{
+		if (m_queue[i].Due <= now)
+		{
+			this->sendNow(m_queue[i].Data, m_queue[i].Size);
+			continue;
+		}
+		// Kept in the order they were sent, only jitter reorders them
+		if (kept != i)
+			m_queue[kept] = m_queue[i];
+		++kept;
+	}
+	m_queued = kept;
+}
+
+size_t NetLink::Receive(void* data, size_t capacity)
+{
+	if (m_socket == NO_SOCKET)
+		return 0;
+	for (;;)
+	{
+		sockaddr_in from;
+		socklen_t fromSize = sizeof(from);
+#ifdef _WIN32
+		int got = recvfrom((SOCKET)m_socket, (char*)data, (int)capacity, 0, (sockaddr*)&from, &fromSize);
+		// Windows reports a packet to a port nobody listens on yet as an error on the next read
+		if (got < 0 && WSAGetLastError() == WSAECONNRESET)
+			continue;
+#else
+		ssize_t got = recvfrom((int)m_socket, data, capacity, 0, (sockaddr*)&from, &fromSize);
+#endif
+		if (got <= 0)
+			return 0;
+		// Only the other player's port is listened to
+		if (ntohs(from.sin_port) != m_remotePort)
+			continue;
+		++m_received;
+		return (size_t)got;
+	}
+}
+
+void NetLink::sendNow(const void* data, size_t size)
+{
+	sockaddr_in address = loopback(m_remotePort);
+#ifdef _WIN32
+	sendto((SOCKET)m_socket, (const char*)data, (int)size, 0, (const sockaddr*)&address, sizeof(address));
+#else
+	sendto((int)m_socket, data, size, 0, (const sockaddr*)&address, sizeof(address));
+#endif
+	// Counted even if nobody is listening yet, like a real network
+	++m_sent;
+}
+
+RollbackSession::RollbackSession(Game& game, GLuint localPlayer, GLuint inputDelay)
+	: m_game(game)
+	, m_local(localPlayer)
+	, m_delay(std::min(inputDelay, MAX_NET_DELAY))
+	, m_accumulator(0.0)
+	, m_frame(0)
+	, m_rollbackTo(-1)
+	, m_localInputs()
+	, m_remoteInputs()
+	, m_predicted()
+	, m_hashes()
+	, m_peerHashFrame(-1)
+	, m_peerHash(0)
+	, m_ticks(0)
+	, m_stalls(0)
+	, m_rollbacks(0)
+	, m_resimFrames(0)
+	, m_maxDepth(0)
+	, m_resimMs(0.0)
+	, m_maxResimMs(0.0)
+	, m_desynced(false)
+{
+	// The first delay ticks have no input from either player, both know it
+	m_localLatest = (int64_t)m_delay - 1;
+	m_remoteConfirmed = (int64_t)m_delay - 1;
+	m_peerAck = (int64_t)m_delay - 1;
+	std::fill(m_hashFrames, m_hashFrames + INPUT_WINDOW, (int64_t)-1);
+	std::fill(m_snapshotFrames, m_snapshotFrames + SNAPSHOTS, (int64_t)-1);
+	size_t capacity = game.StateCapacity();
+	for (Snapshot& snapshot : m_snapshots)
+		snapshot.reserve(capacity);
+}
+
+bool RollbackSession::Connect(unsigned int port, const LinkConditions& conditions)
+{
+	unsigned int localPort = m_local == 0 ? port : port + 1;
+	unsigned int remotePort = m_local == 0 ? port + 1 : port;
+	if (!m_link.Open(localPort, remotePort, conditions))
+		return false;
+	std::cout << "NET: Player " << m_local + 1 << " on port " << localPort << ", input delay " << m_delay << " frames\n";
+	return true;
+}
+
+void RollbackSession::Advance(GLfloat deltaTime)
+{
+	TRACE_ZONE("RollbackSession::Advance");
+
+	m_game.RollbackFrames = 0;
+	m_game.ResimMs = 0.0f;
+	m_accumulator += deltaTime;
+
+	this->receive();
+	this->rollback();
+
+	GLuint ticks = 0;
+	while (m_accumulator >= TICK_TIME - TICK_SLACK && ticks < MAX_CATCH_UP)
+	{
+		// Too far ahead of the other player, wait for their input to catch up
+		if (m_frame - m_remoteConfirmed > (int64_t)MAX_PREDICTION)
+		{
+			++m_stalls;
+			break;
+		}
+		m_localLatest = m_frame + m_delay;
+		m_localInputs[m_localLatest % INPUT_WINDOW] = m_game.LocalInput();
+		this->simulate(m_frame, false);
+		++m_frame;
+		++m_ticks;
+		++ticks;
+		m_accumulator -= TICK_TIME;
+	}
+	// Time that couldn't be simulated (a stall or a hitch) isn't made up for later
+	m_accumulator = std::min(m_accumulator, TICK_TIME);
+
+	this->checkDesync();
+	this->send();
+	m_link.Pump();
+}
+
+void RollbackSession::receive()
+{
+	unsigned char packet[NetLink::MAX_PACKET];
+	size_t size = 0;
+	while ((size = m_link.Receive(packet, sizeof(packet))) > 0)
+	{
+		PacketHeader header;
+		if (size < sizeof(header))
+			continue;
+		memcpy(&header, packet, sizeof(header));
+		if (header.Magic != PACKET_MAGIC || size < sizeof(header) + header.Count)
+			continue;
+
+		m_peerAck = std::max(m_peerAck, (int64_t)header.Ack);
+		if (header.HashFrame > m_peerHashFrame)
+		{
+			m_peerHashFrame = header.HashFrame;
+			m_peerHash = header.Hash;
+		}
+
+		// Inputs are resent until acknowledged, only the ones right after the last confirmed are new
+		const PlayerInput* inputs = (const PlayerInput*)(packet + sizeof(header));
+		for (GLuint i = 0; i < header.Count; ++i)
+		{
+			int64_t frame = (int64_t)header.FirstFrame + i;
+			if (frame != m_remoteConfirmed + 1)
+				continue;
+			if (frame >= m_frame + INPUT_WINDOW - MAX_PREDICTION)
+				break;
+			m_remoteInputs[frame % INPUT_WINDOW] = inputs[i];
+			m_remoteConfirmed = frame;
+			// Already simulated with a prediction that turned out wrong
+			if (frame < m_frame && m_predicted[frame % INPUT_WINDOW] != inputs[i] && (m_rollbackTo < 0 || frame < m_rollbackTo))
+				m_rollbackTo = frame;
+		}
+	}
+}
+
+void RollbackSession::send()
+{
+	unsigned char packet[NetLink::MAX_PACKET];
+	PacketHeader header;
+	// Zeroed so the padding doesn't go out uninitialised
+	memset(&header, 0, sizeof(header));
+	header.Magic = PACKET_MAGIC;
+	header.Ack = (int32_t)m_remoteConfirmed;
+
+	int64_t first = std::max(m_peerAck + 1, m_localLatest - (int64_t)MAX_PACKET_INPUTS + 1);
+	GLuint count = m_localLatest >= first ? (GLuint)(m_localLatest - first + 1) : 0;
+	header.FirstFrame = (int32_t)first;
+	header.Count = (uint8_t)count;
+
+	// Every tick up to here ran on confirmed input, its state is final
+	int64_t confirmed = std::min(m_remoteConfirmed, m_frame - 1);
+	header.HashFrame = -1;
+	if (confirmed >= 0 && m_hashFrames[confirmed % INPUT_WINDOW] == confirmed)
+	{
+		header.HashFrame = (int32_t)confirmed;
+		header.Hash = m_hashes[confirmed % INPUT_WINDOW];
+	}
+
+	memcpy(packet, &header, sizeof(header));
+	for (GLuint i = 0; i < count; ++i)
+		packet[sizeof(header) + i] = m_localInputs[(first + i) % INPUT_WINDOW];
+	m_link.Send(packet, sizeof(header) + count);
+}
+
+void RollbackSession::rollback()
+{
+	if (m_rollbackTo < 0)
+		return;
+	int64_t from = m_rollbackTo;
+	m_rollbackTo = -1;
+
+	const Snapshot& snapshot = m_snapshots[from % SNAPSHOTS];
+	if (m_snapshotFrames[from % SNAPSHOTS] != from)
+	{
+		std::cout << "ERROR::NET: No snapshot of frame " << from << " to roll back to\n";
+		return;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	m_game.LoadState(snapshot);
+	for (int64_t frame = from; frame < m_frame; ++frame)
+		this->simulate(frame, true);
+	double elapsed = milliseconds(start, std::chrono::steady_clock::now());
+
+	GLuint depth = (GLuint)(m_frame - from);
+	++m_rollbacks;
+	m_resimFrames += depth;
+	m_maxDepth = std::max(m_maxDepth, depth);
+	m_resimMs += elapsed;
+	m_maxResimMs = std::max(m_maxResimMs, elapsed);
+	m_game.RollbackFrames += depth;
+	m_game.ResimMs += (GLfloat)elapsed;
+}
+
+void RollbackSession::simulate(int64_t frame, bool resimulating)
+{
+	// Loading it back would leave the snapshot as it is, a resimulated tick only resaves it
+	m_game.SaveState(m_snapshots[frame % SNAPSHOTS]);
+	m_snapshotFrames[frame % SNAPSHOTS] = frame;
+
+	PlayerInput inputs[MAX_PLAYERS];
+	PlayerInput remote = this->remoteInput(frame);
+	inputs[m_local] = m_localInputs[frame % INPUT_WINDOW];
+	inputs[1 - m_local] = remote;
+	m_predicted[frame % INPUT_WINDOW] = remote;
+	m_game.Tick(inputs, (GLfloat)TICK_TIME, resimulating);
+
+	m_hashes[frame % INPUT_WINDOW] = m_game.HashState();
+	m_hashFrames[frame % INPUT_WINDOW] = frame;
+}
+
+void RollbackSession::checkDesync()
+{
+	int64_t frame = m_peerHashFrame;
+	// Until this side has confirmed the tick too its hash could still change
+	if (frame < 0 || m_desynced || frame > m_remoteConfirmed || frame >= m_frame)
+		return;
+	m_peerHashFrame = -1;
+	if (m_hashFrames[frame % INPUT_WINDOW] != frame || m_hashes[frame % INPUT_WINDOW] == m_peerHash)
+		return;
+
+	char line[160];
+	snprintf(line, sizeof(line), "ERROR::NET: Desync at frame %lld, state hash %016llx, the other player's %016llx\n",
+		(long long)frame, (unsigned long long)m_hashes[frame % INPUT_WINDOW], (unsigned long long)m_peerHash);
+	std::cout << line;
+	m_desynced = true;
+}
+
+PlayerInput RollbackSession::remoteInput(int64_t frame) const
+{
+	if (frame <= m_remoteConfirmed)
+		return m_remoteInputs[frame % INPUT_WINDOW];
+	// Predicted: still pressing whatever they last pressed
+	return m_remoteConfirmed >= 0 ? m_remoteInputs[m_remoteConfirmed % INPUT_WINDOW] : 0;
+}
+
+void RollbackSession::Report() const
+{
+	char line[256];
+	snprintf(line, sizeof(line), "NET: %u ticks, %u stalled frames, %u rollbacks, %u frames resimulated\n",
+		m_ticks, m_stalls, m_rollbacks, m_resimFrames);
+	std::cout << line;
+	if (m_rollbacks > 0)
+	{
+		snprintf(line, sizeof(line), "NET: rollback depth %.1f frames average, %u max, resimulation %.3f ms average, %.3f ms max\n",
+			(double)m_resimFrames / m_rollbacks, m_maxDepth, m_resimMs / m_rollbacks, m_maxResimMs);
+		std::cout << line;
+	}
+	snprintf(line, sizeof(line), "NET: %u packets sent, %u dropped by the simulated link, %u received\n",
+		m_link.Sent(), m_link.Dropped(), m_link.Received());
+	std::cout << line;
+}
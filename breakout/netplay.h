@@ -0,0 +1,160 @@
+#ifndef _netplay_HG_
+#define _netplay_HG_
+
+#include <glad/glad.h>
+
+#include "game.h"
+#include "random.h"
+#include "snapshot.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// What the link does to packets on their way out, to try rollback against a
+// bad connection without leaving the machine
+struct LinkConditions
+{
+	float	LatencyMs;	// added to every packet
+	float	JitterMs;	// random extra delay, packets can arrive out of order
+	float	Loss;		// chance a packet is dropped, 0 to 1
+};
+
+// Unconnected, non-blocking UDP between two processes on 127.0.0.1. Sent
+// packets wait in a fixed queue until the simulated latency has passed, so
+// nothing allocates once the link is open.
+class NetLink
+{
+public:
+	static const size_t MAX_PACKET = 256;
+
+	NetLink();
+	~NetLink();
+
+	// Listens on localPort and sends to remotePort
+	bool Open(unsigned int localPort, unsigned int remotePort, const LinkConditions& conditions);
+	void Close();
+
+	// Queues a packet, it goes out on a later Pump once its delay is up
+	void Send(const void* data, size_t size);
+	// Sends whatever queued packets are due
+	void Pump();
+	// Size of the next packet that arrived, 0 when there are none
+	size_t Receive(void* data, size_t capacity);
+
+	GLuint Sent() const { return m_sent; }
+	GLuint Dropped() const { return m_dropped; }
+	GLuint Received() const { return m_received; }
+
+	NetLink(const NetLink&) = delete;
+	NetLink& operator=(const NetLink&) = delete;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// Packets waiting out their latency
+	static const GLuint QUEUE = 64;
+	struct Delayed
+	{
+		Clock::time_point	Due;
+		size_t				Size;
+		unsigned char		Data[MAX_PACKET];
+	};
+
+	intptr_t		m_socket;		// SOCKET on Windows, a descriptor everywhere else
+	unsigned int	m_remotePort;
+	LinkConditions	m_conditions;
+	Random			m_random;		// decides loss and jitter
+	Delayed			m_queue[QUEUE];
+	GLuint			m_queued;
+	GLuint			m_sent;
+	GLuint			m_dropped;
+	GLuint			m_received;
+
+	void sendNow(const void* data, size_t size);
+};
+
+// Two player versus with rollback. Every tick each player's input is sent to
+// the other, delayed by a few frames so it usually arrives in time. When it
+// doesn't, the remote player is predicted to keep doing what they last did
+// and the tick runs anyway; once the real input arrives and differs from the
+// prediction the game is loaded back to the snapshot before that tick and
+// resimulated up to the present.
+//
+// Both players start from the same seed and run the same ticks with the
+// same inputs, so their states stay identical; the hash of the last tick
+// both have confirmed is sent along to catch any desync.
+class RollbackSession
+{
+public:
+	// Game::Tick's fixed step
+	static constexpr double TICK_TIME = 1.0 / 60.0;
+
+	RollbackSession(Game& game, GLuint localPlayer, GLuint inputDelay);
+
+	// Opens the link: player 0 listens on port, player 1 on port + 1
+	bool Connect(unsigned int port, const LinkConditions& conditions);
+
+	// Runs however many ticks deltaTime covers (a couple at most), each with
+	// the game's LocalInput
+	void Advance(GLfloat deltaTime);
+	void Report() const;
+	// The two games stopped agreeing on the state of a confirmed tick
+	bool Desynced() const { return m_desynced; }
+
+	RollbackSession(const RollbackSession&) = delete;
+	RollbackSession& operator=(const RollbackSession&) = delete;
+
+private:
+	// Inputs kept per player, more than can ever be in flight
+	static const GLuint INPUT_WINDOW = 128;
+	// Ticks the simulation can run ahead of the remote player's input
+	static const GLuint MAX_PREDICTION = 8;
+	// Ticks of game state kept to roll back to
+	static const GLuint SNAPSHOTS = MAX_PREDICTION + 2;
+	// Unacknowledged inputs resent in every packet
+	static const GLuint MAX_PACKET_INPUTS = 64;
+
+	Game&			m_game;
+	NetLink			m_link;
+	GLuint			m_local;
+	GLuint			m_delay;
+	double			m_accumulator;
+
+	// Frame numbers: m_frame is the next tick to simulate
+	int64_t			m_frame;
+	int64_t			m_localLatest;		// last local input sampled, m_frame + delay - 1
+	int64_t			m_remoteConfirmed;	// every remote input up to this one has arrived
+	int64_t			m_peerAck;			// the remote player has every local input up to this one
+	int64_t			m_rollbackTo;		// earliest tick simulated with a wrong prediction, -1 if none
+
+	PlayerInput		m_localInputs[INPUT_WINDOW];
+	PlayerInput		m_remoteInputs[INPUT_WINDOW];
+	PlayerInput		m_predicted[INPUT_WINDOW];		// remote input each tick was simulated with
+	uint64_t		m_hashes[INPUT_WINDOW];			// state after each tick
+	int64_t			m_hashFrames[INPUT_WINDOW];
+	int64_t			m_peerHashFrame;				// last confirmed hash the peer sent, -1 once checked
+	uint64_t		m_peerHash;
+
+	Snapshot		m_snapshots[SNAPSHOTS];			// state before each tick
+	int64_t			m_snapshotFrames[SNAPSHOTS];
+
+	// Totals for Report
+	GLuint			m_ticks;
+	GLuint			m_stalls;
+	GLuint			m_rollbacks;
+	GLuint			m_resimFrames;
+	GLuint			m_maxDepth;
+	double			m_resimMs;
+	double			m_maxResimMs;
+	bool			m_desynced;
+
+	void receive();
+	void send();
+	void rollback();
+	void simulate(int64_t frame, bool resimulating);
+	void checkDesync();
+	PlayerInput remoteInput(int64_t frame) const;
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include "options.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void printUsage(const char* program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+		<< "  --present <mode>  vsync, uncapped, cap or lowlatency (default vsync)\n"
+		<< "  --fps <n>         frame rate limit used by --present cap (default 120)\n"
+		<< "  --particles <backend>  cpu or gpu (transform feedback) ball trail (default cpu)\n"
+		<< "  --particle-count <n>   particles in the GPU ball trail (default 500)\n"
+		<< "  --particle-budget <n>  particles shared by all CPU emitters (default 2000)\n"
+		<< "  --balls <n>            balls launched each life (default 1)\n"
+		<< "  --vram-budget <MB>     estimated GPU memory before a warning (default 512)\n"
+		<< "  --upload-budget <KB>   texture data streamed to the GPU per frame (default 4096)\n"
+		<< "  --record <path>        write every frame, PNGs into a directory or raw RGB24 to a .rgb file\n"
+		<< "  --headless <frames>    render offscreen without a window for that many frames, then print timings\n"
+		<< "  --seed <n>             seed for power-up spawns and particles (default 1)\n"
+		<< "  --record-input <file>  record the seed, frame times and input to a replay\n"
+		<< "  --replay <file>        play a recorded replay, stopping at the first tick that differs\n"
+		<< "  --snapshot-bench       snapshot the game state every tick and report bytes and time per snapshot\n"
+		<< "  --versus <0|1>         two player versus with rollback over local UDP, as player 1 (0) or 2 (1)\n"
+		<< "  --net-port <port>      UDP port of player 1, player 2 uses the next one (default 7777)\n"
+		<< "  --net-delay <frames>   input delay in frames, 0 to " << MAX_NET_DELAY << " (default 2)\n"
+		<< "  --net-latency <ms>     simulated one way latency (default 0)\n"
+		<< "  --net-jitter <ms>      simulated random extra latency (default 0)\n"
+		<< "  --net-loss <percent>   simulated packet loss (default 0)\n"
+		<< "  --batchsim <boards>    benchmark stepping that many boards at once with SIMD and threads, no window\n"
+		<< "  --batch-ticks <n>      ticks --batchsim runs for (default 600)\n"
+		<< "  --batch-threads <n>    threads --batchsim uses, 0 for one per core (default 0)\n"
+		<< "  --autopilot <skill>    play single player unattended, going round every level; skill 0 to 1, 1 never misses\n"
+		<< "  --autopilot-noise <px> random aim offset from the paddle's centre on each return (default 30)\n";
+}
+
+bool ParseOptions(int argc, char** argv, LaunchOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--present") == 0 && value)
+		{
+			if (!FramePacer::ParseMode(value, options.Present))
+			{
+				std::cout << "ERROR::OPTIONS: Unknown present mode " << value << "\n";
+				printUsage(argv[0]);
+				return false;
+			}
+			++i;
+		}
+		else if (strcmp(arg, "--fps") == 0 && value)
+		{
+			options.TargetFps = (float)atof(value);
+			if (options.TargetFps <= 0.0f)
+			{
+				std::cout << "ERROR::OPTIONS: --fps needs a positive frame rate\n";
+				return false;
+			}
+			++i;
+		}
+		else if (strcmp(arg, "--particles") == 0 && value)
+		{
+			if (strcmp(value, "cpu") == 0)
+				options.Particles = PARTICLES_CPU;
+			else if (strcmp(value, "gpu") == 0)
+				options.Particles = PARTICLES_GPU;
+			else
+			{
+				std::cout << "ERROR::OPTIONS: Unknown particle backend " << value << "\n";
+				printUsage(argv[0]);
+				return false;
+			}
+			++i;
+		}
+		else if (strcmp(arg, "--particle-count") == 0 && value)
+		{
+			int count = atoi(value);
+			if (count <= 0)
+			{
+				std::cout << "ERROR::OPTIONS: --particle-count needs a positive count\n";
+				return false;
+			}
+			options.ParticleCount = (unsigned int)count;
+			++i;
+		}
+		else if (strcmp(arg, "--particle-budget") == 0 && value)
+		{
+			int budget = atoi(value);
+			if (budget <= 0)
+			{
+				std::cout << "ERROR::OPTIONS: --particle-budget needs a positive count\n";
+				return false;
+			}
+			options.ParticleBudget = (unsigned int)budget;
+			++i;
+		}
+		else if (strcmp(arg, "--balls") == 0 && value)
+		{
+			int balls = atoi(value);
+			if (balls <= 0)
+			{
+				std::cout << "ERROR::OPTIONS: --balls needs a positive count\n";
+				return false;
+			}
+			options.Balls = (unsigned int)balls;
+			++i;
+		}
+		else if (strcmp(arg, "--vram-budget") == 0 && value)
+		{
+			int megabytes = atoi(value);
+			if (megabytes <= 0)
+			{
+				std::cout << "ERROR::OPTIONS: --vram-budget needs a positive size in MB\n";
+				return false;
+			}
+			options.VramBudget = (unsigned int)megabytes;
+			++i;
+		}
+		else if (strcmp(arg, "--upload-budget") == 0 && value)
+		{
+			int kilobytes = atoi(value);
+			if (kilobytes <= 0)
+			{
+				std::cout << "ERROR::OPTIONS: --upload-budget needs a positive size in KB\n";
+				return false;
+			}
+			options.UploadBudget = (unsigned int)kilobytes;
+			++i;
+		}
+		else if (strcmp(arg, "--record") == 0 && value)
+		{
+			options.Record = value;
+			++i;
+		}
+		else if (strcmp(arg, "--headless") == 0 && value)
+		{
+			int frames = atoi(value);
+			if (frames <= 0)
+			{
+				std::cout << "ERROR::OPTIONS: --headless needs a positive frame count\n";
+				return false;
+			}
+			options.Headless = (unsigned int)frames;
+			++i;
+		}
+		else if (strcmp(arg, "--seed") == 0 && value)
+		{
+			options.Seed = (unsigned int)strtoul(value, nullptr, 10);
+			++i;
+		}
+		else if (strcmp(arg, "--record-input") == 0 && value)
+		{
+			options.RecordInput = value;
+			++i;
+		}
+		else if (strcmp(arg, "--replay") == 0 && value)
+		{
+			options.Replay = value;
+			++i;
+		}
+		else if (strcmp(arg, "--snapshot-bench") == 0)
+		{
+			options.SnapshotBench = true;
+		}
+		else if (strcmp(arg, "--versus") == 0 && value)
+		{
+			if (strcmp(value, "0") != 0 && strcmp(value, "1") != 0)
+			{
+				std::cout << "ERROR::OPTIONS: --versus needs the local player, 0 or 1\n";
+				return false;
+			}
+			options.Versus = atoi(value);
+			++i;
+		}
+		else if (strcmp(arg, "--net-port") == 0 && value)
+		{
+			int port = atoi(value);
+			if (port <= 0 || port >= 65535)
+			{
+				std::cout << "ERROR::OPTIONS: --net-port needs a port below 65535\n";
+				return false;
+			}
+			options.NetPort = (unsigned int)port;
+			++i;
+		}
+		else if (strcmp(arg, "--net-delay") == 0 && value)
+		{
+			int frames = atoi(value);
+			if (frames < 0 || frames > (int)MAX_NET_DELAY)
+			{
+				std::cout << "ERROR::OPTIONS: --net-delay needs 0 to " << MAX_NET_DELAY << " frames\n";
+				return false;
+			}
+			options.NetDelay = (unsigned int)frames;
+			++i;
+		}
+		else if (strcmp(arg, "--net-latency") == 0 && value)
+		{
+			options.NetLatency = (float)atof(value);
+			if (options.NetLatency < 0.0f)
+			{
+				std::cout << "ERROR::OPTIONS: --net-latency can't be negative\n";
+				return false;
+			}
+			++i;
+		}
+		else if (strcmp(arg, "--net-jitter") == 0 && value)
+		{
+			options.NetJitter = (float)atof(value);
+			if (options.NetJitter < 0.0f)
+			{
+				std::cout << "ERROR::OPTIONS: --net-jitter can't be negative\n";
+				return false;
+			}
+			++i;
+		}
+		else if (strcmp(arg, "--net-loss") == 0 && value)
+		{
+			float percent = (float)atof(value);
+			if (percent < 0.0f || percent > 100.0f)
+			{
+				std::cout << "ERROR::OPTIONS: --net-loss needs a percentage\n";
+				return false;
+			}
+			options.NetLoss = percent / 100.0f;
+			++i;
+		}
+		else if (strcmp(arg, "--batchsim") == 0 && value)
+		{
+			int boards = atoi(value);
+			if (boards <= 0)
+			{
+				std::cout << "ERROR::OPTIONS: --batchsim needs a positive board count\n";
+				return false;
+			}
+			options.BatchSim = (unsigned int)boards;
+			++i;
+		}
+		else if (strcmp(arg, "--batch-ticks") == 0 && value)
+		{
+			int ticks = atoi(value);
+			if (ticks <= 0)
+			{
+				std::cout << "ERROR::OPTIONS: --batch-ticks needs a positive count\n";
+				return false;
+			}
+			options.BatchTicks = (unsigned int)ticks;
+			++i;
+		}
+		else if (strcmp(arg, "--batch-threads") == 0 && value)
+		{
+			int threads = atoi(value);
+			if (threads < 0)
+			{
+				std::cout << "ERROR::OPTIONS: --batch-threads can't be negative\n";
+				return false;
+			}
+			options.BatchThreads = (unsigned int)threads;
+			++i;
+		}
+		else if (strcmp(arg, "--autopilot") == 0 && value)
+		{
+			float skill = (float)atof(value);
+			if (skill < 0.0f || skill > 1.0f)
+			{
+				std::cout << "ERROR::OPTIONS: --autopilot needs a skill from 0 to 1\n";
+				return false;
+			}
+			options.Autopilot = skill;
+			++i;
+		}
+		else if (strcmp(arg, "--autopilot-noise") == 0 && value)
+		{
+			options.AutopilotNoise = (float)atof(value);
+			if (options.AutopilotNoise < 0.0f)
+			{
+				std::cout << "ERROR::OPTIONS: --autopilot-noise can't be negative\n";
+				return false;
+			}
+			++i;
+		}
+		else
+		{
+			std::cout << "ERROR::OPTIONS: Unknown argument " << arg << "\n";
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if (options.RecordInput && options.Replay)
+	{
+		std::cout << "ERROR::OPTIONS: --record-input and --replay can't be used together\n";
+		return false;
+	}
+	if (options.Versus >= 0 && (options.RecordInput || options.Replay))
+	{
+		std::cout << "ERROR::OPTIONS: --versus can't be recorded or replayed\n";
+		return false;
+	}
+	if (options.Autopilot >= 0.0f && (options.Versus >= 0 || options.Replay))
+	{
+		std::cout << "ERROR::OPTIONS: --autopilot only plays single player, and not during a replay\n";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,98 @@
+#ifndef _options_HG_
+#define _options_HG_
+
+#include "framepacer.h"
+#include "particlegenerator.h"
+
+// Longest --net-delay, the rollback session sizes its buffers for it
+const unsigned int MAX_NET_DELAY = 10;
+
+// Everything that can be configured from the command line
+//
+//	--present vsync|uncapped|cap|lowlatency	how frames are paced (default vsync)
+//	--fps <n>								frame rate for --present cap
+//	--particles cpu|gpu						where the ball trail is simulated (default cpu)
+//	--particle-count <n>					size of the GPU ball trail (default 500)
+//	--particle-budget <n>					particles shared by all CPU emitters (default 2000)
+//	--balls <n>								balls launched each life (default 1)
+//	--vram-budget <MB>						estimated GPU memory before a warning (default 512)
+//	--upload-budget <KB>					texture data streamed to the GPU per frame (default 4096)
+//	--record <directory|file.rgb>			write every frame, a PNG sequence or raw RGB24 video
+//	--headless <frames>						render that many frames offscreen (EGL) with no window, then exit
+//	--seed <n>								seeds power-up spawns and particles (default 1)
+//	--record-input <file>					log the seed, every tick's delta time and the input to a replay
+//	--replay <file>							play a replay back instead of the keyboard, checking every tick
+//	--snapshot-bench						save, delta encode and load the game state every tick and report the cost
+//	--versus <0|1>							two player rollback versus over UDP on this machine, as player 1 or 2
+//	--net-port <port>						player 1 listens on port, player 2 on port + 1 (default 7777)
+//	--net-delay <frames>					frames local input is held back before it's simulated (default 2)
+//	--net-latency <ms>						simulated one way latency added to every packet sent (default 0)
+//	--net-jitter <ms>						random extra latency, up to this much (default 0)
+//	--net-loss <percent>					simulated packet loss (default 0)
+//	--batchsim <boards>						step that many boards with SIMD on every core instead of playing, print the rate
+//	--batch-ticks <n>						ticks the batch runs for (default 600)
+//	--batch-threads <n>						worker threads for the batch, 0 for one per core (default 0)
+//	--autopilot <skill>						play single player unattended round every level, skill 0 to 1 (1 never misses)
+//	--autopilot-noise <px>					random aim offset from the paddle's centre on each return (default 30)
+struct LaunchOptions
+{
+	PresentMode		Present;
+	float			TargetFps;
+	ParticleBackend	Particles;
+	unsigned int	ParticleCount;
+	unsigned int	ParticleBudget;
+	unsigned int	Balls;
+	unsigned int	VramBudget;		// MB
+	unsigned int	UploadBudget;	// KB
+	const char*		Record;			// null unless recording
+	unsigned int	Headless;		// frames, 0 for a window
+	unsigned int	Seed;
+	const char*		RecordInput;	// null unless recording a replay
+	const char*		Replay;			// null unless playing one
+	bool			SnapshotBench;
+	int				Versus;			// local player, -1 for single player
+	unsigned int	NetPort;
+	unsigned int	NetDelay;		// frames
+	float			NetLatency;		// ms
+	float			NetJitter;		// ms
+	float			NetLoss;		// 0 to 1
+	unsigned int	BatchSim;		// boards, 0 to play the game
+	unsigned int	BatchTicks;
+	unsigned int	BatchThreads;
+	float			Autopilot;		// skill 0 to 1, negative to play by hand
+	float			AutopilotNoise;	// pixels
+
+	LaunchOptions()
+		: Present(PRESENT_VSYNC)
+		, TargetFps(120.0f)
+		, Particles(PARTICLES_CPU)
+		, ParticleCount(500)
+		, ParticleBudget(2000)
+		, Balls(1)
+		, VramBudget(512)
+		, UploadBudget(4096)
+		, Record(nullptr)
+		, Headless(0)
+		, Seed(1)
+		, RecordInput(nullptr)
+		, Replay(nullptr)
+		, SnapshotBench(false)
+		, Versus(-1)
+		, NetPort(7777)
+		, NetDelay(2)
+		, NetLatency(0.0f)
+		, NetJitter(0.0f)
+		, NetLoss(0.0f)
+		, BatchSim(0)
+		, BatchTicks(600)
+		, BatchThreads(0)
+		, Autopilot(-1.0f)
+		, AutopilotNoise(30.0f)
+	{
+	}
+};
+
+// Returns false (after printing usage) if the arguments couldn't be parsed
+bool ParseOptions(int argc, char** argv, LaunchOptions& options);
+
+#endif
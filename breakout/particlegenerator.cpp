@@ -1,20 +1,51 @@
 #include "particlegenerator.h"
+#include "renderstats.h"
+#include "resourcemanager.h"
 
-ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
+#include <cstddef>
+
+#include <memtrack/memtrack.h>
+#include <trace/trace.h>
+
+// Every respawned particle lives exactly this long (in seconds)
+const float PARTICLE_LIFE = 1.0f;
+// Quad size in pixels, the size attribute is left disabled so every instance uses this
+const float PARTICLE_SIZE = 10.0f;
+
+ParticleGenerator::ParticleGenerator(Shader& shader, const Texture2D& texture, unsigned int amount, StreamBuffer& stream,
+	ParticleBackend backend)
 	: m_shader(shader)
 	, m_texture(texture)
 	, m_amount(amount)
+	, m_stream(stream)
+	, m_backend(backend)
+	, m_updateShader(nullptr)
+	, m_current(0)
+	, m_nextSpawn(0)
+	, m_seed(1)
+	, m_spawnHistory()
+	, m_spawnIndex(0)
 {
 	this->init();
+	if (this->m_backend == PARTICLES_GPU)
+		this->initGpu();
 }
 
-void ParticleGenerator::Update(float deltaTime, GameObject& object, unsigned int newParticles, glm::vec2 offset)
+void ParticleGenerator::Update(float deltaTime, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles)
 {
+	TRACE_ZONE("ParticleGenerator::Update");
+
+	if (this->m_backend == PARTICLES_GPU)
+	{
+		this->updateGpu(deltaTime, position, velocity, newParticles);
+		return;
+	}
+
 	// Add new particles
 	for (unsigned int i = 0; i < newParticles; ++i)
 	{
 		int unusedParticle = this->firstUnusedParticle();
-		this->respawnParticle(this->m_particles[unusedParticle], object, offset);
+		this->respawnParticle(this->m_particles[unusedParticle], position, velocity);
 	}
 	// Update all particles
 	for (unsigned int i = 0; i < this->m_amount; ++i)
@@ -31,27 +62,87 @@ void ParticleGenerator::Update(float deltaTime, GameObject& object, unsigned int
 
 void ParticleGenerator::Draw(void)
 {
+	TRACE_ZONE("ParticleGenerator::Draw");
+
+	if (this->m_backend == PARTICLES_GPU)
+	{
+		// Instance data is the state buffer the last update wrote
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		this->m_shader.Use();
+		this->m_texture.Bind();
+		glBindVertexArray(this->m_drawVAO[this->m_current].ID());
+		glVertexAttrib1f(3, PARTICLE_SIZE);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)this->m_amount);
+		glBindVertexArray(0);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		RenderStats::StateChange(3);
+		RenderStats::Draw();
+		return;
+	}
+
+	this->m_instances.clear();
+	for (const Particle& particle : this->m_particles)
+	{
+		if (particle.Life > 0.0f)
+			this->m_instances.push_back({ particle.Position, particle.Color });
+	}
+	if (this->m_instances.empty())
+		return;
+
+	GLintptr offset = this->m_stream.Upload(this->m_instances.data(),
+		this->m_instances.size() * sizeof(ParticleInstance), sizeof(GLfloat));
+	if (offset < 0)
+		return;
+
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE); // Use additive blending to give a glow effect
 	this->m_shader.Use(); 
-	for (Particle particle : this->m_particles)
+	this->m_texture.Bind();
+	glBindVertexArray(this->m_VAO.ID());
+	// Point the instance attributes at this frame's copy
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_stream.ID());
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (GLvoid*)(offset + offsetof(ParticleInstance, Offset)));
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (GLvoid*)(offset + offsetof(ParticleInstance, Color)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glVertexAttrib1f(3, PARTICLE_SIZE);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)this->m_instances.size());
+	glBindVertexArray(0);
+	RenderStats::StateChange();
+	RenderStats::Draw();
+
+	// Reset to the default blending mode -- remember opengl is a big state machine
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	RenderStats::StateChange(2);
+}
+
+unsigned int ParticleGenerator::LiveCount(void) const
+{
+	if (this->m_backend == PARTICLES_GPU)
 	{
-		if (particle.Life > 0.0f)
+		// Everything spawned within the last lifetime is still around
+		float age = 0.0f;
+		unsigned int spawned = 0;
+		for (unsigned int i = 1; i <= SPAWN_HISTORY && age < PARTICLE_LIFE; ++i)
 		{
-			this->m_shader.SetVector2f("offset", particle.Position);
-			this->m_shader.SetVector4f("color", particle.Color);
-			this->m_texture.Bind();
-			glBindVertexArray(this->m_VAO);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-			glBindVertexArray(0);
+			const glm::vec2& entry = this->m_spawnHistory[(this->m_spawnIndex + SPAWN_HISTORY - i) % SPAWN_HISTORY];
+			spawned += (unsigned int)entry.y;
+			age += entry.x;
 		}
+		return spawned < this->m_amount ? spawned : this->m_amount;
 	}
-	// Reset to the default blending mode -- remember opengl is a big state machine
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	unsigned int live = 0;
+	for (const Particle& particle : this->m_particles)
+	{
+		if (particle.Life > 0.0f)
+			++live;
+	}
+	return live;
 }
 
 void ParticleGenerator::init()
 {
-	unsigned int VBO;
+	MEMTRACK_SCOPE(MEM_PARTICLES);
+
 	float particleQuad[] = {
 		0.0f, 1.0f, 0.0f, 1.0f,
 		1.0f, 0.0f, 1.0f, 0.0f,
@@ -62,16 +153,24 @@ void ParticleGenerator::init()
 		1.0f, 0.0f, 1.0f, 0.0f
 	};
 
-	glGenVertexArrays(1, &this->m_VAO);
-	glGenBuffers(1, &VBO);
-	glBindVertexArray(this->m_VAO);
+	this->m_VAO = GLVertexArray::Create("ParticleGenerator");
+	this->m_quadVBO = GLBuffer::Create("ParticleGenerator quad");
+	glBindVertexArray(this->m_VAO.ID());
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_quadVBO.ID());
 	glBufferData(GL_ARRAY_BUFFER, sizeof(particleQuad), particleQuad, GL_STATIC_DRAW);
+	this->m_quadVBO.SetBytes(sizeof(particleQuad));
 
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
+	// Offset and color advance once per particle, Draw sets their pointers
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
+	this->m_instances.reserve(this->m_amount);
 
 	// Create this->amount default particle instances
 	for (unsigned int i = 0; i < this->m_amount; ++i)
@@ -108,12 +207,95 @@ unsigned int ParticleGenerator::firstUnusedParticle(void)
 	return 0;
 }
 
-void ParticleGenerator::respawnParticle(Particle& particle, GameObject& object, glm::vec2 offset)
+void ParticleGenerator::respawnParticle(Particle& particle, glm::vec2 position, glm::vec2 velocity)
 {
 	float random = ((rand() % 100) - 50) / 10.0f;
 	float rColor = 0.5 + ((rand() % 100) / 100.0f);
-	particle.Position = object.Position + random + offset;
+	particle.Position = position + random;
 	particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
-	particle.Life = 1.0f;
-	particle.Velocity = object.Velocity * 0.1f;
+	particle.Life = PARTICLE_LIFE;
+	particle.Velocity = velocity * 0.1f;
+}
+
+void ParticleGenerator::initGpu(void)
+{
+	static const GLchar* varyings[] = { "outPosition", "outVelocity", "outColor", "outLife" };
+	this->m_updateShader = &ResourceManager::GetShader(ResourceManager::LoadFeedbackShader("shaders/vert_particle_update.glsl", varyings, 4, "particle_update"));
+
+	// Start with every particle dead and fully transparent
+	for (Particle& particle : this->m_particles)
+		particle.Color = glm::vec4(0.0f);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		this->m_state[i] = GLBuffer::Create("ParticleGenerator state");
+		this->m_updateVAO[i] = GLVertexArray::Create("ParticleGenerator update");
+		this->m_drawVAO[i] = GLVertexArray::Create("ParticleGenerator draw");
+		glBindBuffer(GL_ARRAY_BUFFER, this->m_state[i].ID());
+		glBufferData(GL_ARRAY_BUFFER, this->m_amount * sizeof(Particle), this->m_particles.data(), GL_DYNAMIC_COPY);
+		this->m_state[i].SetBytes(this->m_amount * sizeof(Particle));
+
+		// One vertex per particle for the update pass
+		glBindVertexArray(this->m_updateVAO[i].ID());
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)offsetof(Particle, Position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)offsetof(Particle, Velocity));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)offsetof(Particle, Color));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)offsetof(Particle, Life));
+
+		// The shared quad plus position and color per instance for drawing
+		glBindVertexArray(this->m_drawVAO[i].ID());
+		glBindBuffer(GL_ARRAY_BUFFER, this->m_quadVBO.ID());
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
+		glBindBuffer(GL_ARRAY_BUFFER, this->m_state[i].ID());
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)offsetof(Particle, Position));
+		glVertexAttribDivisor(1, 1);
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)offsetof(Particle, Color));
+		glVertexAttribDivisor(2, 1);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The CPU copies aren't needed any more
+	std::vector<Particle>().swap(this->m_particles);
+	std::vector<ParticleInstance>().swap(this->m_instances);
+}
+
+void ParticleGenerator::updateGpu(float deltaTime, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles)
+{
+	if (newParticles > this->m_amount)
+		newParticles = this->m_amount;
+
+	this->m_updateShader->Use();
+	this->m_updateShader->SetFloat("deltaTime", deltaTime);
+	this->m_updateShader->SetInteger("amount", (GLint)this->m_amount);
+	this->m_updateShader->SetInteger("spawnStart", (GLint)this->m_nextSpawn);
+	this->m_updateShader->SetInteger("spawnCount", (GLint)newParticles);
+	this->m_updateShader->SetInteger("seed", (GLint)this->m_seed++);
+	this->m_updateShader->SetVector2f("emitterPosition", position);
+	this->m_updateShader->SetVector2f("emitterVelocity", velocity);
+	this->m_nextSpawn = (this->m_nextSpawn + newParticles) % this->m_amount;
+
+	GLuint next = 1 - this->m_current;
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(this->m_updateVAO[this->m_current].ID());
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, this->m_state[next].ID());
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, (GLsizei)this->m_amount);
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	RenderStats::StateChange(3);
+	RenderStats::Draw();
+	this->m_current = next;
+
+	this->m_spawnHistory[this->m_spawnIndex] = glm::vec2(deltaTime, (float)newParticles);
+	this->m_spawnIndex = (this->m_spawnIndex + 1) % SPAWN_HISTORY;
 }
\ No newline at end of file
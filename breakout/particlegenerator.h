@@ -6,7 +6,7 @@
 
 #include "shader.h"
 #include "texture.h"
-#include "gameobject.h"
+#include "streambuffer.h"
 #include <vector>
 
 struct Particle {
@@ -22,24 +22,65 @@ struct Particle {
 		, Life(0.0f) {}
 };
 
+// The GPU backend keeps particles in this exact layout, interleaved
+static_assert(sizeof(Particle) == 9 * sizeof(float), "Particle must match the transform feedback layout");
+
+// Where particles are simulated
+enum ParticleBackend
+{
+	PARTICLES_CPU,	// updated here and uploaded every frame through the stream buffer
+	PARTICLES_GPU	// updated with transform feedback, never leaves the GPU
+};
+
+// Per particle data the vertex shader reads with an instance divisor
+struct ParticleInstance {
+	glm::vec2	Offset;
+	glm::vec4	Color;
+};
+
 class ParticleGenerator
 {
 public:
-	ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount);
+	// shader and texture are borrowed and must outlive the generator
+	ParticleGenerator(Shader& shader, const Texture2D& texture, unsigned int amount, StreamBuffer& stream,
+					  ParticleBackend backend = PARTICLES_CPU);
 
-	void Update(float deltaTime, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+	// Spawns newParticles around position, moving with a fraction of velocity
+	void Update(float deltaTime, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles);
+	// Draws every live particle with one instanced draw call
 	void Draw(void);
+	// Number of particles currently alive, estimated from recent spawns on the GPU backend
+	unsigned int LiveCount(void) const;
 
 private:
 	std::vector<Particle> m_particles;
 	unsigned int m_amount;
-	Shader m_shader;
-	Texture2D m_texture;
-	unsigned int m_VAO;
+	Shader& m_shader;
+	const Texture2D& m_texture;
+	GLVertexArray m_VAO;
+	GLBuffer m_quadVBO;
+	StreamBuffer& m_stream;
+	std::vector<ParticleInstance> m_instances;
+
+	// GPU backend: Update reads m_state[m_current] and writes the other buffer
+	ParticleBackend m_backend;
+	Shader* m_updateShader;
+	GLBuffer m_state[2];
+	GLVertexArray m_updateVAO[2];
+	GLVertexArray m_drawVAO[2];
+	unsigned int m_current;
+	unsigned int m_nextSpawn;
+	unsigned int m_seed;
+	// Recent (deltaTime, spawned) pairs for LiveCount
+	static const unsigned int SPAWN_HISTORY = 256;
+	glm::vec2 m_spawnHistory[SPAWN_HISTORY];
+	unsigned int m_spawnIndex;
 
 	void init(void);
+	void initGpu(void);
+	void updateGpu(float deltaTime, glm::vec2 position, glm::vec2 velocity, unsigned int newParticles);
 	unsigned int firstUnusedParticle(); // the first particle index thats currently unused e.g Life <= 0.0f or 0 if no particle is currently active
-	void respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+	void respawnParticle(Particle &particle, glm::vec2 position, glm::vec2 velocity);
 }; 
 
 
@@ -0,0 +1,320 @@
+#include "particlesystem.h"
+#include "assets.h"
+#include "resourcemanager.h"
+#include "renderstats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include <memtrack/memtrack.h>
+#include <trace/trace.h>
+
+namespace
+{
+	// Uniform in [min, max)
+	GLfloat randomRange(GLfloat min, GLfloat max)
+	{
+		return min + (max - min) * ((rand() % 10000) / 10000.0f);
+	}
+}
+
+EmitterDesc::EmitterDesc()
+	: TextureName("particle")
+	, Priority(0)
+	, Max(100)
+	, Rate(0.0f)
+	, Burst(0)
+	, Life(1.0f)
+	, Size(10.0f)
+	, Jitter(0.0f)
+	, Inherit(0.0f)
+	, Spread(0.0f)
+	, Gravity(0.0f)
+	, Shade(1.0f)
+	, Start(1.0f)
+	, End(1.0f, 1.0f, 1.0f, 0.0f)
+{
+}
+
+ParticleSystem::ParticleSystem(Shader& shader, StreamBuffer& stream, GLuint budget)
+	: m_shader(shader)
+	, m_stream(stream)
+	, m_live(0)
+	, m_dropped(0)
+{
+	MEMTRACK_SCOPE(MEM_PARTICLES);
+	this->m_pool.resize(budget);
+	this->m_instances.resize(budget);
+	// Every emitter queues at most one request per frame per thing emitting,
+	// there are far fewer of those than particles
+	this->m_requests.reserve(budget);
+	this->initRenderData();
+}
+
+bool ParticleSystem::Load(const GLchar* file)
+{
+	MEMTRACK_SCOPE(MEM_PARTICLES);
+
+	std::string contents;
+	if (!Assets::Read(file, contents))
+	{
+		std::cout << "ERROR::PARTICLES: Could not open " << file << "\n";
+		return false;
+	}
+	std::istringstream stream(contents);
+
+	std::vector<EmitterDesc> descs;
+	std::string line;
+	GLuint lineNumber = 0;
+	while (std::getline(stream, line))
+	{
+		++lineNumber;
+		std::istringstream sstream(line);
+		std::string key;
+		if (!(sstream >> key) || key[0] == '#')
+			continue;
+
+		if (key == "emitter")
+		{
+			descs.push_back(EmitterDesc());
+			sstream >> descs.back().Name;
+			continue;
+		}
+		if (descs.empty())
+		{
+			std::cout << "ERROR::PARTICLES: " << file << ":" << lineNumber << ": " << key << " before the first emitter\n";
+			return false;
+		}
+
+		EmitterDesc& desc = descs.back();
+		if (key == "texture")		sstream >> desc.TextureName;
+		else if (key == "priority")	sstream >> desc.Priority;
+		else if (key == "max")		sstream >> desc.Max;
+		else if (key == "rate")		sstream >> desc.Rate;
+		else if (key == "burst")	sstream >> desc.Burst;
+		else if (key == "life")		sstream >> desc.Life;
+		else if (key == "size")		sstream >> desc.Size;
+		else if (key == "jitter")	sstream >> desc.Jitter;
+		else if (key == "inherit")	sstream >> desc.Inherit;
+		else if (key == "spread")	sstream >> desc.Spread;
+		else if (key == "gravity")	sstream >> desc.Gravity;
+		else if (key == "shade")	sstream >> desc.Shade.x >> desc.Shade.y;
+		else if (key == "start")	sstream >> desc.Start.r >> desc.Start.g >> desc.Start.b >> desc.Start.a;
+		else if (key == "end")		sstream >> desc.End.r >> desc.End.g >> desc.End.b >> desc.End.a;
+		else
+		{
+			std::cout << "ERROR::PARTICLES: " << file << ":" << lineNumber << ": unknown field " << key << "\n";
+			return false;
+		}
+		if (sstream.fail() || desc.Life <= 0.0f)
+		{
+			std::cout << "ERROR::PARTICLES: " << file << ":" << lineNumber << ": bad value for " << key << "\n";
+			return false;
+		}
+	}
+
+	// Emitters sharing a texture are drawn together
+	this->Clear();
+	this->m_descs = descs;
+	this->m_descGroup.clear();
+	this->m_textures.clear();
+	for (const EmitterDesc& desc : this->m_descs)
+	{
+		TextureHandle texture = ResourceManager::FindTexture(desc.TextureName);
+		GLuint group = 0;
+		while (group < this->m_textures.size() && this->m_textures[group] != texture)
+			++group;
+		if (group == this->m_textures.size())
+			this->m_textures.push_back(texture);
+		this->m_descGroup.push_back(group);
+	}
+	this->m_liveByEmitter.assign(this->m_descs.size(), 0);
+	this->m_groupStart.assign(this->m_textures.size() + 1, 0);
+	this->m_groupCursor.reserve(this->m_textures.size());
+	return true;
+}
+
+GLint ParticleSystem::Find(const std::string& name) const
+{
+	for (size_t i = 0; i < this->m_descs.size(); ++i)
+	{
+		if (this->m_descs[i].Name == name)
+			return (GLint)i;
+	}
+	std::cout << "ERROR::PARTICLES: No emitter called " << name << "\n";
+	return -1;
+}
+
+void ParticleSystem::Emit(GLint emitter, GLfloat& carry, GLfloat deltaTime, glm::vec2 position, glm::vec2 velocity,
+	glm::vec3 tint)
+{
+	if (emitter < 0)
+		return;
+
+	carry += this->m_descs[emitter].Rate * deltaTime;
+	GLuint count = (GLuint)carry;
+	carry -= count;
+	if (count > 0)
+		this->m_requests.push_back({ emitter, count, position, velocity, tint, (GLuint)this->m_requests.size() });
+}
+
+void ParticleSystem::Burst(GLint emitter, glm::vec2 position, glm::vec2 velocity, glm::vec3 tint)
+{
+	if (emitter < 0 || this->m_descs[emitter].Burst == 0)
+		return;
+
+	this->m_requests.push_back({ emitter, this->m_descs[emitter].Burst, position, velocity, tint, (GLuint)this->m_requests.size() });
+}
+
+void ParticleSystem::Update(GLfloat deltaTime)
+{
+	TRACE_ZONE("ParticleSystem::Update");
+
+	// Hand out what is left of the budget, most important emitters first.
+	// Not stable_sort, that allocates a scratch buffer every call.
+	std::sort(this->m_requests.begin(), this->m_requests.end(),
+		[this](const SpawnRequest& a, const SpawnRequest& b)
+		{
+			GLint priorityA = this->m_descs[a.Emitter].Priority;
+			GLint priorityB = this->m_descs[b.Emitter].Priority;
+			return priorityA != priorityB ? priorityA > priorityB : a.Order < b.Order;
+		});
+	for (const SpawnRequest& request : this->m_requests)
+		this->spawn(request);
+	this->m_requests.clear();
+
+	size_t i = 0;
+	while (i < this->m_live)
+	{
+		PoolParticle& p = this->m_pool[i];
+		p.Life -= deltaTime;
+		if (p.Life <= 0.0f)
+		{
+			--this->m_liveByEmitter[p.Emitter];
+			p = this->m_pool[--this->m_live];
+			continue;
+		}
+		p.Velocity.y += this->m_descs[p.Emitter].Gravity * deltaTime;
+		p.Position += p.Velocity * deltaTime;
+		++i;
+	}
+}
+
+void ParticleSystem::spawn(const SpawnRequest& request)
+{
+	const EmitterDesc& desc = this->m_descs[request.Emitter];
+	GLuint& owned = this->m_liveByEmitter[request.Emitter];
+	GLuint available = (GLuint)std::min<size_t>(this->m_pool.size() - this->m_live, desc.Max - std::min(owned, desc.Max));
+	GLuint count = std::min(request.Count, available);
+	this->m_dropped += request.Count - count;
+
+	for (GLuint n = 0; n < count; ++n)
+	{
+		PoolParticle& p = this->m_pool[this->m_live++];
+		GLfloat angle = randomRange(0.0f, 6.2831853f);
+		GLfloat speed = randomRange(0.0f, desc.Spread);
+		p.Position = request.Position + glm::vec2(randomRange(-desc.Jitter, desc.Jitter), randomRange(-desc.Jitter, desc.Jitter));
+		p.Velocity = request.Velocity * desc.Inherit + glm::vec2(std::cos(angle), std::sin(angle)) * speed;
+		p.Tint = request.Tint * randomRange(desc.Shade.x, desc.Shade.y);
+		p.Life = desc.Life;
+		p.Emitter = request.Emitter;
+	}
+	owned += count;
+}
+
+void ParticleSystem::Draw(void)
+{
+	TRACE_ZONE("ParticleSystem::Draw");
+
+	if (this->m_live == 0)
+		return;
+
+	// Counting sort by texture so each texture's instances are contiguous
+	std::fill(this->m_groupStart.begin(), this->m_groupStart.end(), 0);
+	for (size_t i = 0; i < this->m_live; ++i)
+		++this->m_groupStart[this->m_descGroup[this->m_pool[i].Emitter] + 1];
+	for (size_t g = 1; g < this->m_groupStart.size(); ++g)
+		this->m_groupStart[g] += this->m_groupStart[g - 1];
+
+	std::vector<GLuint>& cursor = this->m_groupCursor;
+	cursor.assign(this->m_groupStart.begin(), this->m_groupStart.end() - 1);
+	for (size_t i = 0; i < this->m_live; ++i)
+	{
+		const PoolParticle& p = this->m_pool[i];
+		const EmitterDesc& desc = this->m_descs[p.Emitter];
+		GLfloat t = 1.0f - p.Life / desc.Life;
+		glm::vec4 color = glm::mix(desc.Start, desc.End, t) * glm::vec4(p.Tint, 1.0f);
+		this->m_instances[cursor[this->m_descGroup[p.Emitter]]++] = { p.Position, color, desc.Size };
+	}
+
+	GLintptr offset = this->m_stream.Upload(this->m_instances.data(), this->m_live * sizeof(Instance), sizeof(GLfloat));
+	if (offset < 0)
+		return;
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE); // Use additive blending to give a glow effect
+	this->m_shader.Use();
+	glBindVertexArray(this->m_VAO.ID());
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_stream.ID());
+	for (size_t g = 0; g < this->m_textures.size(); ++g)
+	{
+		GLuint first = this->m_groupStart[g];
+		GLuint count = this->m_groupStart[g + 1] - first;
+		if (count == 0)
+			continue;
+
+		GLintptr base = offset + first * sizeof(Instance);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Instance), (GLvoid*)(base + offsetof(Instance, Offset)));
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (GLvoid*)(base + offsetof(Instance, Color)));
+		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Instance), (GLvoid*)(base + offsetof(Instance, Size)));
+		ResourceManager::GetTexture(this->m_textures[g]).Bind();
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)count);
+		RenderStats::Draw();
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	RenderStats::StateChange(3);
+}
+
+void ParticleSystem::Clear(void)
+{
+	this->m_live = 0;
+	this->m_requests.clear();
+	std::fill(this->m_liveByEmitter.begin(), this->m_liveByEmitter.end(), 0);
+}
+
+void ParticleSystem::initRenderData(void)
+{
+	float particleQuad[] = {
+		0.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 0.0f,
+
+		0.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, 1.0f, 1.0f, 1.0f,
+		1.0f, 0.0f, 1.0f, 0.0f
+	};
+
+	this->m_VAO = GLVertexArray::Create("ParticleSystem");
+	this->m_quadVBO = GLBuffer::Create("ParticleSystem quad");
+	glBindVertexArray(this->m_VAO.ID());
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_quadVBO.ID());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(particleQuad), particleQuad, GL_STATIC_DRAW);
+	this->m_quadVBO.SetBytes(sizeof(particleQuad));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
+
+	// Offset, color and size advance once per particle, Draw sets their pointers
+	for (GLuint attribute = 1; attribute <= 3; ++attribute)
+	{
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
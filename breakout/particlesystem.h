@@ -0,0 +1,119 @@
+#ifndef _particlesystem_HG_
+#define _particlesystem_HG_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "shader.h"
+#include "resourcemanager.h"
+#include "streambuffer.h"
+
+// How an emitter spawns and what its particles look like, see particles/emitters.txt
+struct EmitterDesc
+{
+	std::string	Name;
+	std::string	TextureName;
+	GLint		Priority;
+	GLuint		Max;
+	GLfloat		Rate;
+	GLuint		Burst;
+	GLfloat		Life;
+	GLfloat		Size;
+	GLfloat		Jitter;
+	GLfloat		Inherit;
+	GLfloat		Spread;
+	GLfloat		Gravity;
+	glm::vec2	Shade;
+	glm::vec4	Start;
+	glm::vec4	End;
+
+	EmitterDesc();
+};
+
+// Simulates the particles of every emitter in one shared pool and draws them in
+// one pass. Emit and Burst only queue spawn requests; Update hands out the free
+// part of the budget in priority order, so a burst of low priority particles
+// can't starve the ball trail, and each kind of emitter is capped at its Max.
+class ParticleSystem
+{
+public:
+	// shader is borrowed and must outlive the system
+	ParticleSystem(Shader& shader, StreamBuffer& stream, GLuint budget);
+
+	// Reads emitter descriptors, returns false if the file couldn't be parsed
+	bool Load(const GLchar* file);
+	// Index of the named descriptor, or -1 (and an error) if there isn't one
+	GLint Find(const std::string& name) const;
+	const EmitterDesc& Descriptor(GLint emitter) const { return m_descs[emitter]; }
+
+	// Continuous emission at the descriptor's rate. carry keeps the fraction of
+	// a particle left over between calls and belongs to whatever is emitting.
+	void Emit(GLint emitter, GLfloat& carry, GLfloat deltaTime, glm::vec2 position, glm::vec2 velocity,
+			  glm::vec3 tint = glm::vec3(1.0f));
+	// One-off emission of the descriptor's burst count
+	void Burst(GLint emitter, glm::vec2 position, glm::vec2 velocity, glm::vec3 tint = glm::vec3(1.0f));
+
+	void Update(GLfloat deltaTime);
+	void Draw(void);
+	void Clear(void);
+
+	GLuint LiveCount(void) const { return (GLuint)m_live; }
+	// Particles refused because the budget or an emitter's max was reached
+	GLuint Dropped(void) const { return m_dropped; }
+
+private:
+	struct SpawnRequest
+	{
+		GLint		Emitter;
+		GLuint		Count;
+		glm::vec2	Position;
+		glm::vec2	Velocity;
+		glm::vec3	Tint;
+		GLuint		Order;		// position in the queue, keeps equal priorities in order
+	};
+
+	struct PoolParticle
+	{
+		glm::vec2	Position;
+		glm::vec2	Velocity;
+		glm::vec3	Tint;		// tint times the random shade
+		GLfloat		Life;		// seconds left
+		GLint		Emitter;
+	};
+
+	// Per particle data read by the particle shader with an instance divisor
+	struct Instance
+	{
+		glm::vec2	Offset;
+		glm::vec4	Color;
+		GLfloat		Size;
+	};
+
+	Shader& m_shader;
+	StreamBuffer& m_stream;
+	GLVertexArray m_VAO;
+	GLBuffer m_quadVBO;
+
+	std::vector<EmitterDesc> m_descs;
+	std::vector<GLuint> m_descGroup;	// descriptor -> index into m_textures
+	std::vector<TextureHandle> m_textures;	// one draw per distinct texture
+
+	// Live particles are packed at the front, dead ones are swapped out
+	std::vector<PoolParticle> m_pool;
+	size_t m_live;
+	std::vector<GLuint> m_liveByEmitter;
+	std::vector<SpawnRequest> m_requests;
+	GLuint m_dropped;
+
+	std::vector<Instance> m_instances;
+	std::vector<GLuint> m_groupStart;
+	std::vector<GLuint> m_groupCursor;
+
+	void spawn(const SpawnRequest& request);
+	void initRenderData(void);
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "perfhud.h"
+#include "renderstats.h"
+#include "globals.h"
+
+#include <globject/globject.h>
+#include <texupload/texupload.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+const GLfloat GRAPH_X = 5.0f;
+const GLfloat GRAPH_Y = 40.0f;
+const GLfloat GRAPH_HEIGHT = 60.0f;
+const GLfloat GRAPH_BAR_WIDTH = 2.0f;
+const GLfloat GRAPH_MAX_MS = 50.0f;		// frame time at the top of the graph
+const GLfloat TARGET_MS = 1000.0f / 60.0f;
+
+// Wall clock seconds, the CPU time is real even when the game clock is fixed (headless runs)
+static double seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PerfHud::PerfHud()
+	: Visible(false)
+	, m_historyIndex(0)
+	, m_cpuTime(0.0f)
+	, m_gpuTime(0.0f)
+	, m_drawCalls(0)
+	, m_stateChanges(0)
+	, m_frameStart(0.0)
+	, m_queryIndex(0)
+	, m_timing(GL_FALSE)
+{
+	std::fill(m_frameTimes, m_frameTimes + HISTORY, 0.0f);
+	std::fill(m_queryIssued, m_queryIssued + QUERIES, GL_FALSE);
+	glGenQueries(QUERIES, m_queries);
+
+	// Every quad of the overlay is a tinted white texel
+	unsigned char white[] = { 255, 255, 255, 255 };
+	m_white.InternalFormat = GL_RGBA;
+	m_white.ImageFormat = GL_RGBA;
+	m_white.Generate(1, 1, white);
+	m_white.SetLabel("PerfHud white");
+}
+
+PerfHud::~PerfHud()
+{
+	glDeleteQueries(QUERIES, m_queries);
+}
+
+void PerfHud::BeginFrame(GLfloat deltaTime)
+{
+	RenderStats::BeginFrame();
+
+	m_frameTimes[m_historyIndex] = deltaTime * 1000.0f;
+	m_historyIndex = (m_historyIndex + 1) % HISTORY;
+	m_frameStart = seconds();
+
+	// Only time the GPU while the overlay is up
+	m_timing = Visible;
+	if (!m_timing)
+		return;
+
+	// Pick up the oldest query if the GPU has finished it; a few frames of
+	// latency is fine and never makes the CPU wait on the GPU
+	GLuint query = m_queries[m_queryIndex];
+	if (m_queryIssued[m_queryIndex])
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			m_gpuTime = elapsed / 1000000.0f;
+		}
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	m_queryIssued[m_queryIndex] = GL_TRUE;
+}
+
+void PerfHud::EndFrame(void)
+{
+	m_cpuTime = (GLfloat)((seconds() - m_frameStart) * 1000.0);
+	m_drawCalls = RenderStats::DrawCalls;
+	m_stateChanges = RenderStats::StateChanges;
+	if (m_timing)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_queryIndex = (m_queryIndex + 1) % QUERIES;
+	}
+}
+
+void PerfHud::Draw(SpriteRenderer& renderer, TextRenderer& text, const HudCounters& counters)
+{
+	if (!Visible)
+		return;
+
+	// Graph background and a line at the 60 fps budget
+	GLfloat graphWidth = HISTORY * GRAPH_BAR_WIDTH;
+	GLuint quadCount = 0;
+	m_quads[quadCount++] = { glm::vec2(GRAPH_X, GRAPH_Y), glm::vec2(graphWidth, GRAPH_HEIGHT), glm::vec4(0.0f, 0.0f, 0.0f, 0.6f) };
+	m_quads[quadCount++] = { glm::vec2(GRAPH_X, GRAPH_Y + GRAPH_HEIGHT * (1.0f - TARGET_MS / GRAPH_MAX_MS)),
+		glm::vec2(graphWidth, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 0.5f) };
+
+	// One bar per frame, oldest on the left
+	GLfloat worst = 0.0f;
+	GLfloat total = 0.0f;
+	for (GLuint i = 0; i < HISTORY; ++i)
+	{
+		GLfloat ms = m_frameTimes[(m_historyIndex + i) % HISTORY];
+		worst = std::max(worst, ms);
+		total += ms;
+
+		GLfloat height = std::min(ms / GRAPH_MAX_MS, 1.0f) * GRAPH_HEIGHT;
+		glm::vec4 color = ms <= TARGET_MS * 1.1f ? glm::vec4(0.2f, 0.9f, 0.2f, 0.9f)
+			: ms <= TARGET_MS * 2.0f ? glm::vec4(0.9f, 0.9f, 0.2f, 0.9f)
+			: glm::vec4(0.9f, 0.2f, 0.2f, 0.9f);
+		m_quads[quadCount++] = { glm::vec2(GRAPH_X + i * GRAPH_BAR_WIDTH, GRAPH_Y + GRAPH_HEIGHT - height),
+			glm::vec2(GRAPH_BAR_WIDTH, height), color };
+	}
+	renderer.DrawQuads(m_white, m_quads, quadCount);
+	renderer.Flush();
+
+	GLfloat average = total / HISTORY;
+	snprintf(m_text, sizeof(m_text),
+		"%.0f fps  frame %.2f ms  max %.2f ms\n"
+		"cpu %.2f ms  gpu %.2f ms\n"
+		"draws %u  state changes %u\n"
+		"particles %u  power-ups %u  bricks %u\n"
+		"rollback %u frames  resim %.2f ms\n"
+		"vram %.1f / %u MB  gl objects %u  uploads %u KB\n"
+		"textures %.1f MB  buffers %.1f MB  targets %.1f MB",
+		average > 0.0f ? 1000.0f / average : 0.0f, m_frameTimes[(m_historyIndex + HISTORY - 1) % HISTORY], worst,
+		m_cpuTime, m_gpuTime,
+		m_drawCalls, m_stateChanges,
+		counters.LiveParticles, counters.ActivePowerUps, counters.BricksRemaining,
+		counters.RollbackFrames, counters.ResimMs,
+		GLObjects::TotalBytes() / (1024.0f * 1024.0f), (GLuint)(GLObjects::Budget() / (1024 * 1024)), GLObjects::TotalCount(),
+		(GLuint)(TextureUploads::PendingBytes() / 1024),
+		GLObjects::CategoryBytes(VRAM_TEXTURES) / (1024.0f * 1024.0f), GLObjects::CategoryBytes(VRAM_BUFFERS) / (1024.0f * 1024.0f),
+		GLObjects::CategoryBytes(VRAM_RENDER_TARGETS) / (1024.0f * 1024.0f));
+	text.RenderText(m_text, GRAPH_X, GRAPH_Y + GRAPH_HEIGHT + 5.0f, 0.5f, glm::vec3(1.0f, 1.0f, 0.6f));
+}
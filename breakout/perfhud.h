@@ -0,0 +1,60 @@
+#ifndef _perfhud_HG_
+#define _perfhud_HG_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "spriterenderer.h"
+#include "textrenderer.h"
+#include "texture.h"
+
+// Game side numbers shown next to the render counters
+struct HudCounters
+{
+	GLuint LiveParticles;
+	GLuint ActivePowerUps;
+	GLuint BricksRemaining;
+	GLuint RollbackFrames;	// versus only, frames resimulated this frame
+	GLfloat ResimMs;
+};
+
+// Toggleable overlay with CPU/GPU frame times, a frame time graph and the
+// RenderStats counters. All graph quads go out in one sprite batch and all
+// text in one text draw so the overlay barely shows up in its own numbers.
+class PerfHud
+{
+public:
+	bool Visible;
+
+	PerfHud();
+	~PerfHud();
+
+	// Call at the very start of the frame with the time since the last one
+	void BeginFrame(GLfloat deltaTime);
+	// Call once all of the frame's rendering has been submitted, before Draw
+	void EndFrame(void);
+	void Draw(SpriteRenderer& renderer, TextRenderer& text, const HudCounters& counters);
+
+private:
+	static const GLuint HISTORY = 120;	// frames kept for the graph
+	static const GLuint QUERIES = 4;	// GPU timer queries in flight
+
+	GLfloat m_frameTimes[HISTORY];	// ms between frames
+	GLuint m_historyIndex;
+	GLfloat m_cpuTime;				// ms spent submitting the last frame
+	GLfloat m_gpuTime;				// ms the GPU spent on the most recent finished frame
+	GLuint m_drawCalls;				// counters of the measured frame, without the overlay itself
+	GLuint m_stateChanges;
+	double m_frameStart;
+
+	GLuint m_queries[QUERIES];
+	GLboolean m_queryIssued[QUERIES];
+	GLuint m_queryIndex;
+	GLboolean m_timing;
+
+	Texture2D m_white;
+	SpriteQuad m_quads[HISTORY + 2];
+	char m_text[512];
+};
+
+#endif
@@ -1,8 +1,9 @@
 #include "postprocessor.h"
+#include "renderstats.h"
 
 #include <iostream>
 
-PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int height)
+PostProcessor::PostProcessor(Shader& shader, unsigned int width, unsigned int height)
 	: PostProcessingShader(shader)
 	, Texture()
 	, Width(width)
@@ -12,27 +13,30 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
 	, Shake(GL_FALSE)
 {
 	// Init renderbuffer/framebuffer
-	glGenFramebuffers(1, &this->m_MSFBO);
-	glGenFramebuffers(1, &this->m_FBO);
-	glGenRenderbuffers(1, &this->m_RBO);
+	this->m_MSFBO = GLFramebuffer::Create("PostProcessor multisampled");
+	this->m_FBO = GLFramebuffer::Create("PostProcessor resolve");
+	this->m_RBO = GLRenderbuffer::Create("PostProcessor color");
 
 	// Get the max samples 
 	int maxSamples;
 	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
 
 	// Init renderbuffer storage with a multisampled color buffer (don't need a depth/stencil buffer)
-	glBindFramebuffer(GL_FRAMEBUFFER, this->m_MSFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, this->m_RBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->m_MSFBO.ID());
+	glBindRenderbuffer(GL_RENDERBUFFER, this->m_RBO.ID());
 	glRenderbufferStorageMultisample(GL_RENDERBUFFER, maxSamples, GL_RGB, width, height); // Allocate storage for render buffer object
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->m_RBO); // Attach MS render buffer object to framebuffer
+	this->m_RBO.SetBytes(GLObjects::TextureBytes(GL_RGB, width, height, maxSamples));
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->m_RBO.ID()); // Attach MS render buffer object to framebuffer
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
 		std::cout << "ERROR::POSTPROCESSOR: Failed to init MSFBO\n";
 	}
 
 	// Also init the FBO/texture to blit multisampled color-buffer to; used for shader operations (for postprocessing effects)
-	glBindFramebuffer(GL_FRAMEBUFFER, this->m_FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->m_FBO.ID());
 	this->Texture.Generate(width, height, NULL);
+	this->Texture.SetLabel("PostProcessor resolve");
+	this->Texture.SetCategory(VRAM_RENDER_TARGETS);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Texture.ID, 0);
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
@@ -75,18 +79,20 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
 
 void PostProcessor::BeginRender(void)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, this->m_MSFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->m_MSFBO.ID());
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
+	RenderStats::StateChange();
 }
 
 void PostProcessor::EndRender(void)
 {
 	// Now resolve multisampled color-buffer into intermediate FBO to store to texture
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->m_MSFBO);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->m_FBO);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->m_MSFBO.ID());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->m_FBO.ID());
 	glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);  // Binds both READ and WRITE framebuffer to default frame buffer
+	RenderStats::StateChange(3);
 }
 
 void PostProcessor::Render(float time)
@@ -101,15 +107,16 @@ void PostProcessor::Render(float time)
 	// Render texture quad
 	glActiveTexture(GL_TEXTURE0);
 	this->Texture.Bind();
-	glBindVertexArray(this->m_VAO);
+	glBindVertexArray(this->m_VAO.ID());
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 	glBindVertexArray(0);
+	RenderStats::StateChange();
+	RenderStats::Draw();
 }
 
 void PostProcessor::initRenderData(void)
 {
 	// Configure VAO/VBO
-	GLuint VBO;
 	GLfloat vertices[] = {
 		// Pos		    // Tex
 		-1.0f, -1.0f,   0.0f, 0.0f,
@@ -121,13 +128,14 @@ void PostProcessor::initRenderData(void)
 		 1.0f,  1.0f,   1.0f, 1.0f
 	};
 
-	glGenVertexArrays(1, &this->m_VAO);
-	glGenBuffers(1, &VBO);
+	this->m_VAO = GLVertexArray::Create("PostProcessor");
+	this->m_VBO = GLBuffer::Create("PostProcessor quad");
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_VBO.ID());
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	this->m_VBO.SetBytes(sizeof(vertices));
 
-	glBindVertexArray(this->m_VAO);
+	glBindVertexArray(this->m_VAO.ID());
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GL_FLOAT), (GLvoid*)0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
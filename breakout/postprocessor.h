@@ -11,7 +11,7 @@
 class PostProcessor
 {
 public:
-	Shader PostProcessingShader;
+	Shader& PostProcessingShader;
 	Texture2D Texture;
 	unsigned int Width;
 	unsigned int Height;
@@ -19,16 +19,18 @@ public:
 	bool Chaos;
 	bool Shake;
 
-	PostProcessor(Shader shader, unsigned int width, unsigned int height);
+	// shader is borrowed and must outlive the post processor
+	PostProcessor(Shader& shader, unsigned int width, unsigned int height);
 	void BeginRender(void);
 	void EndRender(void);
 	void Render(float time);
 
 private:
-	unsigned int m_MSFBO; // Multisampled FBO
-	unsigned int m_FBO;   // Regular FBO used for blitting MS color-buffer to texture
-	unsigned int m_RBO;   // Used for multisampled color buffer
-	unsigned int m_VAO;
+	GLFramebuffer m_MSFBO;	// Multisampled FBO
+	GLFramebuffer m_FBO;	// Regular FBO used for blitting MS color-buffer to texture
+	GLRenderbuffer m_RBO;	// Used for multisampled color buffer
+	GLVertexArray m_VAO;
+	GLBuffer m_VBO;
 
 	// Init quad for rendering postprocessing texture
 	void initRenderData(void);
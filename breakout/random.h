@@ -0,0 +1,38 @@
+#ifndef _random_HG_
+#define _random_HG_
+
+#include <cstdint>
+
+// Seeded generator (xorshift64*) for everything that changes the simulation.
+// It has its own state, so a seed reproduces the same power-ups whatever the
+// particles or anything else take from rand() in between.
+class Random
+{
+public:
+	explicit Random(uint64_t seed = 1) { this->Seed(seed); }
+
+	void Seed(uint64_t seed)
+	{
+		// splitmix64 spreads small seeds over the whole state, which must not be 0
+		uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		m_state = (z ^ (z >> 31)) | 1;
+	}
+
+	uint32_t Next()
+	{
+		m_state ^= m_state >> 12;
+		m_state ^= m_state << 25;
+		m_state ^= m_state >> 27;
+		return (uint32_t)((m_state * 0x2545F4914F6CDD1DULL) >> 32);
+	}
+
+	// Uniform in [0, bound)
+	uint32_t Below(uint32_t bound) { return (uint32_t)(((uint64_t)this->Next() * bound) >> 32); }
+
+private:
+	uint64_t m_state;
+};
+
+#endif
@@ -0,0 +1,12 @@
+#include "renderstats.h"
+
+// Instantiate static vars
+GLuint RenderStats::DrawCalls = 0;
+GLuint RenderStats::StateChanges = 0;
+
+void RenderStats::BeginFrame()
+{
+	DrawCalls = 0;
+	StateChanges = 0;
+}
+
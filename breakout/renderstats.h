@@ -0,0 +1,27 @@
+#ifndef _renderstats_HG_
+#define _renderstats_HG_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// A static collection of counters the renderers bump as they issue GL work.
+// Counters are cleared by BeginFrame. GPU memory is tracked per object by
+// GLObjects, see globject/globject.h.
+class RenderStats
+{
+public:
+	// Per frame
+	static GLuint DrawCalls;
+	static GLuint StateChanges;	// program, texture, vertex array, blend and framebuffer binds
+
+	static void BeginFrame();
+
+	static void Draw(GLuint count = 1) { DrawCalls += count; }
+	static void StateChange(GLuint count = 1) { StateChanges += count; }
+
+private:
+	RenderStats() {}
+};
+
+#endif
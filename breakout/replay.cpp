@@ -0,0 +1,239 @@
+#include "replay.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// fopen is deprecated under MSVC's /sdl
+	FILE* openFile(const char* path, const char* mode)
+	{
+#ifdef _MSC_VER
+		FILE* file = nullptr;
+		return fopen_s(&file, path, mode) == 0 ? file : nullptr;
+#else
+		return fopen(path, mode);
+#endif
+	}
+}
+
+Replay::Replay()
+	: m_settings()
+	, m_file(nullptr)
+	, m_playing(false)
+	, m_cursor(0)
+	, m_phaseOpen(false)
+	, m_diverged(false)
+	, m_ticks(0)
+{
+}
+
+Replay::~Replay()
+{
+	if (m_file)
+		fclose(m_file);
+}
+
+bool Replay::StartRecording(const char* path, const ReplaySettings& settings)
+{
+	this->Stop();
+	m_file = openFile(path, "wb");
+	if (!m_file)
+	{
+		std::cout << "ERROR::REPLAY: Couldn't create " << path << "\n";
+		return false;
+	}
+	m_path = path;
+	m_settings = settings;
+	m_ticks = 0;
+	m_phaseOpen = false;
+
+	this->write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+	this->write(REPLAY_VERSION);
+	this->write(settings.Seed);
+	this->write(settings.Balls);
+	this->write(settings.Width);
+	this->write(settings.Height);
+	this->write(settings.StartTime);
+	return true;
+}
+
+bool Replay::StartPlayback(const char* path)
+{
+	this->Stop();
+	FILE* file = openFile(path, "rb");
+	if (!file)
+	{
+		std::cout << "ERROR::REPLAY: Couldn't open " << path << "\n";
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	m_data.resize(size > 0 ? (size_t)size : 0);
+	size_t got = m_data.empty() ? 0 : fread(&m_data[0], 1, m_data.size(), file);
+	fclose(file);
+
+	m_path = path;
+	m_playing = true;
+	m_cursor = 0;
+	m_ticks = 0;
+	m_phaseOpen = false;
+	m_diverged = false;
+
+	char magic[4];
+	uint32_t version = 0;
+	if (got != m_data.size() || m_data.size() < 32 || !this->read(magic) || memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0
+		|| !this->read(version) || version != REPLAY_VERSION)
+	{
+		std::cout << "ERROR::REPLAY: " << path << " isn't a version " << REPLAY_VERSION << " replay\n";
+		m_playing = false;
+		m_data.clear();
+		return false;
+	}
+	this->read(m_settings.Seed);
+	this->read(m_settings.Balls);
+	this->read(m_settings.Width);
+	this->read(m_settings.Height);
+	this->read(m_settings.StartTime);
+	return true;
+}
+
+void Replay::Stop()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+		std::cout << "REPLAY: Recorded " << m_ticks << " ticks to " << m_path << "\n";
+	}
+	if (m_playing)
+	{
+		if (!m_diverged)
+			std::cout << "REPLAY: Played " << m_ticks << " ticks from " << m_path << ", every state hash matched\n";
+		m_playing = false;
+		m_data.clear();
+		m_data.shrink_to_fit();
+	}
+}
+
+GLfloat Replay::TickDelta(GLfloat deltaTime)
+{
+	if (m_file)
+		this->write(deltaTime);
+	else if (m_playing)
+		this->read(deltaTime);
+	return deltaTime;
+}
+
+double Replay::BeginInput(double until)
+{
+	this->closePhase();
+	if (m_file)
+		this->write(until);
+	else if (m_playing)
+		this->read(until);
+	else
+		return until;
+	m_phaseOpen = true;
+	return until;
+}
+
+void Replay::RecordEvent(const InputEvent& event)
+{
+	if (!m_file)
+		return;
+	uint8_t tag = (uint8_t)(event.Action + 1);
+	uint16_t key = (uint16_t)event.Key;
+	this->write(tag);
+	this->write(key);
+	this->write(event.Time);
+}
+
+bool Replay::NextEvent(InputEvent& event)
+{
+	if (!m_playing || !m_phaseOpen)
+		return false;
+	uint8_t tag = 0;
+	uint16_t key = 0;
+	if (!this->read(tag) || tag == 0)
+	{
+		m_phaseOpen = false;
+		return false;
+	}
+	if (!this->read(key) || !this->read(event.Time))
+	{
+		m_phaseOpen = false;
+		return false;
+	}
+	event.Key = key;
+	event.Action = tag - 1;
+	return true;
+}
+
+void Replay::EndTick(uint64_t hash)
+{
+	this->closePhase();
+	if (m_file)
+	{
+		this->write(hash);
+	}
+	else if (m_playing)
+	{
+		uint64_t recorded = 0;
+		if (!this->read(recorded))
+			return;
+		if (hash != recorded)
+		{
+			char line[160];
+			snprintf(line, sizeof(line), "ERROR::REPLAY: Diverged at tick %u, state hash %016llx, recorded %016llx\n",
+				m_ticks, (unsigned long long)hash, (unsigned long long)recorded);
+			std::cout << line;
+			m_diverged = true;
+		}
+	}
+	else
+	{
+		return;
+	}
+	++m_ticks;
+}
+
+void Replay::write(const void* data, size_t size)
+{
+	fwrite(data, 1, size, m_file);
+}
+
+bool Replay::read(void* data, size_t size)
+{
+	if (m_cursor + size > m_data.size())
+	{
+		if (m_cursor < m_data.size())
+			std::cout << "ERROR::REPLAY: " << m_path << " ends in the middle of tick " << m_ticks << "\n";
+		m_cursor = m_data.size();
+		return false;
+	}
+	memcpy(data, &m_data[m_cursor], size);
+	m_cursor += size;
+	return true;
+}
+
+void Replay::closePhase()
+{
+	if (!m_phaseOpen)
+		return;
+	if (m_file)
+	{
+		uint8_t end = 0;
+		this->write(end);
+	}
+	else
+	{
+		// Skip whatever the game didn't ask for
+		InputEvent event;
+		while (this->NextEvent(event))
+		{
+		}
+	}
+	m_phaseOpen = false;
+}
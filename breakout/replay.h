@@ -0,0 +1,125 @@
+#ifndef _replay_HG_
+#define _replay_HG_
+
+#include <glad/glad.h>
+
+#include "inputqueue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Replay log layout, little endian:
+//
+//	"BRPL" u32 version, ReplaySettings field by field
+//	per tick:
+//		f32 delta time
+//		two input phases (ProcessInput, LateLatchInput), each
+//			f64 time input was consumed up to
+//			per event: u8 action + 1, u16 key, f64 time
+//			u8 0
+//		u64 hash of the state the tick left behind
+//
+// Times are stored exactly as they were used, a replayed tick does the same
+// float maths as the recorded one.
+const char REPLAY_MAGIC[4] = { 'B', 'R', 'P', 'L' };
+const uint32_t REPLAY_VERSION = 2;
+
+// Everything outside the input that the simulation depends on
+struct ReplaySettings
+{
+	uint32_t	Seed;
+	uint32_t	Balls;
+	uint32_t	Width;
+	uint32_t	Height;
+	double		StartTime;	// input time at the end of Game::Init
+};
+
+// 64 bit FNV-1a, fed one field at a time so padding never gets hashed
+class StateHash
+{
+public:
+	StateHash() : m_value(14695981039346656037ULL) {}
+
+	void Add(const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; ++i)
+			m_value = (m_value ^ bytes[i]) * 1099511628211ULL;
+	}
+	template <typename T>
+	void Add(const T& value) { this->Add(&value, sizeof(T)); }
+
+	uint64_t Value() const { return m_value; }
+
+private:
+	uint64_t m_value;
+};
+
+// Records a session (its settings, every tick's delta time and the input the
+// game consumed) or plays one back in place of the clock and the keyboard.
+// Game calls the tick hooks below in a fixed order, so playback reads the log
+// in the order it was written. Each tick ends with a hash of the simulation
+// state; playback compares it with the recorded one and stops at the first
+// tick that differs.
+//
+// Recording writes through stdio and playback reads a log loaded up front,
+// neither allocates once a session is running.
+class Replay
+{
+public:
+	Replay();
+	~Replay();
+
+	bool StartRecording(const char* path, const ReplaySettings& settings);
+	// Loads the whole log, Settings() are the recorded ones afterwards
+	bool StartPlayback(const char* path);
+	// Closes the recording or ends playback, printing a summary
+	void Stop();
+
+	bool Recording() const { return m_file != nullptr; }
+	bool Playing() const { return m_playing; }
+	// Playback has run out of ticks, diverged or hit a damaged log
+	bool Finished() const { return m_playing && (m_diverged || m_cursor >= m_data.size()); }
+	bool Diverged() const { return m_diverged; }
+	const ReplaySettings& Settings() const { return m_settings; }
+	GLuint Ticks() const { return m_ticks; }
+
+	// Tick hooks, in this order every tick. Each passes the live value
+	// through when recording (and logs it), returns the recorded one when
+	// playing, and does nothing otherwise.
+	GLfloat TickDelta(GLfloat deltaTime);
+	double BeginInput(double until);
+	// Live events consumed by the game, recording only
+	void RecordEvent(const InputEvent& event);
+	// The recorded events of the current input phase, playback only
+	bool NextEvent(InputEvent& event);
+	void EndTick(uint64_t hash);
+
+	Replay(const Replay&) = delete;
+	Replay& operator=(const Replay&) = delete;
+
+private:
+	ReplaySettings				m_settings;
+	std::string					m_path;
+	FILE*						m_file;			// open while recording
+	bool						m_playing;
+	std::vector<unsigned char>	m_data;			// the log being played
+	size_t						m_cursor;
+	bool						m_phaseOpen;	// events (or the terminator) of a phase come next
+	bool						m_diverged;
+	GLuint						m_ticks;
+
+	void write(const void* data, size_t size);
+	template <typename T>
+	void write(const T& value) { this->write(&value, sizeof(T)); }
+	// False (and playback stops) if the log ends early
+	bool read(void* data, size_t size);
+	template <typename T>
+	bool read(T& value) { return this->read(&value, sizeof(T)); }
+	void closePhase();
+};
+
+#endif
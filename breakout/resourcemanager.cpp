@@ -1,91 +1,240 @@
 #include "resourcemanager.h"
+#include "assets.h"
 
 #include <iostream>
-#include <sstream>
-#include <fstream>
+#include <thread>
+#include <utility>
 
+#include <dds/dds.h>
+#include <memtrack/memtrack.h>
 #include <stb_image/stb_image.h>
+#include <trace/trace.h>
 
 // Instantiate static vars
-std::map<std::string, Shader> ResourceManager::Shaders;
-std::map<std::string, Texture2D> ResourceManager::Textures;
+ResourceManager::Slots<Shader> ResourceManager::s_shaders;
+std::vector<uint32_t> ResourceManager::s_pendingShaders;
+ResourceManager::Slots<Texture2D> ResourceManager::s_textures;
+Shader ResourceManager::s_missingShader;
+Texture2D* ResourceManager::s_missingTexture = nullptr;
 
-Shader ResourceManager::LoadShader(const GLchar* vShaderFile, const GLchar* fShaderFile, const GLchar* gShaderFile, std::string name)
+namespace
 {
-	Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
-	return Shaders[name];
+	const uint32_t HANDLE_INDEX_BITS = 16;
+	const uint32_t HANDLE_INDEX_MASK = (1u << HANDLE_INDEX_BITS) - 1;
+
+	// Shown instead of a texture that couldn't be found
+	const unsigned char MISSING_TEXEL[] = { 255, 0, 255 };
 }
 
-Shader& ResourceManager::GetShader(std::string name)
+template <typename T>
+ResourceHandle<T> ResourceManager::store(Slots<T>& slots, const std::string& name, T&& item)
 {
-	return Shaders[name];
+	uint32_t index;
+	auto named = slots.Names.find(name);
+	if (named != slots.Names.end())
+	{
+		index = named->second;
+	}
+	else if (!slots.Free.empty())
+	{
+		index = slots.Free.back();
+		slots.Free.pop_back();
+		slots.Names[name] = index;
+	}
+	else
+	{
+		index = (uint32_t)slots.Items.size();
+		if (index > HANDLE_INDEX_MASK)
+		{
+			std::cout << "ERROR::RESOURCE: Too many resources loading " << name << "\n";
+			return ResourceHandle<T>();
+		}
+		slots.Items.emplace_back();
+		slots.Generations.push_back(1);
+		slots.Names[name] = index;
+	}
+	// Moving over a replaced resource deletes its GL object
+	item.SetLabel(name);
+	slots.Items[index] = std::move(item);
+	return ResourceHandle<T>(((uint32_t)slots.Generations[index] << HANDLE_INDEX_BITS) | index);
 }
 
-// Loads (and generates a texture from file
-Texture2D ResourceManager::LoadTexture(const GLchar* file, GLboolean alpha, std::string name)
+template <typename T>
+void ResourceManager::retire(Slots<T>& slots)
 {
-	Textures[name] = loadTextureFromFile(file, alpha);
-	return Textures[name];
+	slots.Names.clear();
+	slots.Free.clear();
+	for (uint32_t index = 0; index < slots.Generations.size(); ++index)
+	{
+		slots.Generations[index] = slots.Generations[index] == 0xFFFF ? 1 : slots.Generations[index] + 1;
+		slots.Free.push_back(index);
+	}
 }
 
-Texture2D& ResourceManager::GetTexture(std::string name)
+template <typename T>
+T* ResourceManager::resolve(Slots<T>& slots, ResourceHandle<T> handle)
 {
-	return Textures[name];
+	uint32_t index = handle.Value & HANDLE_INDEX_MASK;
+	uint32_t generation = handle.Value >> HANDLE_INDEX_BITS;
+	if (!handle.IsValid() || index >= slots.Items.size() || slots.Generations[index] != generation)
+		return nullptr;
+	return &slots.Items[index];
 }
 
-void ResourceManager::Clear()
+ShaderHandle ResourceManager::LoadShader(const GLchar* vShaderFile, const GLchar* fShaderFile, const GLchar* gShaderFile, const std::string& name)
 {
-	// (Properly) delete all shaders
-	for (auto iter : Shaders)
-		glDeleteProgram(iter.second.ID);
-	for (auto iter : Textures)
-		glDeleteTextures(1, &iter.second.ID);
+	MEMTRACK_SCOPE(MEM_ASSETS);
+	ShaderHandle handle = store(s_shaders, name, loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile));
+	if (handle.IsValid())
+		s_pendingShaders.push_back(handle.Value & HANDLE_INDEX_MASK);
+	return handle;
 }
 
-Shader ResourceManager::loadShaderFromFile(const GLchar* vShaderFile, const GLchar* fShaderFile, const GLchar* gShaderFile)
+ShaderHandle ResourceManager::LoadFeedbackShader(const GLchar* vShaderFile, const GLchar* const* varyings, GLsizei varyingCount, const std::string& name)
 {
+	MEMTRACK_SCOPE(MEM_ASSETS);
 	std::string vertexCode;
-	std::string fragmentCode;
-	std::string geometryCode;
-	
-	try
+	if (!Assets::Read(vShaderFile, vertexCode))
+		std::cout << "ERROR::SHADER: Failed to read " << vShaderFile << "\n";
+
+	Shader shader;
+	shader.Submit(vertexCode.c_str(), nullptr, nullptr, varyings, varyingCount);
+	ShaderHandle handle = store(s_shaders, name, std::move(shader));
+	if (handle.IsValid())
+		s_pendingShaders.push_back(handle.Value & HANDLE_INDEX_MASK);
+	return handle;
+}
+
+void ResourceManager::FinishShaders()
+{
+	TRACE_ZONE("ResourceManager::FinishShaders");
+	while (!s_pendingShaders.empty())
 	{
-		std::ifstream vertexShaderFile(vShaderFile);
-		std::ifstream fragmentShaderFile(fShaderFile);
-		std::stringstream vShaderStream;
-		std::stringstream fShaderStream;
-
-		// Read file's buffer contents into streams
-		vShaderStream << vertexShaderFile.rdbuf();
-		fShaderStream << fragmentShaderFile.rdbuf();
-		
-		vertexShaderFile.close();
-		fragmentShaderFile.close();
-
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-
-		if (gShaderFile != nullptr)
+		bool finished = false;
+		for (size_t i = 0; i < s_pendingShaders.size();)
 		{
-			std::ifstream geometryShaderFile(gShaderFile);
-			std::stringstream gShaderStream;
-			gShaderStream << geometryShaderFile.rdbuf();
-			geometryShaderFile.close();
-			geometryCode = gShaderStream.str();
-
+			Shader& shader = s_shaders.Items[s_pendingShaders[i]];
+			if (shader.Ready())
+			{
+				shader.Finish();
+				s_pendingShaders[i] = s_pendingShaders.back();
+				s_pendingShaders.pop_back();
+				finished = true;
+			}
+			else
+			{
+				++i;
+			}
 		}
+		// Only happens with parallel compile, the driver is still busy with all of them
+		if (!finished)
+			std::this_thread::yield();
+	}
+}
+
+ShaderHandle ResourceManager::FindShader(const std::string& name)
+{
+	auto named = s_shaders.Names.find(name);
+	if (named == s_shaders.Names.end())
+	{
+		std::cout << "ERROR::RESOURCE: No shader named " << name << " was loaded\n";
+		return ShaderHandle();
+	}
+	return ShaderHandle(((uint32_t)s_shaders.Generations[named->second] << HANDLE_INDEX_BITS) | named->second);
+}
+
+Shader& ResourceManager::GetShader(ShaderHandle handle)
+{
+	if (!s_pendingShaders.empty())
+		FinishShaders();
+	Shader* shader = resolve(s_shaders, handle);
+	if (shader)
+		return *shader;
+
+	static bool reported = false;
+	if (!reported)
+	{
+		std::cout << "ERROR::RESOURCE: Invalid or stale shader handle " << handle.Value << "\n";
+		reported = true;
 	}
-	catch (std::exception e)
+	return s_missingShader;
+}
+
+// Loads (and generates a texture from file
+TextureHandle ResourceManager::LoadTexture(const GLchar* file, GLboolean alpha, const std::string& name)
+{
+	MEMTRACK_SCOPE(MEM_ASSETS);
+	Texture2D texture = loadTextureFromFile(file, alpha);
+	if (texture.Width == 0)
 	{
-		std::cout << "ERROR::SHADER: Failed to read the shader files\n";
+		// Already reported, anything using the name gets the missing texture
+		return TextureHandle();
 	}
+	return store(s_textures, name, std::move(texture));
+}
+
+TextureHandle ResourceManager::FindTexture(const std::string& name)
+{
+	auto named = s_textures.Names.find(name);
+	if (named == s_textures.Names.end())
+	{
+		std::cout << "ERROR::RESOURCE: No texture named " << name << " was loaded\n";
+		return TextureHandle();
+	}
+	return TextureHandle(((uint32_t)s_textures.Generations[named->second] << HANDLE_INDEX_BITS) | named->second);
+}
+
+Texture2D& ResourceManager::GetTexture(TextureHandle handle)
+{
+	Texture2D* texture = resolve(s_textures, handle);
+	if (texture)
+		return *texture;
+
+	if (!s_missingTexture)
+	{
+		std::cout << "ERROR::RESOURCE: Invalid or stale texture handle " << handle.Value << "\n";
+		s_missingTexture = new Texture2D();
+		s_missingTexture->Generate(1, 1, const_cast<unsigned char*>(MISSING_TEXEL));
+	}
+	return *s_missingTexture;
+}
+
+void ResourceManager::Clear()
+{
+	// (Properly) delete all shaders and textures, the slots stay for reuse
+	s_pendingShaders.clear();
+	for (Shader& shader : s_shaders.Items)
+		shader = Shader();
+	for (Texture2D& texture : s_textures.Items)
+		texture = Texture2D();
+	delete s_missingTexture;
+	s_missingTexture = nullptr;
+
+	// Bump every generation so handles from before the clear are caught
+	retire(s_shaders);
+	retire(s_textures);
+}
+
+Shader ResourceManager::loadShaderFromFile(const GLchar* vShaderFile, const GLchar* fShaderFile, const GLchar* gShaderFile)
+{
+	std::string vertexCode;
+	std::string fragmentCode;
+	std::string geometryCode;
+
+	// Embedded sources are used when there are any, see assets.h
+	if (!Assets::Read(vShaderFile, vertexCode))
+		std::cout << "ERROR::SHADER: Failed to read " << vShaderFile << "\n";
+	if (!Assets::Read(fShaderFile, fragmentCode))
+		std::cout << "ERROR::SHADER: Failed to read " << fShaderFile << "\n";
+	if (gShaderFile != nullptr && !Assets::Read(gShaderFile, geometryCode))
+		std::cout << "ERROR::SHADER: Failed to read " << gShaderFile << "\n";
 
 	const GLchar* vShaderCode = vertexCode.c_str();
 	const GLchar* fShaderCode = fragmentCode.c_str();
 	const GLchar* gShaderCode = geometryCode.c_str();
 
 	Shader shader;
-	shader.Compile(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
+	shader.Submit(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
 	return shader;
 }
 
@@ -98,19 +247,32 @@ Texture2D ResourceManager::loadTextureFromFile(const GLchar* file, GLboolean alp
 		texture.ImageFormat = GL_RGBA;
 	}
 
+	// A cooked .dds next to the image already has its mips (and is compressed),
+	// it was flipped when it was cooked
+	VfsFile cooked = Assets::Open(Dds::CookedPath(file).c_str());
+	DdsImage levels;
+	if (cooked && Dds::Parse(cooked.Data(), cooked.Size(), levels) && (!levels.Compressed || Dds::CompressedSupported()))
+	{
+		texture.Generate(levels);
+		return texture;
+	}
+
 	int width;
 	int height;
 	int nrChannels;
 	
 	stbi_set_flip_vertically_on_load(true); // use stbi to flip a texture on y-axis
-	unsigned char* image = stbi_load(file, &width, &height, &nrChannels, 0);
+	VfsFile source = Assets::Open(file);
+	unsigned char* image = source
+		? stbi_load_from_memory(source.Data(), (int)source.Size(), &width, &height, &nrChannels, 0)
+		: nullptr;
 	if (image)
 	{
 		texture.Generate(width, height, image);
 	}
 	else
 	{
-		std::cout << "Failed to load texture\n";
+		std::cout << "ERROR::TEXTURE: Failed to load " << file << "\n";
 	}
 	
 	stbi_image_free(image);
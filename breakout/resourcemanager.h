@@ -3,37 +3,96 @@
 
 #include <glad/glad.h>
 
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "texture.h"
 #include "shader.h"
 
+// Typed reference to a resource held by the ResourceManager. The low 16 bits
+// index the manager's array, the high 16 bits hold the generation that slot
+// had when the handle was made, so a handle kept past Clear() is caught
+// instead of quietly resolving to whatever was loaded into the slot next.
+// A default constructed handle refers to nothing.
+template <typename T>
+struct ResourceHandle
+{
+	uint32_t Value;
+
+	ResourceHandle() : Value(0) {}
+	explicit ResourceHandle(uint32_t value) : Value(value) {}
+
+	bool IsValid() const { return this->Value != 0; }
+	bool operator==(ResourceHandle other) const { return this->Value == other.Value; }
+	bool operator!=(ResourceHandle other) const { return this->Value != other.Value; }
+};
+
+typedef ResourceHandle<Texture2D> TextureHandle;
+typedef ResourceHandle<Shader> ShaderHandle;
+
 // A static singleton ResourceManager class that hosts
 // several functions to load Textures and Shaders. Each loaded
-// texture and or shader is also stored for future reference by 
-// handles. All func and resources are static
+// texture and or shader is stored in an array and referred to by
+// handle, names are only looked at while loading. All func and
+// resources are static. The manager owns every resource it loads,
+// references returned by GetShader/GetTexture stay valid until Clear.
 class ResourceManager
 {
 public:
-	static std::map<std::string, Shader> Shaders;
-	static std::map<std::string, Texture2D> Textures;
-	
 	// Loads (and generates) a shader program from file loading vertex, fragment, geometry shader's source code.
-	static Shader LoadShader(const GLchar* vShaderFile, const GLchar* fShaderFile, const GLchar* gShaderFile, std::string name);
-	static Shader& GetShader(std::string name);
+	// Loading under a name that's already in use replaces that shader and keeps its handle.
+	// The program is only submitted to the driver, see FinishShaders.
+	static ShaderHandle LoadShader(const GLchar* vShaderFile, const GLchar* fShaderFile, const GLchar* gShaderFile, const std::string& name);
+	// Loads a vertex shader only program whose outputs are captured with transform feedback
+	static ShaderHandle LoadFeedbackShader(const GLchar* vShaderFile, const GLchar* const* varyings, GLsizei varyingCount, const std::string& name);
+	// Waits for every shader loaded since the last call, taking them in the order the
+	// driver finishes them. Load all shaders before this so they compile together,
+	// GetShader calls it if anything is still pending.
+	static void FinishShaders();
+	// Resolves a name to a handle, resolve once and keep the handle. Unknown names are
+	// reported and give an invalid handle.
+	static ShaderHandle FindShader(const std::string& name);
+	// O(1). Invalid or stale handles are reported and resolve to a program that draws nothing.
+	static Shader& GetShader(ShaderHandle handle);
 
 	// Loads (and generates a texture from file
-	static Texture2D LoadTexture(const GLchar* file, GLboolean alpha, std::string name);
-	static Texture2D& GetTexture(std::string name);
+	static TextureHandle LoadTexture(const GLchar* file, GLboolean alpha, const std::string& name);
+	static TextureHandle FindTexture(const std::string& name);
+	// O(1). Invalid or stale handles are reported and resolve to a magenta texture.
+	static Texture2D& GetTexture(TextureHandle handle);
 
-	// properly de-allocate resources
+	// properly de-allocate resources, every handle handed out so far goes stale
 	static void Clear();
 
 private:
+	template <typename T>
+	struct Slots
+	{
+		std::deque<T>					Items;			// deque so growing never moves a resource
+		std::vector<uint16_t>			Generations;	// never 0, so no valid handle is 0
+		std::vector<uint32_t>			Free;
+		std::map<std::string, uint32_t>	Names;			// name -> index, load time only
+	};
+
+	static Slots<Shader> s_shaders;
+	static std::vector<uint32_t> s_pendingShaders;	// slot indices
+	static Slots<Texture2D> s_textures;
+	static Shader s_missingShader;
+	static Texture2D* s_missingTexture;	// made on first use, there's no GL context yet at static init
+
 	ResourceManager() {} // make this private so its a singleton
 	static Shader loadShaderFromFile(const GLchar* vShaderFile, const GLchar* fShaderFile, const GLchar* gShaderFile = nullptr);
 	static Texture2D loadTextureFromFile(const GLchar* file, GLboolean alpha);
+
+	template <typename T>
+	static ResourceHandle<T> store(Slots<T>& slots, const std::string& name, T&& item);
+	template <typename T>
+	static void retire(Slots<T>& slots);
+	template <typename T>
+	static T* resolve(Slots<T>& slots, ResourceHandle<T> handle);
 };
 
-#endif
\ No newline at end of file
+#endif
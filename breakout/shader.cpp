@@ -1,60 +1,105 @@
 #include "shader.h"
+#include "renderstats.h"
+
+#include <shadercache/shadercache.h>
+
 #include <iostream>
+#include <vector>
 
 Shader& Shader::Use()
 {
+	RenderStats::StateChange();
 	glUseProgram(this->ID);
 	// persists the changes. need to return a reference and return * so that glUseProgram takes effect
 	return *this; 
 }
 
-void Shader::Compile(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar* geometrySource)
+namespace
+{
+	GLShader compileStage(GLenum type, const GLchar* source)
+	{
+		GLShader stage = GLShader::Adopt(glCreateShader(type), "Shader stage");
+		glShaderSource(stage.ID(), 1, &source, NULL);
+		glCompileShader(stage.ID());
+		return stage;
+	}
+}
+
+void Shader::Compile(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar* geometrySource,
+	const GLchar* const* feedbackVaryings, GLsizei feedbackCount)
 {
-	GLuint sVertex, sFragment, sGeometry;
+	this->Submit(vertexSource, fragmentSource, geometrySource, feedbackVaryings, feedbackCount);
+	this->Finish();
+}
 
-	// Vertex shader
-	// -------------
-	sVertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(sVertex, 1, &vertexSource, NULL);
-	glCompileShader(sVertex);
-	checkCompileErrors(sVertex, ERROR_TYPE::VERTEX);
+void Shader::Submit(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar* geometrySource,
+	const GLchar* const* feedbackVaryings, GLsizei feedbackCount)
+{
+	// Shader program, replaces any program compiled before
+	this->m_program = GLProgram::Create("Shader");
+	this->ID = this->m_program.ID();
+	for (GLShader& stage : this->m_stages)
+		stage.Reset();
 
-	// Fragment shader
-	// ---------------
-	sFragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(sFragment, 1, &fragmentSource, NULL);
-	glCompileShader(sFragment);
-	checkCompileErrors(sFragment, ERROR_TYPE::FRAGMENT);
+	// The varyings are part of the key, they change what the binary captures
+	std::vector<const GLchar*> parts = { vertexSource, fragmentSource, geometrySource };
+	if (feedbackVaryings != nullptr)
+		parts.insert(parts.end(), feedbackVaryings, feedbackVaryings + feedbackCount);
+	this->m_cacheKey = ShaderCache::Key(parts.data(), (int)parts.size());
+	if (ShaderCache::Load(this->ID, this->m_cacheKey))
+		return;
 
-	// Geometry shader
-	// ---------------
+	// Nothing below waits on the driver, errors are only looked at in Finish
+	this->m_stages[VERTEX] = compileStage(GL_VERTEX_SHADER, vertexSource);
+	glAttachShader(this->ID, this->m_stages[VERTEX].ID());
+	// fragmentSource may be null for transform feedback only programs
+	if (fragmentSource != nullptr)
+	{
+		this->m_stages[FRAGMENT] = compileStage(GL_FRAGMENT_SHADER, fragmentSource);
+		glAttachShader(this->ID, this->m_stages[FRAGMENT].ID());
+	}
 	if (geometrySource != nullptr)
 	{
-		sGeometry = glCreateShader(GL_GEOMETRY_SHADER);
-		glShaderSource(sGeometry, 1, &geometrySource, NULL);
-		glCompileShader(sGeometry);
-		checkCompileErrors(sGeometry, ERROR_TYPE::GEOMETRY);
+		this->m_stages[GEOMETRY] = compileStage(GL_GEOMETRY_SHADER, geometrySource);
+		glAttachShader(this->ID, this->m_stages[GEOMETRY].ID());
 	}
 
-	// Shader program
-	this->ID = glCreateProgram();
-	glAttachShader(this->ID, sVertex);
-	glAttachShader(this->ID, sFragment);
-
-	if (geometrySource != nullptr)
+	// Has to be set before linking
+	if (feedbackVaryings != nullptr)
+	{
+		glTransformFeedbackVaryings(this->ID, feedbackCount, feedbackVaryings, GL_INTERLEAVED_ATTRIBS);
+	}
+	if (ShaderCache::Enabled())
 	{
-		glAttachShader(this->ID, sGeometry);
+		glProgramParameteri(this->ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	}
 
 	glLinkProgram(this->ID);
-	checkCompileErrors(this->ID, ERROR_TYPE::PROGRAM);
+}
 
-	glDeleteShader(sVertex);
-	glDeleteShader(sFragment);
-	if (geometrySource != nullptr)
+bool Shader::Ready() const
+{
+	return !this->Pending() || ShaderCache::LinkCompleted(this->ID);
+}
+
+void Shader::Finish()
+{
+	if (!this->Pending())
+		return;
+
+	bool compiled = true;
+	for (int stage = 0; stage < STAGES; ++stage)
 	{
-		glDeleteShader(sGeometry);
+		if (this->m_stages[stage])
+			compiled = this->checkCompileErrors(this->m_stages[stage].ID(), (ERROR_TYPE)stage) && compiled;
 	}
+	bool linked = this->checkCompileErrors(this->ID, ERROR_TYPE::PROGRAM);
+	if (compiled && linked)
+		ShaderCache::Store(this->ID, this->m_cacheKey);
+
+	// Linked into the program, the stages aren't needed anymore
+	for (GLShader& stage : this->m_stages)
+		stage.Reset();
 }
 
 void Shader::SetFloat(const GLchar* name, GLfloat value, GLboolean useShader)
@@ -112,7 +157,7 @@ void Shader::SetMatrix4(const GLchar* name, const glm::mat4& matrix, GLboolean u
 	glUniformMatrix4fv(glGetUniformLocation(this->ID, name), 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
-void Shader::checkCompileErrors(GLuint object, ERROR_TYPE type)
+bool Shader::checkCompileErrors(GLuint object, ERROR_TYPE type)
 {
 	GLint success;
 	GLchar infoLog[1024];
@@ -137,4 +182,5 @@ void Shader::checkCompileErrors(GLuint object, ERROR_TYPE type)
 				<< infoLog << "\n------------------------------------------------\n";
 		}
 	}
+	return success == GL_TRUE;
 }
\ No newline at end of file
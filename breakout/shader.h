@@ -1,19 +1,61 @@
 #ifndef _shader_HG_
 #define _shader_HG_
 
+#include <cstdint>
 #include <string>
+#include <utility>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <globject/globject.h>
+
+// Owns its GL program. Move-only, users that don't own the program keep a
+// reference to the one held by the ResourceManager.
+//
+// Compiling is split in two so several programs can be handed to the driver
+// before waiting on any of them: Submit starts the compile and link (or loads
+// the binary from the ShaderCache) and Finish checks the result. Compile does
+// both at once.
 class Shader
 {
 public:
-	GLuint ID;
-	Shader() { }
+	GLuint ID;	// 0 until Compile or Submit
+	Shader() : ID(0), m_cacheKey(0) { }
+	Shader(Shader&& other) : ID(other.ID), m_program(std::move(other.m_program)), m_cacheKey(other.m_cacheKey)
+	{
+		for (int i = 0; i < STAGES; ++i)
+			this->m_stages[i] = std::move(other.m_stages[i]);
+		other.ID = 0;
+	}
+	Shader& operator=(Shader&& other)
+	{
+		this->ID = other.ID;
+		this->m_program = std::move(other.m_program);
+		for (int i = 0; i < STAGES; ++i)
+			this->m_stages[i] = std::move(other.m_stages[i]);
+		this->m_cacheKey = other.m_cacheKey;
+		other.ID = 0;
+		return *this;
+	}
+
 	Shader &Use();
-	void Compile(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar* geometrySource = nullptr); 
+	// Name the program is listed under in GLObjects::Report
+	void SetLabel(const std::string& label) const { this->m_program.SetLabel(label); }
+	// fragmentSource may be null for programs that only run transform feedback,
+	// feedbackVaryings names the outputs captured (interleaved) into the buffer
+	void Compile(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar* geometrySource = nullptr,
+				 const GLchar* const* feedbackVaryings = nullptr, GLsizei feedbackCount = 0); 
+	// Same arguments as Compile, the program can't be used until Finish
+	void Submit(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar* geometrySource = nullptr,
+				const GLchar* const* feedbackVaryings = nullptr, GLsizei feedbackCount = 0);
+	// Submitted but not finished yet
+	bool Pending() const { return (bool)this->m_stages[VERTEX]; }
+	// Finish won't have to wait for the driver
+	bool Ready() const;
+	// Reports compile and link errors and stores the binary of a program that linked
+	void Finish();
 
 	// Utility functions
 	void    SetFloat	(const GLchar* name, GLfloat value, GLboolean useShader = false);
@@ -34,9 +76,14 @@ private:
 		GEOMETRY,
 		PROGRAM
 	};
+	static const int STAGES = PROGRAM;
+
+	GLProgram m_program;
+	GLShader m_stages[STAGES];	// only while pending
+	uint64_t m_cacheKey;
 
 	// Checks if compilation or linking failed and if so, print the error logs
-	void checkCompileErrors(GLuint object, ERROR_TYPE type);
+	bool checkCompileErrors(GLuint object, ERROR_TYPE type);
 };
 
 #endif
\ No newline at end of file
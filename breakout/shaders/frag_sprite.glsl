@@ -1,12 +0,0 @@
-#version 420
-in vec2 TexCoords;
-out vec4 color;
-
-uniform sampler2D image;
-uniform vec3 spriteColor;
-
-void main()
-{
-	color = vec4(spriteColor, 1.0) * texture(image, TexCoords);
-	//color = texture(image, TexCoords);
-}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 420
+in vec2 TexCoords;
+in vec4 SpriteColor;
+out vec4 color;
+
+uniform sampler2D image;
+
+void main()
+{
+	color = SpriteColor * texture(image, TexCoords);
+}
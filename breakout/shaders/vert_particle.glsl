@@ -1,17 +1,20 @@
 #version 420
 layout (location = 0) in vec4 vertex; // vec2 position, vec2 texCoords
+layout (location = 1) in vec2 offset; // per instance
+layout (location = 2) in vec4 color;  // per instance
+layout (location = 3) in float size;  // per instance
 
 out vec2 TexCoords;
 out vec4 ParticleColor;
 
 uniform mat4 projection;
-uniform vec2 offset;
-uniform vec4 color;
 
 void main()
 {
-	float scale = 10.0f;
 	TexCoords = vertex.zw;
 	ParticleColor = color;
-	gl_Position = projection * vec4((vertex.xy * scale) + offset, 0.0, 1.0);
+	gl_Position = projection * vec4((vertex.xy * size) + offset, 0.0, 1.0);
+	// Faded out or dead, put it outside the clip volume so it is culled
+	if (color.a <= 0.0)
+		gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
 }
\ No newline at end of file
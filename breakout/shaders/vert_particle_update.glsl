@@ -0,0 +1,67 @@
+#version 420
+// Advances one particle per vertex, the results are captured with transform feedback
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 velocity;
+layout (location = 2) in vec4 color;
+layout (location = 3) in float life;
+
+out vec2 outPosition;
+out vec2 outVelocity;
+out vec4 outColor;
+out float outLife;
+
+uniform float deltaTime;
+uniform int amount;
+uniform int spawnStart;	// slots [spawnStart, spawnStart + spawnCount) wrap around and respawn
+uniform int spawnCount;
+uniform int seed;
+uniform vec2 emitterPosition;
+uniform vec2 emitterVelocity;
+
+uint hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// Uniform in [0, 1)
+float random(inout uint state)
+{
+	state = hash(state);
+	return float(state >> 8) / 16777216.0;
+}
+
+void main()
+{
+	int slot = (gl_VertexID - spawnStart + amount) % amount;
+	if (slot < spawnCount)
+	{
+		// Same distribution as ParticleGenerator::respawnParticle on the CPU
+		uint state = hash(uint(gl_VertexID) ^ hash(uint(seed)));
+		float offset = floor(random(state) * 100.0 - 50.0) / 10.0;
+		float shade = 0.5 + floor(random(state) * 100.0) / 100.0;
+		outPosition = emitterPosition + offset;
+		outVelocity = emitterVelocity * 0.1;
+		outColor = vec4(shade, shade, shade, 1.0);
+		outLife = 1.0;
+		return;
+	}
+
+	outLife = life - deltaTime;
+	outVelocity = velocity;
+	if (outLife > 0.0)
+	{
+		outPosition = position - velocity * deltaTime;
+		outColor = vec4(color.rgb, color.a - deltaTime * 2.5);
+	}
+	else
+	{
+		// Dead particles get zero alpha so the draw can skip them
+		outPosition = position;
+		outColor = vec4(0.0);
+	}
+}
@@ -0,0 +1,200 @@
+#include "snapshot.h"
+#include "game.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+	// A run of equal bytes shorter than this inside changed data is carried
+	// along as zeros, a new pair of lengths would cost as much
+	const size_t MIN_EQUAL_RUN = 4;
+
+	typedef std::chrono::steady_clock Clock;
+
+	double microseconds(Clock::time_point start, Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::micro>(end - start).count();
+	}
+
+	void writeVarint(std::vector<unsigned char>& out, size_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+
+	bool readVarint(const std::vector<unsigned char>& in, size_t& cursor, size_t& value)
+	{
+		value = 0;
+		for (unsigned int shift = 0; cursor < in.size() && shift < 64; shift += 7)
+		{
+			unsigned char byte = in[cursor++];
+			value |= (size_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+}
+
+void SnapshotDelta::Encode(const Snapshot& base, const Snapshot& target, std::vector<unsigned char>& delta)
+{
+	delta.clear();
+	writeVarint(delta, target.size());
+
+	size_t size = target.size();
+	auto baseAt = [&](size_t i) { return i < base.size() ? base[i] : (unsigned char)0; };
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t equalStart = i;
+		while (i < size && target[i] == baseAt(i))
+			++i;
+		if (i == size)
+			break;
+
+		// Extend the changed run over short equal gaps
+		size_t changedStart = i;
+		size_t changedEnd = i;
+		while (i < size)
+		{
+			if (target[i] != baseAt(i))
+			{
+				changedEnd = ++i;
+				continue;
+			}
+			size_t gap = i;
+			while (gap < size && gap - i < MIN_EQUAL_RUN && target[gap] == baseAt(gap))
+				++gap;
+			if (gap - i >= MIN_EQUAL_RUN || gap == size)
+				break;
+			i = gap;
+		}
+		i = changedEnd;
+
+		writeVarint(delta, changedStart - equalStart);
+		writeVarint(delta, changedEnd - changedStart);
+		for (size_t j = changedStart; j < changedEnd; ++j)
+			delta.push_back(target[j] ^ baseAt(j));
+	}
+}
+
+bool SnapshotDelta::Decode(const Snapshot& base, const std::vector<unsigned char>& delta, Snapshot& target)
+{
+	size_t cursor = 0;
+	size_t size = 0;
+	if (!readVarint(delta, cursor, size))
+		return false;
+
+	target.resize(size);
+	size_t common = std::min(size, base.size());
+	std::copy(base.begin(), base.begin() + common, target.begin());
+	std::fill(target.begin() + common, target.end(), (unsigned char)0);
+
+	size_t position = 0;
+	while (cursor < delta.size())
+	{
+		size_t equal = 0;
+		size_t changed = 0;
+		if (!readVarint(delta, cursor, equal) || !readVarint(delta, cursor, changed))
+			return false;
+		position += equal;
+		if (position + changed > size || cursor + changed > delta.size())
+			return false;
+		for (size_t j = 0; j < changed; ++j)
+			target[position + j] ^= delta[cursor + j];
+		position += changed;
+		cursor += changed;
+	}
+	return true;
+}
+
+SnapshotBenchmark::SnapshotBenchmark(Game& game)
+	: m_game(game)
+	, m_samples(0)
+	, m_deltas(0)
+	, m_failures(0)
+	, m_fullBytes(0)
+	, m_deltaBytes(0)
+	, m_deltaMax(0)
+	, m_saveUs(0.0)
+	, m_encodeUs(0.0)
+	, m_decodeUs(0.0)
+	, m_loadUs(0.0)
+{
+	// Worst case for the delta is every byte changed plus a few bytes of lengths
+	size_t capacity = game.StateCapacity();
+	m_previous.reserve(capacity);
+	m_current.reserve(capacity);
+	m_decoded.reserve(capacity);
+	m_delta.reserve(capacity + capacity / 64 + 32);
+}
+
+void SnapshotBenchmark::Sample()
+{
+	uint64_t hash = m_game.HashState();
+
+	Clock::time_point start = Clock::now();
+	m_game.SaveState(m_current);
+	Clock::time_point saved = Clock::now();
+	m_saveUs += microseconds(start, saved);
+	m_fullBytes += m_current.size();
+	++m_samples;
+
+	if (m_samples > 1)
+	{
+		Clock::time_point encodeStart = Clock::now();
+		SnapshotDelta::Encode(m_previous, m_current, m_delta);
+		Clock::time_point encoded = Clock::now();
+		bool decoded = SnapshotDelta::Decode(m_previous, m_delta, m_decoded);
+		Clock::time_point decodeEnd = Clock::now();
+		m_encodeUs += microseconds(encodeStart, encoded);
+		m_decodeUs += microseconds(encoded, decodeEnd);
+		m_deltaBytes += m_delta.size();
+		m_deltaMax = std::max(m_deltaMax, m_delta.size());
+		++m_deltas;
+
+		if (!decoded || m_decoded != m_current)
+		{
+			++m_failures;
+			m_decoded = m_current;
+		}
+	}
+	else
+	{
+		m_decoded = m_current;
+	}
+
+	// Loading what was just saved changes nothing, unless the snapshot missed something
+	Clock::time_point loadStart = Clock::now();
+	bool loaded = m_game.LoadState(m_decoded);
+	m_loadUs += microseconds(loadStart, Clock::now());
+	if (!loaded || m_game.HashState() != hash)
+		++m_failures;
+
+	m_previous.swap(m_current);
+}
+
+void SnapshotBenchmark::Report() const
+{
+	if (m_samples == 0)
+		return;
+	char line[256];
+	snprintf(line, sizeof(line), "SNAPSHOT: %u snapshots, %.0f bytes full, save %.2f us, load %.2f us\n",
+		m_samples, (double)m_fullBytes / m_samples, m_saveUs / m_samples, m_loadUs / m_samples);
+	std::cout << line;
+	if (m_deltas > 0)
+	{
+		snprintf(line, sizeof(line), "SNAPSHOT: delta %.0f bytes average, %zu max, encode %.2f us, decode %.2f us\n",
+			(double)m_deltaBytes / m_deltas, m_deltaMax, m_encodeUs / m_deltas, m_decodeUs / m_deltas);
+		std::cout << line;
+	}
+	if (m_failures > 0)
+		std::cout << "ERROR::SNAPSHOT: " << m_failures << " snapshots didn't restore the state they saved\n";
+}
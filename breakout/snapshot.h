@@ -0,0 +1,112 @@
+#ifndef _snapshot_HG_
+#define _snapshot_HG_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+class Game;
+
+// Game state saved as raw bytes. Components and scalars are copied as they
+// sit in memory, so a snapshot only means something to the build (and the
+// Game) that took it: it's for rollback and quick-save, not for files.
+typedef std::vector<unsigned char> Snapshot;
+
+// Appends to a snapshot. Nothing allocates while the snapshot's capacity lasts.
+class SnapshotWriter
+{
+public:
+	explicit SnapshotWriter(Snapshot& out) : m_out(out) { m_out.clear(); }
+
+	void Write(const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		m_out.insert(m_out.end(), bytes, bytes + size);
+	}
+	template <typename T>
+	void Write(const T& value) { this->Write(&value, sizeof(T)); }
+
+private:
+	Snapshot& m_out;
+};
+
+// Reads a snapshot back in the order it was written. A read past the end
+// fails and leaves the destination alone.
+class SnapshotReader
+{
+public:
+	explicit SnapshotReader(const Snapshot& in) : m_data(in.data()), m_size(in.size()), m_cursor(0) {}
+
+	bool Has(size_t size) const { return m_size - m_cursor >= size; }
+	bool Read(void* data, size_t size)
+	{
+		if (!this->Has(size))
+			return false;
+		if (size > 0)
+			memcpy(data, m_data + m_cursor, size);
+		m_cursor += size;
+		return true;
+	}
+	template <typename T>
+	bool Read(T& value) { return this->Read(&value, sizeof(T)); }
+	bool Done() const { return m_cursor == m_size; }
+
+private:
+	const unsigned char*	m_data;
+	size_t					m_size;
+	size_t					m_cursor;
+};
+
+// Encodes a snapshot as the bytes that changed since a base snapshot, usually
+// the previous tick's. From one tick to the next most of the state is equal,
+// so the XOR is mostly zero and only the runs that aren't are stored:
+//
+//	varint size of the target
+//	repeated: varint bytes equal to the base, varint bytes that differ, those bytes XOR the base
+//
+// Bytes past the end of the base count as zero.
+class SnapshotDelta
+{
+public:
+	static void Encode(const Snapshot& base, const Snapshot& target, std::vector<unsigned char>& delta);
+	// False if the delta is damaged
+	static bool Decode(const Snapshot& base, const std::vector<unsigned char>& delta, Snapshot& target);
+
+private:
+	SnapshotDelta() {}
+};
+
+// --snapshot-bench: each tick the game is saved, delta encoded against the
+// previous tick, decoded and loaded back, checking the state survived the
+// trip, and the size and time of every step is totalled for Report
+class SnapshotBenchmark
+{
+public:
+	explicit SnapshotBenchmark(Game& game);
+
+	// Call once the tick's simulation is done
+	void Sample();
+	void Report() const;
+
+private:
+	Game&						m_game;
+	Snapshot					m_previous;
+	Snapshot					m_current;
+	Snapshot					m_decoded;
+	std::vector<unsigned char>	m_delta;
+
+	GLuint						m_samples;
+	GLuint						m_deltas;
+	GLuint						m_failures;
+	size_t						m_fullBytes;		// totals over every sample
+	size_t						m_deltaBytes;
+	size_t						m_deltaMax;
+	double						m_saveUs;
+	double						m_encodeUs;
+	double						m_decodeUs;
+	double						m_loadUs;
+};
+
+#endif
@@ -1,21 +1,29 @@
 #include "spriterenderer.h"
+#include "renderstats.h"
 
-SpriteRenderer::SpriteRenderer(Shader& shader)
-{
-	this->shader = shader;
-	this->initRenderData();
-}
+const GLuint BATCH_FLOATS_PER_VERTEX = 8;
+const GLsizeiptr BATCH_VERTEX_BYTES = BATCH_FLOATS_PER_VERTEX * sizeof(GLfloat);
 
-SpriteRenderer::~SpriteRenderer()
+// Corners of the unit quad as two triangles
+const glm::vec2 QUAD_CORNERS[6] = {
+	glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 0.0f),
+	glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 0.0f)
+};
+
+SpriteRenderer::SpriteRenderer(Shader& shader, StreamBuffer& stream)
+	: shader(shader)
+	, stream(stream)
+	, batchTexture(0)
 {
-	glDeleteVertexArrays(1, &this->quadVAO);
+	this->initRenderData();
 }
 
-void SpriteRenderer::DrawSprite(Texture2D& texture, glm::vec2 position,
+void SpriteRenderer::DrawSprite(const Texture2D& texture, glm::vec2 position,
 	glm::vec2 size, GLfloat rotate, glm::vec3 color)
 {
+	this->setTexture(texture);
+
 	// Prepare transformations
-	this->shader.Use();
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(position, 0.0f));
 
@@ -25,41 +33,78 @@ void SpriteRenderer::DrawSprite(Texture2D& texture, glm::vec2 position,
 
 	model = glm::scale(model, glm::vec3(size, 1.0f));
 
-	this->shader.SetMatrix4("model", model);
-	this->shader.SetVector3f("spriteColor", color);
+	glm::vec4 rgba(color, 1.0f);
+	for (const glm::vec2& corner : QUAD_CORNERS)
+	{
+		glm::vec4 vertex = model * glm::vec4(corner, 0.0f, 1.0f);
+		this->pushVertex(glm::vec2(vertex), corner, rgba);
+	}
+}
 
-	//glActiveTexture(GL_TEXTURE0); //<- already doing this in texture.Bind() .. keep the texture logic in the texture class
-	texture.Bind();
+void SpriteRenderer::DrawQuads(const Texture2D& texture, const SpriteQuad* quads, GLuint count)
+{
+	if (count == 0)
+		return;
 
-	glBindVertexArray(this->quadVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glBindVertexArray(0);
+	this->setTexture(texture);
+	for (GLuint i = 0; i < count; ++i)
+	{
+		const SpriteQuad& q = quads[i];
+		for (const glm::vec2& corner : QUAD_CORNERS)
+			this->pushVertex(q.Position + corner * q.Size, corner, q.Color);
+	}
 }
 
-void SpriteRenderer::initRenderData()
+void SpriteRenderer::Flush()
 {
-	GLuint VBO;
-	GLfloat vertices[] = 
+	if (this->batchVertices.empty())
+		return;
+
+	GLsizeiptr bytes = this->batchVertices.size() * sizeof(GLfloat);
+	GLintptr offset = this->stream.Upload(this->batchVertices.data(), bytes, BATCH_VERTEX_BYTES);
+	if (offset >= 0)
 	{
-		// Pos          Tex
-		0.0f, 1.0f, 0.0f, 1.0f,
-		1.0f, 0.0f, 1.0f, 0.0f,
-		0.0f, 0.0f, 0.0f, 0.0f,
-
-		0.0f, 1.0f, 0.0f, 1.0f,
-		1.0f, 1.0f, 1.0f, 1.0f,
-		1.0f, 0.0f, 1.0f, 0.0f
-	};
+		this->shader.Use();
+		glBindTexture(GL_TEXTURE_2D, this->batchTexture);
+		glBindVertexArray(this->batchVAO.ID());
+		glDrawArrays(GL_TRIANGLES, (GLint)(offset / BATCH_VERTEX_BYTES), (GLsizei)(bytes / BATCH_VERTEX_BYTES));
+		glBindVertexArray(0);
+		RenderStats::StateChange(2);
+		RenderStats::Draw();
+	}
+	this->batchVertices.clear();
+}
+
+void SpriteRenderer::setTexture(const Texture2D& texture)
+{
+	if (texture.ID != this->batchTexture)
+	{
+		this->Flush();
+		this->batchTexture = texture.ID;
+	}
+}
 
-	glGenVertexArrays(1, &quadVAO);
-	glGenBuffers(1, &VBO);
+void SpriteRenderer::pushVertex(glm::vec2 position, glm::vec2 texCoords, const glm::vec4& color)
+{
+	GLfloat vertex[BATCH_FLOATS_PER_VERTEX] = {
+		position.x, position.y, texCoords.x, texCoords.y,
+		color.r, color.g, color.b, color.a
+	};
+	this->batchVertices.insert(this->batchVertices.end(), vertex, vertex + BATCH_FLOATS_PER_VERTEX);
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+void SpriteRenderer::initRenderData()
+{
+	// Vertices come straight out of the shared stream buffer, a draw picks
+	// its range with the first vertex
+	this->batchVAO = GLVertexArray::Create("SpriteRenderer batch");
 
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	glBindVertexArray(this->quadVAO);
+	glBindVertexArray(this->batchVAO.ID());
+	glBindBuffer(GL_ARRAY_BUFFER, this->stream.ID());
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, BATCH_VERTEX_BYTES, (GLvoid*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BATCH_VERTEX_BYTES, (GLvoid*)(4 * sizeof(GLfloat)));
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 }
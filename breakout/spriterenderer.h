@@ -5,24 +5,50 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <vector>
+
 #include "texture.h"
 #include "shader.h"
+#include "streambuffer.h"
+
+// Axis aligned quad for DrawQuads, in screen coordinates
+struct SpriteQuad {
+	glm::vec2 Position;
+	glm::vec2 Size;
+	glm::vec4 Color;
+};
 
+// Sprites are not drawn straight away. They are transformed on the CPU and
+// queued, and consecutive sprites sharing a texture go out as one draw call.
+// The queue is flushed when the texture changes or Flush is called, so call
+// Flush before drawing anything that doesn't go through this renderer.
 class SpriteRenderer
 {
 public:
-	SpriteRenderer(Shader& shader);
-	~SpriteRenderer();
+	SpriteRenderer(Shader& shader, StreamBuffer& stream);
 
-	void DrawSprite(Texture2D& texture, glm::vec2 position,
+	void DrawSprite(const Texture2D& texture, glm::vec2 position,
 					glm::vec2 size = glm::vec2(10, 10), GLfloat rotate = 0.0f,
 					glm::vec3 color = glm::vec3(1.0f));
 
+	// Queues many axis aligned quads sharing one texture
+	void DrawQuads(const Texture2D& texture, const SpriteQuad* quads, GLuint count);
+
+	// Draws everything queued so far
+	void Flush();
+
 private:
-	Shader shader;
-	GLuint quadVAO;
+	Shader& shader;
+	StreamBuffer& stream;
+
+	// Queued vertices: pos, tex and color
+	GLVertexArray batchVAO;
+	GLuint batchTexture;
+	std::vector<GLfloat> batchVertices;
 
+	void setTexture(const Texture2D& texture);
+	void pushVertex(glm::vec2 position, glm::vec2 texCoords, const glm::vec4& color);
 	void initRenderData();
 };
 
-#endif
\ No newline at end of file
+#endif
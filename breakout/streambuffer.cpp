@@ -0,0 +1,122 @@
+#include "streambuffer.h"
+#include "renderstats.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <trace/trace.h>
+
+StreamBuffer::StreamBuffer(GLsizeiptr frameBytes)
+	: m_frameBytes(frameBytes)
+	, m_size(frameBytes * SEGMENTS)
+	, m_head(0)
+	, m_end(frameBytes)
+	, m_segment(0)
+	, m_fences()
+	, m_mapped(nullptr)
+	, m_overflowReported(false)
+{
+	m_buffer = GLBuffer::Create("StreamBuffer");
+	glBindBuffer(GL_ARRAY_BUFFER, m_buffer.ID());
+	if (GLAD_GL_VERSION_4_4)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, m_size, NULL, flags);
+		m_mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, m_size, flags);
+		if (!m_mapped)
+			std::cout << "ERROR::STREAMBUFFER: Persistent mapping failed\n";
+	}
+	if (!m_mapped)
+	{
+		// Without fences the whole buffer is one ring that gets orphaned when it wraps
+		glBufferData(GL_ARRAY_BUFFER, m_size, NULL, GL_STREAM_DRAW);
+		m_end = m_size;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_buffer.SetBytes(m_size);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for (GLuint i = 0; i < SEGMENTS; ++i)
+	{
+		if (m_fences[i])
+			glDeleteSync(m_fences[i]);
+	}
+	if (m_mapped)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer.ID());
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+void StreamBuffer::BeginFrame()
+{
+	if (!m_mapped)
+		return;
+
+	GLsync fence = m_fences[m_segment];
+	if (fence)
+	{
+		TRACE_ZONE("StreamBuffer::Wait");
+		// Only blocks when the GPU is more than SEGMENTS - 1 frames behind
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		glDeleteSync(fence);
+		m_fences[m_segment] = 0;
+	}
+	m_head = m_segment * m_frameBytes;
+	m_end = m_head + m_frameBytes;
+}
+
+void StreamBuffer::EndFrame()
+{
+	if (!m_mapped)
+		return;
+
+	m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_segment = (m_segment + 1) % SEGMENTS;
+}
+
+GLintptr StreamBuffer::Upload(const void* data, GLsizeiptr bytes, GLsizeiptr alignment)
+{
+	GLintptr offset = (m_head + alignment - 1) / alignment * alignment;
+	if (offset + bytes > m_end)
+	{
+		if (m_mapped || bytes > m_size)
+		{
+			if (!m_overflowReported)
+				std::cout << "ERROR::STREAMBUFFER: Out of space, a frame uploaded more than " << m_frameBytes << " bytes\n";
+			m_overflowReported = true;
+			return -1;
+		}
+		// Give the old storage to the driver and start over in a fresh one
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer.ID());
+		glBufferData(GL_ARRAY_BUFFER, m_size, NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		offset = 0;
+	}
+
+	if (m_mapped)
+	{
+		memcpy(m_mapped + offset, data, bytes);
+	}
+	else
+	{
+		// Nothing before m_head is written again until the buffer is orphaned,
+		// so the range can be mapped without waiting on the GPU
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer.ID());
+		void* target = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (target)
+		{
+			memcpy(target, data, bytes);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	m_head = offset + bytes;
+	return offset;
+}
@@ -0,0 +1,52 @@
+#ifndef _streambuffer_HG_
+#define _streambuffer_HG_
+
+#include <glad/glad.h>
+
+#include <globject/globject.h>
+
+// One vertex buffer shared by everything that uploads vertex or instance data
+// every frame. The buffer is split into SEGMENTS parts, one per frame in flight.
+// With GL 4.4 it is mapped once with GL_MAP_PERSISTENT_BIT and an upload is a
+// memcpy into the current frame's part; a fence per part stops the CPU from
+// writing over data the GPU hasn't read yet. Older contexts fall back to
+// unsynchronized mapping and orphan the whole buffer when it fills up.
+class StreamBuffer
+{
+public:
+	static const GLuint SEGMENTS = 3;
+
+	// frameBytes is how much data a single frame may upload
+	explicit StreamBuffer(GLsizeiptr frameBytes);
+	~StreamBuffer();
+
+	// Waits until the GPU is done with the part this frame writes into
+	void BeginFrame();
+	// Fences everything drawn from this frame's part, call after its last draw
+	void EndFrame();
+
+	// Copies data into the buffer and returns the byte offset it landed at,
+	// rounded up to a multiple of alignment (use the vertex stride so the
+	// offset can be turned into a first vertex). Returns -1 when the frame
+	// has run out of space.
+	GLintptr Upload(const void* data, GLsizeiptr bytes, GLsizeiptr alignment);
+
+	GLuint ID() const { return m_buffer.ID(); }
+	bool Persistent() const { return m_mapped != nullptr; }
+
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+private:
+	GLBuffer	m_buffer;
+	GLsizeiptr	m_frameBytes;
+	GLsizeiptr	m_size;
+	GLintptr	m_head;		// next free byte
+	GLintptr	m_end;		// end of the range the current frame may write to
+	GLuint		m_segment;
+	GLsync		m_fences[SEGMENTS];
+	char*		m_mapped;	// persistent mapping, null when orphaning
+	bool		m_overflowReported;
+};
+
+#endif
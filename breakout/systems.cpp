@@ -0,0 +1,49 @@
+#include "systems.h"
+
+#include "resourcemanager.h"
+
+#include <trace/trace.h>
+
+void MovementSystem(Registry& registry, GLfloat deltaTime, GLuint width)
+{
+	TRACE_ZONE("MovementSystem");
+
+	ComponentPool<Ball>& balls = registry.Pool<Ball>();
+	registry.Each<Velocity, Transform>([&](Entity entity, Velocity& velocity, Transform& transform)
+	{
+		Ball* ball = balls.Get(entity);
+		if (ball && ball->Stuck)
+			return;
+
+		transform.Position += velocity.Value * deltaTime;
+		if (!ball)
+			return;
+
+		// Check if outside the window, reverse the velocity
+		if (transform.Position.x <= 0.0f)
+		{
+			velocity.Value.x = -velocity.Value.x;
+			transform.Position.x = 0.0f;
+		}
+		else if (transform.Position.x + transform.Size.x >= width)
+		{
+			velocity.Value.x = -velocity.Value.x;
+			transform.Position.x = width - transform.Size.x;
+		}
+
+		if (transform.Position.y <= 0.0f)
+		{
+			velocity.Value.y = -velocity.Value.y;
+			transform.Position.y = 0.0f;
+		}
+	});
+}
+
+void RenderSystem(Registry& registry, SpriteRenderer& renderer, RenderLayer layer)
+{
+	registry.Each<Sprite, Transform>([&](Entity, Sprite& sprite, Transform& transform)
+	{
+		if (sprite.Layer == layer)
+			renderer.DrawSprite(ResourceManager::GetTexture(sprite.Texture), transform.Position, transform.Size, sprite.Rotation, sprite.Color);
+	});
+}
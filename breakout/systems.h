@@ -0,0 +1,18 @@
+#ifndef _systems_HG_
+#define _systems_HG_
+
+#include "ecs.h"
+#include "components.h"
+#include "spriterenderer.h"
+
+// Systems that only need the registry. The ones with gameplay side effects
+// (collisions, power-up timers) are part of Game.
+
+// Integrates every entity with a Velocity. Balls stuck to the paddle stay put,
+// free balls bounce off the left, right and top walls.
+void MovementSystem(Registry& registry, GLfloat deltaTime, GLuint width);
+
+// Queues the sprites of one layer on the renderer
+void RenderSystem(Registry& registry, SpriteRenderer& renderer, RenderLayer layer);
+
+#endif
@@ -1,4 +1,6 @@
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -6,21 +8,26 @@
 #include FT_FREETYPE_H
 
 #include "textrenderer.h"
+#include "assets.h"
 #include "resourcemanager.h"
+#include "renderstats.h"
+#include "framearena.h"
 
+#include <memtrack/memtrack.h>
 
-TextRenderer::TextRenderer(GLuint width, GLuint height)
+
+TextRenderer::TextRenderer(Shader& shader, GLuint width, GLuint height, StreamBuffer& stream)
+	: TextShader(shader)
+	, m_stream(stream)
+	, m_lineHeight(0)
 {
-	// Load and configure shader
-	this->TextShader = ResourceManager::LoadShader("shaders/vert_text.glsl", "shaders/frag_text.glsl", nullptr, "text");
+	// Configure shader
 	this->TextShader.SetMatrix4("projection", glm::ortho(0.0f, static_cast<GLfloat>(width), static_cast<GLfloat>(height), 0.0f), GL_TRUE);
 	this->TextShader.SetInteger("text", 0);
-	// Configure VAO/VBO for texture quads
-	glGenVertexArrays(1, &this->VAO);
-	glGenBuffers(1, &this->VBO);
-	glBindVertexArray(this->VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+	// Configure VAO for texture quads read from the stream buffer
+	this->VAO = GLVertexArray::Create("TextRenderer");
+	glBindVertexArray(this->VAO.ID());
+	glBindBuffer(GL_ARRAY_BUFFER, this->m_stream.ID());
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -29,22 +36,30 @@ TextRenderer::TextRenderer(GLuint width, GLuint height)
 
 void TextRenderer::Load(std::string font, GLuint fontSize)
 {
+	MEMTRACK_SCOPE(MEM_TEXT);
+
 	// First clear the previously loaded Characters
 	this->Characters.clear();
 	// Then initialize and load the FreeType library
 	FT_Library ft;
 	if (FT_Init_FreeType(&ft)) // All functions return a value different than 0 whenever an error occurred
 		std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-	// Load font as face
+	// Load font as face, read in place from the view which outlives the face
 	FT_Face face;
-	if (FT_New_Face(ft, font.c_str(), 0, &face))
+	VfsFile source = Assets::Open(font.c_str());
+	if (!source || FT_New_Memory_Face(ft, source.Data(), (FT_Long)source.Size(), 0, &face))
 		std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
 	// Set size to load glyphs as
 	FT_Set_Pixel_Sizes(face, 0, fontSize);
-	// Disable byte-alignment restriction
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	// Then for the first 128 ASCII characters, pre-load/compile their characters and store them
-	for (GLubyte c = 0; c < 128; c++) // lol see what I did there 
+	this->m_lineHeight = (GLuint)(face->size->metrics.height >> 6);
+
+	// Then for the first 128 ASCII characters, render their glyphs and keep a copy of the bitmaps
+	// so they can be packed into one atlas once the biggest glyph is known
+	const GLuint GLYPH_COUNT = 128;
+	std::vector<std::vector<unsigned char>> bitmaps(GLYPH_COUNT);
+	GLuint cellWidth = 0;
+	GLuint cellHeight = 0;
+	for (GLubyte c = 0; c < GLYPH_COUNT; c++) // lol see what I did there 
 	{
 		// Load character glyph 
 		if (FT_Load_Char(face, c, FT_LOAD_RENDER))
@@ -52,84 +67,116 @@ void TextRenderer::Load(std::string font, GLuint fontSize)
 			std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
 			continue;
 		}
-		// Generate texture
-		GLuint texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_RED,
-			face->glyph->bitmap.width,
-			face->glyph->bitmap.rows,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			face->glyph->bitmap.buffer
-		);
-		// Set texture options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// Now store character for later use
+		const FT_Bitmap& bitmap = face->glyph->bitmap;
+		bitmaps[c].resize(bitmap.width * bitmap.rows);
+		for (unsigned int row = 0; row < bitmap.rows; ++row)
+			std::copy(bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + bitmap.width, bitmaps[c].begin() + row * bitmap.width);
+
+		cellWidth = std::max(cellWidth, (GLuint)bitmap.width);
+		cellHeight = std::max(cellHeight, (GLuint)bitmap.rows);
+
+		// Now store character for later use, the atlas coordinates are filled in below
 		Character character = {
-			texture,
-			glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
+			glm::vec2(0.0f),
+			glm::vec2(0.0f),
+			glm::ivec2(bitmap.width, bitmap.rows),
 			glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-			face->glyph->advance.x
+			(GLuint)face->glyph->advance.x
 		};
 		Characters.insert(std::pair<GLchar, Character>(c, character));
 	}
-	glBindTexture(GL_TEXTURE_2D, 0);
 	// Destroy FreeType once we're finished
 	FT_Done_Face(face);
 	FT_Done_FreeType(ft);
+
+	// Pack the glyphs into a 16x8 grid, one pixel of padding keeps linear filtering from bleeding
+	const GLuint COLUMNS = 16;
+	cellWidth += 2;
+	cellHeight += 2;
+	GLuint atlasWidth = COLUMNS * cellWidth;
+	GLuint atlasHeight = (GLYPH_COUNT / COLUMNS) * cellHeight;
+	std::vector<unsigned char> pixels(atlasWidth * atlasHeight, 0);
+	for (auto& entry : this->Characters)
+	{
+		GLuint index = (GLuint)(GLubyte)entry.first;
+		Character& ch = entry.second;
+		GLuint left = (index % COLUMNS) * cellWidth + 1;
+		GLuint top = (index / COLUMNS) * cellHeight + 1;
+		for (int row = 0; row < ch.Size.y; ++row)
+			std::copy(bitmaps[index].begin() + row * ch.Size.x, bitmaps[index].begin() + (row + 1) * ch.Size.x, pixels.begin() + (top + row) * atlasWidth + left);
+
+		ch.UVMin = glm::vec2(left / (GLfloat)atlasWidth, top / (GLfloat)atlasHeight);
+		ch.UVMax = glm::vec2((left + ch.Size.x) / (GLfloat)atlasWidth, (top + ch.Size.y) / (GLfloat)atlasHeight);
+	}
+
+	// Disable byte-alignment restriction
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	this->Atlas.InternalFormat = GL_RED;
+	this->Atlas.ImageFormat = GL_RED;
+	this->Atlas.WrapS = GL_CLAMP_TO_EDGE;
+	this->Atlas.WrapT = GL_CLAMP_TO_EDGE;
+	this->Atlas.Generate(atlasWidth, atlasHeight, pixels.data());
+	this->Atlas.SetLabel("TextRenderer atlas");
 }
 
-void TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+void TextRenderer::RenderText(const GLchar* text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
 {
-	// Activate corresponding render state	
-	this->TextShader.Use();
-	this->TextShader.SetVector3f("textColor", color);
-	glActiveTexture(GL_TEXTURE0);
-	glBindVertexArray(this->VAO);
-
-	// Iterate through all characters
-	std::string::const_iterator c;
-	for (c = text.begin(); c != text.end(); c++)
+	// Build the quads for the whole string first, they're only needed until
+	// they've been copied into the stream buffer
+	std::pmr::vector<GLfloat> quads(FrameArena::Resource());
+	quads.reserve(strlen(text) * 24);
+	GLfloat startX = x;
+	GLint bearingH = this->Characters['H'].Bearing.y;
+	for (const GLchar* c = text; *c; c++)
 	{
-		Character ch = Characters[*c];
+		if (*c == '\n')
+		{
+			x = startX;
+			y += this->m_lineHeight * scale;
+			continue;
+		}
+
+		const Character& ch = Characters[*c];
 
 		GLfloat xpos = x + ch.Bearing.x * scale;
-		GLfloat ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+		GLfloat ypos = y + (bearingH - ch.Bearing.y) * scale;
 
 		GLfloat w = ch.Size.x * scale;
 		GLfloat h = ch.Size.y * scale;
-		// Update VBO for each character
 		GLfloat vertices[6][4] = {
-			{ xpos,     ypos + h,   0.0, 1.0 },
-			{ xpos + w, ypos,       1.0, 0.0 },
-			{ xpos,     ypos,       0.0, 0.0 },
+			{ xpos,     ypos + h,   ch.UVMin.x, ch.UVMax.y },
+			{ xpos + w, ypos,       ch.UVMax.x, ch.UVMin.y },
+			{ xpos,     ypos,       ch.UVMin.x, ch.UVMin.y },
 
-			{ xpos,     ypos + h,   0.0, 1.0 },
-			{ xpos + w, ypos + h,   1.0, 1.0 },
-			{ xpos + w, ypos,       1.0, 0.0 }
+			{ xpos,     ypos + h,   ch.UVMin.x, ch.UVMax.y },
+			{ xpos + w, ypos + h,   ch.UVMax.x, ch.UVMax.y },
+			{ xpos + w, ypos,       ch.UVMax.x, ch.UVMin.y }
 		};
-		// Render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-		// Update content of VBO memory
-		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // Be sure to use glBufferSubData and not glBufferData
-
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		// Render quad
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		quads.insert(quads.end(), &vertices[0][0], &vertices[0][0] + 24);
 		// Now advance cursors for next glyph
 		x += (ch.Advance >> 6) * scale; // Bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
 	}
+	if (quads.empty())
+		return;
+
+	// Copy every glyph quad into the stream buffer, then render them all at once
+	const GLsizeiptr VERTEX_BYTES = 4 * sizeof(GLfloat);
+	GLsizeiptr bytes = quads.size() * sizeof(GLfloat);
+	GLintptr offset = this->m_stream.Upload(quads.data(), bytes, VERTEX_BYTES);
+	if (offset < 0)
+		return;
+
+	// Activate corresponding render state	
+	this->TextShader.Use();
+	this->TextShader.SetVector3f("textColor", color);
+	glActiveTexture(GL_TEXTURE0);
+	this->Atlas.Bind();
+	glBindVertexArray(this->VAO.ID());
+
+	glDrawArrays(GL_TRIANGLES, (GLint)(offset / VERTEX_BYTES), (GLsizei)(bytes / VERTEX_BYTES));
 	glBindVertexArray(0);
 	glBindTexture(GL_TEXTURE_2D, 0);
+	RenderStats::StateChange();
+	RenderStats::Draw();
 }
 
@@ -2,16 +2,19 @@
 #define _textrenderer_HG_
 
 #include <map>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "texture.h"
 #include "shader.h"
+#include "streambuffer.h"
 
 // Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-	GLuint TextureID;   // ID handle of the glyph texture
+	glm::vec2 UVMin;    // Top left of the glyph in the atlas
+	glm::vec2 UVMax;    // Bottom right of the glyph in the atlas
 	glm::ivec2 Size;    // Size of glyph
 	glm::ivec2 Bearing; // Offset from baseline to left/top of glyph
 	GLuint Advance;     // Horizontal offset to advance to next glyph
@@ -20,23 +23,28 @@ struct Character {
 
 // A renderer class for rendering text displayed by a font loaded using the 
 // FreeType library. A single font is loaded, processed into a list of Character
-// items for later rendering.
+// items for later rendering. All glyphs live in one atlas texture so a whole
+// string (including '\n' line breaks) is drawn with a single draw call.
 class TextRenderer
 {
 public:
 	// Holds a list of pre-compiled Characters
 	std::map<GLchar, Character> Characters;
-	// Shader used for text rendering
-	Shader TextShader;
-	// Constructor
-	TextRenderer(GLuint width, GLuint height);
+	// Glyph atlas for the loaded font
+	Texture2D Atlas;
+	// Shader used for text rendering, owned by the ResourceManager
+	Shader& TextShader;
+	// Constructor, glyph quads are uploaded through the shared stream buffer
+	TextRenderer(Shader& shader, GLuint width, GLuint height, StreamBuffer& stream);
 	// Pre-compiles a list of characters from the given font
 	void Load(std::string font, GLuint fontSize);
 	// Renders a string of text using the precompiled list of characters
-	void RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(1.0f));
+	void RenderText(const GLchar* text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(1.0f));
 private:
 	// Render state
-	GLuint VAO, VBO;
+	GLVertexArray VAO;
+	StreamBuffer& m_stream;
+	GLuint m_lineHeight;
 };
 
 
@@ -1,9 +1,14 @@
 #include "texture.h"
+#include "renderstats.h"
 
 #include <iostream>
+#include <utility>
+
+#include <texupload/texupload.h>
 
 Texture2D::Texture2D() 
-	: Width(0)
+	: ID(0)
+	, Width(0)
 	, Height(0)
 	, InternalFormat(GL_RGB)
 	, ImageFormat(GL_RGB)
@@ -12,28 +17,122 @@ Texture2D::Texture2D()
 	, FilterMin(GL_LINEAR)
 	, FilterMax(GL_LINEAR)
 {
-	glGenTextures(1, &this->ID);
+}
+
+Texture2D::~Texture2D()
+{
+	// Nothing may be uploaded into the name once it has been deleted and reused
+	if (this->ID)
+		TextureUploads::Cancel(this->ID);
+}
+
+Texture2D::Texture2D(Texture2D&& other)
+	: ID(other.ID)
+	, Width(other.Width)
+	, Height(other.Height)
+	, InternalFormat(other.InternalFormat)
+	, ImageFormat(other.ImageFormat)
+	, WrapS(other.WrapS)
+	, WrapT(other.WrapT)
+	, FilterMin(other.FilterMin)
+	, FilterMax(other.FilterMax)
+	, m_texture(std::move(other.m_texture))
+{
+	other.ID = 0;
+}
+
+Texture2D& Texture2D::operator=(Texture2D&& other)
+{
+	if (this != &other)
+	{
+		if (this->ID)
+			TextureUploads::Cancel(this->ID);
+		this->ID = other.ID;
+		this->Width = other.Width;
+		this->Height = other.Height;
+		this->InternalFormat = other.InternalFormat;
+		this->ImageFormat = other.ImageFormat;
+		this->WrapS = other.WrapS;
+		this->WrapT = other.WrapT;
+		this->FilterMin = other.FilterMin;
+		this->FilterMax = other.FilterMax;
+		this->m_texture = std::move(other.m_texture);
+		other.ID = 0;
+	}
+	return *this;
 }
 
 void Texture2D::Generate(GLuint width, GLuint height, unsigned char* data)
 {
+	this->create();
+	TextureUploads::Cancel(this->ID);
+	// Replaces the previous size if the storage is being re-specified
+	this->m_texture.SetBytes(GLObjects::TextureBytes(this->InternalFormat, width, height));
+
 	this->Width = width;
 	this->Height = height;
 	// Create texture
 	glBindTexture(GL_TEXTURE_2D, this->ID);
-	glTexImage2D(GL_TEXTURE_2D, 0, this->InternalFormat, width, height, 0, this->ImageFormat, GL_UNSIGNED_BYTE, data);
+	glTexImage2D(GL_TEXTURE_2D, 0, this->InternalFormat, width, height, 0, this->ImageFormat, GL_UNSIGNED_BYTE, NULL);
 	//glGenerateMipmap(GL_TEXTURE_2D);
 	//glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	this->setParameters();
+	// Unbind texture
+	glBindTexture(GL_TEXTURE_2D, 0);
+	// The pixels follow through the upload queue
+	if (data)
+		TextureUploads::Queue(this->ID, 0, width, height, this->ImageFormat, data, TextureUploads::ImageBytes(width, height, this->ImageFormat));
+}
+
+void Texture2D::Generate(const DdsImage& image)
+{
+	this->create();
+	TextureUploads::Cancel(this->ID);
+	GLuint levels = (GLuint)image.Levels.size();
+	this->InternalFormat = image.InternalFormat;
+	this->ImageFormat = GL_RGBA;
+	this->Width = image.Levels[0].Width;
+	this->Height = image.Levels[0].Height;
+	if (levels > 1 && this->FilterMin == GL_LINEAR)
+		this->FilterMin = GL_LINEAR_MIPMAP_LINEAR;
+	this->m_texture.SetBytes(GLObjects::TextureBytes(this->InternalFormat, this->Width, this->Height, 1, levels));
+
+	glBindTexture(GL_TEXTURE_2D, this->ID);
+	Dds::Upload(image);
+	this->setParameters();
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture2D::create()
+{
+	if (!this->m_texture)
+	{
+		this->m_texture = GLTexture::Create("Texture2D");
+		this->ID = this->m_texture.ID();
+	}
+}
+
+void Texture2D::setParameters() const
+{
 	// Set Texture wrap and filter mnodes
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->WrapS);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->WrapT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->FilterMin);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->FilterMax);
-	// Unbind texture
-	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Texture2D::Bind() const
 {
+	RenderStats::StateChange();
 	glBindTexture(GL_TEXTURE_2D, this->ID);
+}
+
+void Texture2D::SetLabel(const std::string& label) const
+{
+	this->m_texture.SetLabel(label);
+}
+
+void Texture2D::SetCategory(VramCategory category) const
+{
+	this->m_texture.SetCategory(category);
 }
\ No newline at end of file
@@ -3,10 +3,17 @@
 
 #include <glad/glad.h>
 
+#include <dds/dds.h>
+#include <globject/globject.h>
+
+#include <string>
+
+// Owns its GL texture, which is only created by Generate. Move-only, so
+// anything that doesn't own the texture keeps a reference or a TextureHandle.
 class Texture2D
 {
 public:
-	// id of texture object
+	// id of texture object, 0 until Generate
 	GLuint ID;
 	// dimensions in pixels
 	GLuint Width;
@@ -22,8 +29,28 @@ public:
 	GLuint FilterMax;
 
 	Texture2D();
+	~Texture2D();
+	Texture2D(Texture2D&& other);
+	Texture2D& operator=(Texture2D&& other);
+
+	// Creates the texture on first use, later calls re-specify its storage.
+	// The pixels are copied into TextureUploads and arrive over the next
+	// frames (or at its next Flush), null data leaves the storage undefined.
 	void Generate(GLuint width, GLuint height, unsigned char* data);
+	// Same for a cooked image, every stored level is uploaded as is and a
+	// chain with more than one level is sampled with mipmaps
+	void Generate(const DdsImage& image);
 	void Bind() const;
+
+	// Name and use the storage is accounted under, see GLObjects
+	void SetLabel(const std::string& label) const;
+	void SetCategory(VramCategory category) const;
+
+private:
+	GLTexture m_texture;
+
+	void create();
+	void setParameters() const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "dds.h"
+
+#include <texupload/texupload.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Offsets into the file, the 124 byte DDS_HEADER follows the 4 byte magic
+	const size_t DDS_HEADER_SIZE = 124;
+	const size_t DDS_DATA_OFFSET = 4 + DDS_HEADER_SIZE;
+	const size_t OFFSET_HEADER_SIZE = 4;
+	const size_t OFFSET_HEIGHT = 12;
+	const size_t OFFSET_WIDTH = 16;
+	const size_t OFFSET_MIP_COUNT = 28;
+	const size_t OFFSET_PIXEL_FLAGS = 80;
+	const size_t OFFSET_FOURCC = 84;
+	const size_t OFFSET_RGB_BIT_COUNT = 88;
+	const size_t OFFSET_RED_MASK = 92;
+	const size_t OFFSET_ALPHA_MASK = 104;
+
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDPF_RGB = 0x40;
+
+	uint32_t readU32(const unsigned char* data, size_t offset)
+	{
+		return (uint32_t)data[offset] | (uint32_t)data[offset + 1] << 8
+			| (uint32_t)data[offset + 2] << 16 | (uint32_t)data[offset + 3] << 24;
+	}
+
+	// -1 until the extension list has been checked
+	int g_compressedSupported = -1;
+}
+
+bool Dds::Parse(const unsigned char* data, size_t size, DdsImage& image)
+{
+	image.Levels.clear();
+	if (size < DDS_DATA_OFFSET || memcmp(data, "DDS ", 4) != 0 || readU32(data, OFFSET_HEADER_SIZE) != DDS_HEADER_SIZE)
+	{
+		std::cout << "ERROR::DDS: Not a DDS file\n";
+		return false;
+	}
+
+	uint32_t pixelFlags = readU32(data, OFFSET_PIXEL_FLAGS);
+	GLuint blockBytes = 0;
+	if (pixelFlags & DDPF_FOURCC)
+	{
+		if (memcmp(data + OFFSET_FOURCC, "DXT1", 4) == 0)
+			image.InternalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		else if (memcmp(data + OFFSET_FOURCC, "DXT5", 4) == 0)
+			image.InternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		else
+		{
+			std::cout << "ERROR::DDS: Unsupported FourCC " << std::string((const char*)data + OFFSET_FOURCC, 4) << "\n";
+			return false;
+		}
+		blockBytes = GLObjects::BytesPerBlock(image.InternalFormat);
+	}
+	else if ((pixelFlags & DDPF_RGB) && readU32(data, OFFSET_RGB_BIT_COUNT) == 32
+		&& readU32(data, OFFSET_RED_MASK) == 0x000000ff && readU32(data, OFFSET_ALPHA_MASK) == 0xff000000)
+	{
+		image.InternalFormat = GL_RGBA8;
+	}
+	else
+	{
+		std::cout << "ERROR::DDS: Unsupported pixel format\n";
+		return false;
+	}
+	image.Compressed = blockBytes > 0;
+
+	GLuint width = readU32(data, OFFSET_WIDTH);
+	GLuint height = readU32(data, OFFSET_HEIGHT);
+	GLuint levels = readU32(data, OFFSET_MIP_COUNT);
+	if (levels == 0)
+		levels = 1;
+	if (width == 0 || height == 0 || levels > GLObjects::MipLevels(width, height))
+	{
+		std::cout << "ERROR::DDS: Bad dimensions " << width << "x" << height << " with " << levels << " levels\n";
+		return false;
+	}
+
+	size_t offset = DDS_DATA_OFFSET;
+	for (GLuint level = 0; level < levels; ++level)
+	{
+		DdsLevel entry;
+		entry.Width = width >> level > 0 ? width >> level : 1;
+		entry.Height = height >> level > 0 ? height >> level : 1;
+		entry.Size = GLObjects::TextureBytes(image.InternalFormat, entry.Width, entry.Height);
+		if (offset + entry.Size > size)
+		{
+			std::cout << "ERROR::DDS: Truncated at level " << level << "\n";
+			image.Levels.clear();
+			return false;
+		}
+		entry.Data = data + offset;
+		offset += entry.Size;
+		image.Levels.push_back(entry);
+	}
+	return true;
+}
+
+bool Dds::CompressedSupported()
+{
+	if (g_compressedSupported < 0)
+	{
+		g_compressedSupported = 0;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; ++i)
+		{
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (extension && strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+			{
+				g_compressedSupported = 1;
+				break;
+			}
+		}
+	}
+	return g_compressedSupported == 1;
+}
+
+void Dds::Upload(const DdsImage& image)
+{
+	GLint texture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+	for (GLuint level = 0; level < image.Levels.size(); ++level)
+	{
+		// Storage now, contents once the upload queue gets to them
+		const DdsLevel& entry = image.Levels[level];
+		if (image.Compressed)
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, image.InternalFormat, entry.Width, entry.Height, 0, (GLsizei)entry.Size, NULL);
+			TextureUploads::QueueCompressed(texture, level, entry.Width, entry.Height, image.InternalFormat, entry.Data, entry.Size);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, image.InternalFormat, entry.Width, entry.Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			TextureUploads::Queue(texture, level, entry.Width, entry.Height, GL_RGBA, entry.Data, entry.Size);
+		}
+	}
+	// A chain that stops early would otherwise leave the texture incomplete under mipmapped filtering
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.Levels.size() - 1);
+}
+
+std::string Dds::CookedPath(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return path + ".dds";
+	return path.substr(0, dot) + ".dds";
+}
@@ -0,0 +1,50 @@
+#ifndef _dds_HG_
+#define _dds_HG_
+
+#include <globject/globject.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One mip level, pointing into the buffer that was parsed
+struct DdsLevel
+{
+	GLuint					Width;
+	GLuint					Height;
+	const unsigned char*	Data;
+	size_t					Size;
+};
+
+// A parsed DDS: BC1 (DXT1), BC3 (DXT5) or 32 bit RGBA, with its mip chain
+struct DdsImage
+{
+	GLenum					InternalFormat;
+	bool					Compressed;
+	std::vector<DdsLevel>	Levels;
+};
+
+// Loader for the textures tools/cook_textures.py writes next to their source
+// images. The levels are uploaded as they are stored, nothing is decoded or
+// generated at runtime, and compressed levels stay compressed in VRAM.
+class Dds
+{
+public:
+	// Fills image with views into data, which has to outlive it. False (with
+	// an ERROR::DDS message) for anything but the formats above.
+	static bool Parse(const unsigned char* data, size_t size, DdsImage& image);
+	// Whether the driver takes S3TC, asked once per run. Callers fall back to
+	// the source image when it doesn't.
+	static bool CompressedSupported();
+	// Specifies every level of the texture bound to GL_TEXTURE_2D and limits
+	// sampling to the levels that exist. The data goes through TextureUploads,
+	// which keeps its own copy, so the file can be closed straight after.
+	static void Upload(const DdsImage& image);
+	// Where the cooked version of an image lives, "textures/block.png" -> "textures/block.dds"
+	static std::string CookedPath(const std::string& path);
+
+private:
+	Dds() {}
+};
+
+#endif
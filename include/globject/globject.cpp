@@ -0,0 +1,302 @@
+#include "globject.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+	struct LiveObject
+	{
+		std::string		Label;
+		size_t			Bytes;
+		VramCategory	Category;
+	};
+
+	struct KindTotals
+	{
+		GLuint	Count;
+		size_t	Bytes;
+	};
+
+	// Keyed by kind and name together since names are only unique per kind
+	std::unordered_map<uint64_t, LiveObject> g_live;
+	KindTotals g_totals[GLOBJECT_KINDS] = {};
+	size_t g_categoryBytes[VRAM_CATEGORIES] = {};
+	size_t g_totalBytes = 0;
+	size_t g_budget = GLObjects::DEFAULT_BUDGET;
+	bool g_overBudget = false;
+
+	uint64_t liveKey(GLObjectKind kind, GLuint id)
+	{
+		return ((uint64_t)kind << 32) | id;
+	}
+
+	VramCategory defaultCategory(GLObjectKind kind)
+	{
+		switch (kind)
+		{
+		case GLOBJECT_BUFFER:		return VRAM_BUFFERS;
+		case GLOBJECT_RENDERBUFFER:	return VRAM_RENDER_TARGETS;
+		default:					return VRAM_TEXTURES;
+		}
+	}
+
+	// Warns once each time the total goes over the budget
+	void checkBudget()
+	{
+		bool over = g_totalBytes > g_budget;
+		if (over && !g_overBudget)
+		{
+			std::cout << "WARNING::GLOBJECT: Estimated GPU memory " << g_totalBytes / (1024 * 1024)
+				<< " MB is over the " << g_budget / (1024 * 1024) << " MB budget\n";
+		}
+		g_overBudget = over;
+	}
+
+	void addBytes(GLObjectKind kind, VramCategory category, size_t bytes)
+	{
+		g_totals[kind].Bytes += bytes;
+		g_categoryBytes[category] += bytes;
+		g_totalBytes += bytes;
+	}
+
+	void removeBytes(GLObjectKind kind, VramCategory category, size_t bytes)
+	{
+		g_totals[kind].Bytes -= bytes;
+		g_categoryBytes[category] -= bytes;
+		g_totalBytes -= bytes;
+	}
+}
+
+void GLObjects::Track(GLObjectKind kind, GLuint id, const char* label)
+{
+	LiveObject& object = g_live[liveKey(kind, id)];
+	object.Label = label;
+	object.Bytes = 0;
+	object.Category = defaultCategory(kind);
+	++g_totals[kind].Count;
+}
+
+void GLObjects::Untrack(GLObjectKind kind, GLuint id)
+{
+	auto live = g_live.find(liveKey(kind, id));
+	if (live == g_live.end())
+	{
+		std::cout << "ERROR::GLOBJECT: Deleting untracked " << KindName(kind) << " " << id << "\n";
+		return;
+	}
+	--g_totals[kind].Count;
+	removeBytes(kind, live->second.Category, live->second.Bytes);
+	g_live.erase(live);
+	checkBudget();
+}
+
+void GLObjects::SetLabel(GLObjectKind kind, GLuint id, const std::string& label)
+{
+	auto live = g_live.find(liveKey(kind, id));
+	if (live != g_live.end())
+		live->second.Label = label;
+}
+
+void GLObjects::SetBytes(GLObjectKind kind, GLuint id, size_t bytes)
+{
+	auto live = g_live.find(liveKey(kind, id));
+	if (live == g_live.end())
+		return;
+	removeBytes(kind, live->second.Category, live->second.Bytes);
+	addBytes(kind, live->second.Category, bytes);
+	live->second.Bytes = bytes;
+	checkBudget();
+}
+
+void GLObjects::SetCategory(GLObjectKind kind, GLuint id, VramCategory category)
+{
+	auto live = g_live.find(liveKey(kind, id));
+	if (live == g_live.end())
+		return;
+	removeBytes(kind, live->second.Category, live->second.Bytes);
+	addBytes(kind, category, live->second.Bytes);
+	live->second.Category = category;
+}
+
+GLuint GLObjects::Count(GLObjectKind kind)
+{
+	return g_totals[kind].Count;
+}
+
+size_t GLObjects::Bytes(GLObjectKind kind)
+{
+	return g_totals[kind].Bytes;
+}
+
+size_t GLObjects::CategoryBytes(VramCategory category)
+{
+	return g_categoryBytes[category];
+}
+
+size_t GLObjects::TotalBytes()
+{
+	return g_totalBytes;
+}
+
+GLuint GLObjects::TotalCount()
+{
+	return (GLuint)g_live.size();
+}
+
+const char* GLObjects::KindName(GLObjectKind kind)
+{
+	switch (kind)
+	{
+	case GLOBJECT_TEXTURE:		return "texture";
+	case GLOBJECT_BUFFER:		return "buffer";
+	case GLOBJECT_VERTEX_ARRAY:	return "vertex array";
+	case GLOBJECT_FRAMEBUFFER:	return "framebuffer";
+	case GLOBJECT_RENDERBUFFER:	return "renderbuffer";
+	case GLOBJECT_PROGRAM:		return "program";
+	case GLOBJECT_SHADER:		return "shader";
+	default:					return "unknown";
+	}
+}
+
+const char* GLObjects::CategoryName(VramCategory category)
+{
+	switch (category)
+	{
+	case VRAM_TEXTURES:			return "textures";
+	case VRAM_BUFFERS:			return "buffers";
+	case VRAM_RENDER_TARGETS:	return "render targets";
+	default:					return "unknown";
+	}
+}
+
+void GLObjects::SetBudget(size_t bytes)
+{
+	g_budget = bytes;
+	g_overBudget = false;
+	checkBudget();
+}
+
+size_t GLObjects::Budget()
+{
+	return g_budget;
+}
+
+GLuint GLObjects::BytesPerTexel(GLenum internalFormat)
+{
+	switch (internalFormat)
+	{
+	case GL_RED:
+	case GL_R8:
+		return 1;
+	case GL_RG:
+	case GL_RG8:
+	case GL_R16F:
+		return 2;
+	case GL_RGBA16F:
+	case GL_RGB16F:
+		return 8;
+	case GL_RGBA32F:
+	case GL_RGB32F:
+		return 16;
+	default:
+		// RGBA8, R32F, depth/stencil, and RGB8 since drivers pad it out to four bytes
+		return 4;
+	}
+}
+
+GLuint GLObjects::BytesPerBlock(GLenum internalFormat)
+{
+	switch (internalFormat)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		return 8;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+GLuint GLObjects::MipLevels(GLuint width, GLuint height)
+{
+	GLuint levels = 1;
+	for (GLuint size = width > height ? width : height; size > 1; size >>= 1)
+		++levels;
+	return levels;
+}
+
+size_t GLObjects::TextureBytes(GLenum internalFormat, GLuint width, GLuint height, GLuint samples, GLuint levels)
+{
+	GLuint blockBytes = BytesPerBlock(internalFormat);
+	size_t bytes = 0;
+	for (GLuint level = 0; level < levels; ++level)
+	{
+		GLuint w = width >> level;
+		GLuint h = height >> level;
+		w = w > 0 ? w : 1;
+		h = h > 0 ? h : 1;
+		// Compressed levels are stored as whole blocks, so a 2x2 level still takes one
+		if (blockBytes > 0)
+			bytes += (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+		else
+			bytes += (size_t)w * h * BytesPerTexel(internalFormat);
+	}
+	return bytes * (samples > 0 ? samples : 1);
+}
+
+void GLObjects::Report(const char* title)
+{
+	std::cout << "GLOBJECTS: " << title << ", " << g_live.size() << " live, "
+		<< g_totalBytes / 1024 << " KB of " << g_budget / (1024 * 1024) << " MB budget\n";
+	for (int kind = 0; kind < GLOBJECT_KINDS; ++kind)
+	{
+		if (g_totals[kind].Count == 0)
+			continue;
+		std::cout << "  " << KindName((GLObjectKind)kind) << "s: " << g_totals[kind].Count
+			<< " (" << g_totals[kind].Bytes / 1024 << " KB)\n";
+	}
+	for (int category = 0; category < VRAM_CATEGORIES; ++category)
+	{
+		std::cout << "  " << CategoryName((VramCategory)category) << ": "
+			<< g_categoryBytes[category] / 1024 << " KB\n";
+	}
+	for (const auto& live : g_live)
+	{
+		std::cout << "    " << KindName((GLObjectKind)(live.first >> 32)) << " " << (GLuint)live.first
+			<< " " << live.second.Label << " " << live.second.Bytes << " bytes\n";
+	}
+}
+
+GLuint GLObjectCreate(GLObjectKind kind)
+{
+	GLuint id = 0;
+	switch (kind)
+	{
+	case GLOBJECT_TEXTURE:		glGenTextures(1, &id); break;
+	case GLOBJECT_BUFFER:		glGenBuffers(1, &id); break;
+	case GLOBJECT_VERTEX_ARRAY:	glGenVertexArrays(1, &id); break;
+	case GLOBJECT_FRAMEBUFFER:	glGenFramebuffers(1, &id); break;
+	case GLOBJECT_RENDERBUFFER:	glGenRenderbuffers(1, &id); break;
+	case GLOBJECT_PROGRAM:		id = glCreateProgram(); break;
+	default:					break;
+	}
+	return id;
+}
+
+void GLObjectDelete(GLObjectKind kind, GLuint id)
+{
+	switch (kind)
+	{
+	case GLOBJECT_TEXTURE:		glDeleteTextures(1, &id); break;
+	case GLOBJECT_BUFFER:		glDeleteBuffers(1, &id); break;
+	case GLOBJECT_VERTEX_ARRAY:	glDeleteVertexArrays(1, &id); break;
+	case GLOBJECT_FRAMEBUFFER:	glDeleteFramebuffers(1, &id); break;
+	case GLOBJECT_RENDERBUFFER:	glDeleteRenderbuffers(1, &id); break;
+	case GLOBJECT_PROGRAM:		glDeleteProgram(id); break;
+	case GLOBJECT_SHADER:		glDeleteShader(id); break;
+	default:					break;
+	}
+}
@@ -0,0 +1,159 @@
+#ifndef _globject_HG_
+#define _globject_HG_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+
+// S3TC formats, glad here only has the core profile
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+enum GLObjectKind
+{
+	GLOBJECT_TEXTURE,
+	GLOBJECT_BUFFER,
+	GLOBJECT_VERTEX_ARRAY,
+	GLOBJECT_FRAMEBUFFER,
+	GLOBJECT_RENDERBUFFER,
+	GLOBJECT_PROGRAM,
+	GLOBJECT_SHADER,		// a compiled stage waiting to be linked, only ever adopted
+	GLOBJECT_KINDS
+};
+
+// What the storage behind an object is used for. Objects start in the
+// category their kind implies (renderbuffers are render targets) and textures
+// that are drawn into are moved with SetCategory.
+enum VramCategory
+{
+	VRAM_TEXTURES,
+	VRAM_BUFFERS,
+	VRAM_RENDER_TARGETS,
+	VRAM_CATEGORIES
+};
+
+// Registry of every live GL object created through GLObject, with the bytes
+// of storage each one was given. Counts and bytes are what the HUD shows,
+// Report lists everything still alive (with the label it was created with)
+// so a leak shows up by name instead of as a slowly growing driver footprint.
+//
+// Bytes are estimates (format x dimensions x samples x mip levels, see
+// TextureBytes), the driver adds padding and alignment we can't see. Once
+// the estimated total goes over the budget a warning is printed, the default
+// budget is what a small integrated GPU can spare.
+class GLObjects
+{
+public:
+	static const size_t DEFAULT_BUDGET = 512 * 1024 * 1024;
+
+	static void Track(GLObjectKind kind, GLuint id, const char* label);
+	static void Untrack(GLObjectKind kind, GLuint id);
+	// Replaces the label given at creation, e.g. with the resource name
+	static void SetLabel(GLObjectKind kind, GLuint id, const std::string& label);
+	// Replaces the storage size recorded for the object
+	static void SetBytes(GLObjectKind kind, GLuint id, size_t bytes);
+	static void SetCategory(GLObjectKind kind, GLuint id, VramCategory category);
+
+	static GLuint Count(GLObjectKind kind);
+	static size_t Bytes(GLObjectKind kind);
+	static size_t CategoryBytes(VramCategory category);
+	static size_t TotalBytes();
+	static GLuint TotalCount();
+	static const char* KindName(GLObjectKind kind);
+	static const char* CategoryName(VramCategory category);
+
+	static void SetBudget(size_t bytes);
+	static size_t Budget();
+
+	// Rough bytes per texel for the unsized/sized formats used in this project
+	static GLuint BytesPerTexel(GLenum internalFormat);
+	// Bytes per 4x4 block of a block compressed format, 0 for anything else
+	static GLuint BytesPerBlock(GLenum internalFormat);
+	// Levels in a full mip chain down to 1x1
+	static GLuint MipLevels(GLuint width, GLuint height);
+	// Estimated storage of a 2D texture or renderbuffer
+	static size_t TextureBytes(GLenum internalFormat, GLuint width, GLuint height, GLuint samples = 1, GLuint levels = 1);
+
+	// Prints the per kind and per category totals followed by every live object
+	static void Report(const char* title);
+
+private:
+	GLObjects() {}
+};
+
+GLuint GLObjectCreate(GLObjectKind kind);
+void GLObjectDelete(GLObjectKind kind, GLuint id);
+
+// Move-only owner of one GL object. Deleting it (or moving another object
+// into it) deletes the GL object, so nothing is leaked and nothing is deleted
+// twice because two copies shared an ID.
+template <GLObjectKind Kind>
+class GLObject
+{
+public:
+	GLObject() : m_id(0) {}
+	~GLObject() { this->Reset(); }
+
+	// Generates a new object, label must be a string literal
+	static GLObject Create(const char* label)
+	{
+		return GLObject::Adopt(GLObjectCreate(Kind), label);
+	}
+	// Takes ownership of an object made elsewhere (glCreateShader)
+	static GLObject Adopt(GLuint id, const char* label)
+	{
+		GLObject object;
+		object.m_id = id;
+		if (id != 0)
+			GLObjects::Track(Kind, id, label);
+		return object;
+	}
+
+	GLObject(GLObject&& other) : m_id(other.m_id) { other.m_id = 0; }
+	GLObject& operator=(GLObject&& other)
+	{
+		if (this != &other)
+		{
+			this->Reset();
+			this->m_id = other.m_id;
+			other.m_id = 0;
+		}
+		return *this;
+	}
+	GLObject(const GLObject&) = delete;
+	GLObject& operator=(const GLObject&) = delete;
+
+	GLuint ID() const { return this->m_id; }
+	explicit operator bool() const { return this->m_id != 0; }
+
+	void SetBytes(size_t bytes) const { GLObjects::SetBytes(Kind, this->m_id, bytes); }
+	void SetLabel(const std::string& label) const { GLObjects::SetLabel(Kind, this->m_id, label); }
+	void SetCategory(VramCategory category) const { GLObjects::SetCategory(Kind, this->m_id, category); }
+
+	void Reset()
+	{
+		if (this->m_id == 0)
+			return;
+		GLObjects::Untrack(Kind, this->m_id);
+		GLObjectDelete(Kind, this->m_id);
+		this->m_id = 0;
+	}
+
+private:
+	GLuint m_id;
+};
+
+typedef GLObject<GLOBJECT_TEXTURE>		GLTexture;
+typedef GLObject<GLOBJECT_BUFFER>		GLBuffer;
+typedef GLObject<GLOBJECT_VERTEX_ARRAY>	GLVertexArray;
+typedef GLObject<GLOBJECT_FRAMEBUFFER>	GLFramebuffer;
+typedef GLObject<GLOBJECT_RENDERBUFFER>	GLRenderbuffer;
+typedef GLObject<GLOBJECT_PROGRAM>		GLProgram;
+typedef GLObject<GLOBJECT_SHADER>		GLShader;
+
+#endif
@@ -0,0 +1,207 @@
+#include "headless.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifndef _WIN32
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
+
+const double Headless::FRAME_TIME = 1.0 / 60.0;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	bool				g_active = false;
+	GLuint				g_frames = 0;
+	GLuint				g_frame = 0;
+	std::vector<double>	g_frameMs;		// reserved by Create, a frame never allocates
+	Clock::time_point	g_frameStart;
+	Clock::time_point	g_runStart;		// first BeginFrame
+	Clock::time_point	g_runEnd;		// last EndFrame
+
+#ifndef _WIN32
+	EGLDisplay			g_display = EGL_NO_DISPLAY;
+	EGLSurface			g_surface = EGL_NO_SURFACE;
+	EGLContext			g_context = EGL_NO_CONTEXT;
+
+	// The surfaceless platform renders without X or a DRM master, the default
+	// display is only a fallback for EGL implementations that don't have it
+	EGLDisplay openDisplay()
+	{
+		const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless"))
+		{
+			PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+				(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+			if (getPlatformDisplay)
+			{
+				EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+				if (display != EGL_NO_DISPLAY)
+					return display;
+			}
+		}
+		return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+#endif
+
+	double percentile(const std::vector<double>& sorted, double fraction)
+	{
+		size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+		return sorted[index];
+	}
+}
+
+bool Headless::Create(GLuint width, GLuint height, GLuint frames, int major, int minor)
+{
+#ifdef _WIN32
+	std::cout << "ERROR::HEADLESS: Headless rendering needs EGL, which this platform doesn't have\n";
+	return false;
+#else
+	g_display = openDisplay();
+	EGLint eglMajor = 0, eglMinor = 0;
+	if (g_display == EGL_NO_DISPLAY || !eglInitialize(g_display, &eglMajor, &eglMinor))
+	{
+		std::cout << "ERROR::HEADLESS: No EGL display (0x" << std::hex << eglGetError() << std::dec << ")\n";
+		g_display = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(g_display, configAttributes, &config, 1, &configCount) || configCount == 0)
+	{
+		std::cout << "ERROR::HEADLESS: No RGBA8 pbuffer config for desktop GL\n";
+		Destroy();
+		return false;
+	}
+
+	const EGLint surfaceAttributes[] = { EGL_WIDTH, (EGLint)width, EGL_HEIGHT, (EGLint)height, EGL_NONE };
+	g_surface = eglCreatePbufferSurface(g_display, config, surfaceAttributes);
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, major,
+		EGL_CONTEXT_MINOR_VERSION_KHR, minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+	if (g_surface != EGL_NO_SURFACE && eglBindAPI(EGL_OPENGL_API))
+		g_context = eglCreateContext(g_display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (g_context == EGL_NO_CONTEXT || !eglMakeCurrent(g_display, g_surface, g_surface, g_context))
+	{
+		std::cout << "ERROR::HEADLESS: Couldn't create a " << width << "x" << height << " pbuffer with a "
+			<< major << "." << minor << " core context (0x" << std::hex << eglGetError() << std::dec << ")\n";
+		Destroy();
+		return false;
+	}
+
+	g_active = true;
+	g_frames = frames;
+	g_frame = 0;
+	g_frameMs.clear();
+	g_frameMs.reserve(frames);
+	std::cout << "Headless: EGL " << eglMajor << "." << eglMinor << ", " << width << "x" << height
+		<< " pbuffer, " << frames << " frames\n";
+	return true;
+#endif
+}
+
+void Headless::Destroy()
+{
+#ifndef _WIN32
+	if (g_display != EGL_NO_DISPLAY)
+	{
+		eglMakeCurrent(g_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (g_context != EGL_NO_CONTEXT)
+			eglDestroyContext(g_display, g_context);
+		if (g_surface != EGL_NO_SURFACE)
+			eglDestroySurface(g_display, g_surface);
+		eglTerminate(g_display);
+	}
+	g_display = EGL_NO_DISPLAY;
+	g_surface = EGL_NO_SURFACE;
+	g_context = EGL_NO_CONTEXT;
+#endif
+	g_active = false;
+}
+
+bool Headless::Active()
+{
+	return g_active;
+}
+
+GLADloadproc Headless::Loader()
+{
+#ifdef _WIN32
+	return nullptr;
+#else
+	return (GLADloadproc)eglGetProcAddress;
+#endif
+}
+
+bool Headless::Running()
+{
+	return g_active && g_frame < g_frames;
+}
+
+void Headless::BeginFrame()
+{
+	g_frameStart = Clock::now();
+	if (g_frameMs.empty())
+		g_runStart = g_frameStart;
+}
+
+void Headless::EndFrame()
+{
+#ifndef _WIN32
+	eglSwapBuffers(g_display, g_surface);
+#endif
+	glFinish();
+	g_runEnd = Clock::now();
+	g_frameMs.push_back(std::chrono::duration<double, std::milli>(g_runEnd - g_frameStart).count());
+	++g_frame;
+}
+
+GLuint Headless::Frame()
+{
+	return g_frame;
+}
+
+double Headless::Time()
+{
+	return g_frame * FRAME_TIME;
+}
+
+void Headless::Report()
+{
+	if (g_frameMs.empty())
+		return;
+
+	std::vector<double> sorted(g_frameMs);
+	std::sort(sorted.begin(), sorted.end());
+	double summed = 0.0;
+	for (double ms : sorted)
+		summed += ms;
+	// Includes whatever the program does between EndFrame and the next BeginFrame
+	double wall = std::chrono::duration<double, std::milli>(g_runEnd - g_runStart).count();
+
+	char line[256];
+	snprintf(line, sizeof(line), "Headless: %zu frames in %.1f ms wall (%.1f ms summed frame time), %.1f fps on %s\n",
+		sorted.size(), wall, summed, sorted.size() * 1000.0 / wall, (const char*)glGetString(GL_RENDERER));
+	std::cout << line;
+	snprintf(line, sizeof(line), "Headless: frame ms min %.2f p50 %.2f p95 %.2f p99 %.2f max %.2f\n",
+		sorted.front(), percentile(sorted, 0.5), percentile(sorted, 0.95), percentile(sorted, 0.99), sorted.back());
+	std::cout << line;
+}
@@ -0,0 +1,62 @@
+#ifndef _headless_HG_
+#define _headless_HG_
+
+#include <glad/glad.h>
+
+// Runs a program without a window, for render benchmarks and frame dumps on
+// machines with no display or GPU. Create makes an EGL pbuffer the size of
+// the window it replaces and a core context on it, preferring Mesa's
+// surfaceless platform so neither X nor a GPU is needed (with
+// LIBGL_ALWAYS_SOFTWARE=1 it is always llvmpipe). The pbuffer is the
+// default framebuffer, so framebuffer 0 passes and glReadPixels work as
+// they do on a window.
+//
+//	Headless::Create(800, 600, frames);
+//	gladLoadGLLoader(Headless::Loader());
+//	while (Headless::Running())
+//	{
+//		Headless::BeginFrame();
+//		... update with Headless::FRAME_TIME, render ...
+//		Headless::EndFrame();
+//	}
+//	Headless::Report();
+//	Headless::Destroy();
+//
+// Time advances by FRAME_TIME a frame whatever the frame really took, so
+// two runs animate and render the same frames. EndFrame waits for the GPU
+// so each frame's time covers its rendering, not just its submission.
+//
+// Linux only (link with -lEGL), Create fails elsewhere.
+class Headless
+{
+public:
+	static const double FRAME_TIME;
+
+	// Makes a width x height pbuffer and a major.minor core context current
+	// and readies frames frames of timing. False with an ERROR::HEADLESS
+	// message if there is no EGL or it can't provide either.
+	static bool Create(GLuint width, GLuint height, GLuint frames, int major = 3, int minor = 3);
+	static void Destroy();
+	// Whether Create succeeded, GLFW is never initialised in that case
+	static bool Active();
+	// eglGetProcAddress, for gladLoadGLLoader
+	static GLADloadproc Loader();
+
+	// True until the frames asked for have been rendered
+	static bool Running();
+	static void BeginFrame();
+	// Swaps, waits for the GPU to finish and records the frame time
+	static void EndFrame();
+	// Frames finished so far and the fixed clock, Frame() * FRAME_TIME
+	static GLuint Frame();
+	static double Time();
+
+	// Frame count, wall time from the first BeginFrame to the last EndFrame,
+	// the frame rate over it, summed frame time and min/p50/p95/p99/max frame times
+	static void Report();
+
+private:
+	Headless() {}
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "memtrack.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace
+{
+	struct BlockHeader
+	{
+		size_t		Size;
+		uint32_t	Category;
+		uint32_t	Magic;
+	};
+
+	const uint32_t BLOCK_MAGIC = 0x4D454D54;	// "MEMT"
+	// Rounded up so the memory handed out keeps the alignment malloc gave the block
+	const size_t HEADER_BYTES = (sizeof(BlockHeader) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+	// Plain atomics only, they are constant initialized so allocations made
+	// before main (or after it returns) are safe to count
+	struct CategoryCounters
+	{
+		std::atomic<size_t>		LiveBytes;
+		std::atomic<size_t>		PeakBytes;
+		std::atomic<size_t>		LiveBlocks;
+		std::atomic<uint64_t>	Allocations;
+		std::atomic<uint64_t>	AllocatedBytes;
+	};
+
+	CategoryCounters g_counters[MEM_CATEGORIES];
+	thread_local MemCategory t_category = MEM_GENERAL;
+	thread_local uint64_t t_allocations = 0;
+
+	// What the previous report saw, to turn totals into rates
+	std::mutex g_reportMutex;
+	uint64_t g_reportedAllocations[MEM_CATEGORIES];
+	uint64_t g_reportedBytes[MEM_CATEGORIES];
+	std::chrono::steady_clock::time_point g_reportedAt = std::chrono::steady_clock::now();
+
+	void raisePeak(std::atomic<size_t>& peak, size_t live)
+	{
+		size_t seen = peak.load(std::memory_order_relaxed);
+		while (live > seen && !peak.compare_exchange_weak(seen, live, std::memory_order_relaxed))
+		{
+		}
+	}
+}
+
+bool MemTrack::Enabled()
+{
+#ifdef MEMTRACK_ENABLED
+	return true;
+#else
+	return false;
+#endif
+}
+
+MemCategory MemTrack::SetCategory(MemCategory category)
+{
+	MemCategory previous = t_category;
+	t_category = category;
+	return previous;
+}
+
+MemCategory MemTrack::Category()
+{
+	return t_category;
+}
+
+const char* MemTrack::CategoryName(MemCategory category)
+{
+	switch (category)
+	{
+	case MEM_GENERAL:	return "general";
+	case MEM_ASSETS:	return "assets";
+	case MEM_PARTICLES:	return "particles";
+	case MEM_TEXT:		return "text";
+	case MEM_LEVEL:		return "level";
+	case MEM_MODEL:		return "model";
+	default:			return "unknown";
+	}
+}
+
+MemTrack::Stats MemTrack::Get(MemCategory category)
+{
+	const CategoryCounters& counters = g_counters[category];
+	Stats stats;
+	stats.LiveBytes = counters.LiveBytes.load(std::memory_order_relaxed);
+	stats.PeakBytes = counters.PeakBytes.load(std::memory_order_relaxed);
+	stats.LiveBlocks = counters.LiveBlocks.load(std::memory_order_relaxed);
+	stats.Allocations = counters.Allocations.load(std::memory_order_relaxed);
+	stats.AllocatedBytes = counters.AllocatedBytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+uint64_t MemTrack::ThreadAllocations()
+{
+	return t_allocations;
+}
+
+void MemTrack::Report(const char* title)
+{
+	std::lock_guard<std::mutex> lock(g_reportMutex);
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - g_reportedAt).count();
+	g_reportedAt = now;
+
+	if (!Enabled())
+	{
+		printf("MEMTRACK: %s, not built with MEMTRACK_ENABLED\n", title);
+		return;
+	}
+
+	printf("MEMTRACK: %s\n", title);
+	printf("  %-10s %12s %12s %10s %12s %12s\n", "category", "live KB", "peak KB", "blocks", "allocs/s", "KB/s");
+	size_t totalLive = 0;
+	for (int category = 0; category < MEM_CATEGORIES; ++category)
+	{
+		Stats stats = Get((MemCategory)category);
+		uint64_t allocations = stats.Allocations - g_reportedAllocations[category];
+		uint64_t bytes = stats.AllocatedBytes - g_reportedBytes[category];
+		g_reportedAllocations[category] = stats.Allocations;
+		g_reportedBytes[category] = stats.AllocatedBytes;
+		totalLive += stats.LiveBytes;
+
+		printf("  %-10s %12.1f %12.1f %10zu %12.1f %12.1f\n", CategoryName((MemCategory)category),
+			stats.LiveBytes / 1024.0, stats.PeakBytes / 1024.0, stats.LiveBlocks,
+			seconds > 0.0 ? allocations / seconds : 0.0, seconds > 0.0 ? bytes / 1024.0 / seconds : 0.0);
+	}
+	printf("  %-10s %12.1f\n", "total", totalLive / 1024.0);
+}
+
+void* MemTrack::Allocate(size_t size)
+{
+	BlockHeader* header = (BlockHeader*)std::malloc(HEADER_BYTES + size);
+	if (!header)
+		return nullptr;
+
+	MemCategory category = t_category;
+	header->Size = size;
+	header->Category = (uint32_t)category;
+	header->Magic = BLOCK_MAGIC;
+
+	CategoryCounters& counters = g_counters[category];
+	size_t live = counters.LiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	raisePeak(counters.PeakBytes, live);
+	counters.LiveBlocks.fetch_add(1, std::memory_order_relaxed);
+	counters.Allocations.fetch_add(1, std::memory_order_relaxed);
+	counters.AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	++t_allocations;
+
+	return (unsigned char*)header + HEADER_BYTES;
+}
+
+void MemTrack::Free(void* block)
+{
+	if (!block)
+		return;
+
+	BlockHeader* header = (BlockHeader*)((unsigned char*)block - HEADER_BYTES);
+	if (header->Magic != BLOCK_MAGIC)
+	{
+		fprintf(stderr, "ERROR::MEMTRACK: Freeing a block that wasn't allocated by operator new\n");
+		std::abort();
+	}
+	header->Magic = 0;
+
+	CategoryCounters& counters = g_counters[header->Category];
+	counters.LiveBytes.fetch_sub(header->Size, std::memory_order_relaxed);
+	counters.LiveBlocks.fetch_sub(1, std::memory_order_relaxed);
+	std::free(header);
+}
+
+#ifdef MEMTRACK_ENABLED
+
+void* operator new(size_t size)
+{
+	void* p = MemTrack::Allocate(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	void* p = MemTrack::Allocate(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return MemTrack::Allocate(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return MemTrack::Allocate(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept
+{
+	MemTrack::Free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	MemTrack::Free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	MemTrack::Free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	MemTrack::Free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	MemTrack::Free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	MemTrack::Free(p);
+}
+
+#endif
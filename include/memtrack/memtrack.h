@@ -0,0 +1,95 @@
+#ifndef _memtrack_HG_
+#define _memtrack_HG_
+
+#include <cstddef>
+#include <cstdint>
+
+// Opt-in accounting of every global operator new/delete, split by subsystem.
+// Add MEMTRACK_ENABLED to the project's preprocessor definitions to replace
+// the global allocator, otherwise the MEMTRACK_ macros expand to nothing and
+// the allocator is left alone.
+//
+//	MEMTRACK_SCOPE(MEM_MODEL);		// allocations in the enclosing scope are model memory
+//	MEMTRACK_REPORT("at exit");		// live, peak and rate per category
+//
+// Each block carries a small header with its size and category, so freeing it
+// is charged to the subsystem that allocated it, whoever does the freeing.
+// Memory from malloc (stb_image, the driver) isn't seen.
+enum MemCategory
+{
+	MEM_GENERAL,	// anything allocated outside a MEMTRACK_SCOPE
+	MEM_ASSETS,		// shaders, textures and other loaded files
+	MEM_PARTICLES,
+	MEM_TEXT,
+	MEM_LEVEL,
+	MEM_MODEL,
+	MEM_CATEGORIES
+};
+
+class MemTrack
+{
+public:
+	struct Stats
+	{
+		size_t		LiveBytes;
+		size_t		PeakBytes;
+		size_t		LiveBlocks;
+		uint64_t	Allocations;	// since startup
+		uint64_t	AllocatedBytes;	// since startup, frees not subtracted
+	};
+
+	// False unless built with MEMTRACK_ENABLED
+	static bool Enabled();
+
+	// Category new allocations on the calling thread are charged to, returns the previous one
+	static MemCategory SetCategory(MemCategory category);
+	static MemCategory Category();
+	static const char* CategoryName(MemCategory category);
+
+	static Stats Get(MemCategory category);
+	// operator new calls made by the calling thread so far
+	static uint64_t ThreadAllocations();
+
+	// Prints live and peak bytes per category and the allocation rate since
+	// the previous report
+	static void Report(const char* title);
+
+	// Used by the operator new/delete replacements
+	static void* Allocate(size_t size);
+	static void Free(void* block);
+
+private:
+	MemTrack() {}
+};
+
+// Charges allocations made until the end of the scope to a category
+class MemScope
+{
+public:
+	explicit MemScope(MemCategory category)
+		: m_previous(MemTrack::SetCategory(category))
+	{
+	}
+	~MemScope()
+	{
+		MemTrack::SetCategory(m_previous);
+	}
+
+	MemScope(const MemScope&) = delete;
+	MemScope& operator=(const MemScope&) = delete;
+
+private:
+	MemCategory m_previous;
+};
+
+#ifdef MEMTRACK_ENABLED
+	#define MEMTRACK_CONCAT_(a, b) a##b
+	#define MEMTRACK_CONCAT(a, b) MEMTRACK_CONCAT_(a, b)
+	#define MEMTRACK_SCOPE(category) MemScope MEMTRACK_CONCAT(memScope_, __LINE__)(category)
+	#define MEMTRACK_REPORT(title) MemTrack::Report(title)
+#else
+	#define MEMTRACK_SCOPE(category) ((void)0)
+	#define MEMTRACK_REPORT(title) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+#include "shadercache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+	struct BinaryHeader
+	{
+		uint32_t	Magic;
+		uint32_t	Format;
+		uint32_t	Length;
+	};
+
+	const uint32_t BINARY_MAGIC = 0x4E424853;	// "SHBN"
+	const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	const uint64_t FNV_PRIME = 1099511628211ull;
+
+	bool g_initialized = false;
+	bool g_enabled = false;
+	bool g_parallel = false;
+	std::string g_directory = "shadercache";
+	uint64_t g_driverHash = FNV_OFFSET;
+	GLuint g_hits = 0;
+	GLuint g_misses = 0;
+
+	uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	uint64_t hashString(uint64_t hash, const char* text)
+	{
+		// The terminator is hashed too so "ab" + "c" differs from "a" + "bc"
+		return hashBytes(hash, text, strlen(text) + 1);
+	}
+
+	void ensureInit()
+	{
+		if (g_initialized)
+			return;
+		g_initialized = true;
+
+		GLint formats = 0;
+		if (glGetProgramBinary != nullptr && glProgramBinary != nullptr)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		g_enabled = formats > 0;
+
+		GLint extensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+		for (GLint i = 0; i < extensions; ++i)
+		{
+			const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (name && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+				g_parallel = true;
+		}
+
+		const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+		for (GLenum name : strings)
+		{
+			const char* value = (const char*)glGetString(name);
+			g_driverHash = hashString(g_driverHash, value ? value : "");
+		}
+	}
+
+	std::string binaryPath(uint64_t key)
+	{
+		char file[32];
+		snprintf(file, sizeof(file), "/%016llx.bin", (unsigned long long)key);
+		return g_directory + file;
+	}
+
+	void makeDirectory(const std::string& directory)
+	{
+#ifdef _WIN32
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+	}
+}
+
+void ShaderCache::Init(const char* directory)
+{
+	g_directory = directory;
+	ensureInit();
+}
+
+bool ShaderCache::Enabled()
+{
+	ensureInit();
+	return g_enabled;
+}
+
+bool ShaderCache::ParallelCompile()
+{
+	ensureInit();
+	return g_parallel;
+}
+
+uint64_t ShaderCache::Key(const char* const* parts, int count)
+{
+	ensureInit();
+	uint64_t hash = g_driverHash;
+	for (int i = 0; i < count; ++i)
+	{
+		if (parts[i] != nullptr)
+			hash = hashString(hash, parts[i]);
+		else
+			hash = hashBytes(hash, "\xff", 1);
+	}
+	return hash;
+}
+
+bool ShaderCache::Load(GLuint program, uint64_t key)
+{
+	ensureInit();
+	if (!g_enabled)
+	{
+		++g_misses;
+		return false;
+	}
+
+	std::ifstream file(binaryPath(key), std::ios::binary);
+	BinaryHeader header;
+	if (!file || !file.read((char*)&header, sizeof(header)) || header.Magic != BINARY_MAGIC)
+	{
+		++g_misses;
+		return false;
+	}
+	std::vector<char> binary(header.Length);
+	if (!file.read(binary.data(), header.Length))
+	{
+		++g_misses;
+		return false;
+	}
+
+	glProgramBinary(program, header.Format, binary.data(), (GLsizei)header.Length);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		// Usually a driver update that kept its version string, it gets recompiled and overwritten
+		++g_misses;
+		return false;
+	}
+	++g_hits;
+	return true;
+}
+
+void ShaderCache::Store(GLuint program, uint64_t key)
+{
+	ensureInit();
+	if (!g_enabled)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, binary.data());
+
+	makeDirectory(g_directory);
+	// Written aside and renamed, so a crash never leaves a truncated binary under the key
+	std::string path = binaryPath(key);
+	std::string partial = path + ".tmp";
+	{
+		std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+		BinaryHeader header = { BINARY_MAGIC, format, (uint32_t)written };
+		if (!file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), written))
+		{
+			std::cout << "ERROR::SHADERCACHE: Failed to write " << partial << "\n";
+			return;
+		}
+	}
+	std::remove(path.c_str());
+	if (std::rename(partial.c_str(), path.c_str()) != 0)
+		std::cout << "ERROR::SHADERCACHE: Failed to replace " << path << "\n";
+}
+
+bool ShaderCache::LinkCompleted(GLuint program)
+{
+	ensureInit();
+	if (!g_parallel)
+		return true;
+	GLint completed = GL_FALSE;
+	glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
+
+GLuint ShaderCache::Hits()
+{
+	return g_hits;
+}
+
+GLuint ShaderCache::Misses()
+{
+	return g_misses;
+}
@@ -0,0 +1,52 @@
+#ifndef _shadercache_HG_
+#define _shadercache_HG_
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// On disk cache of linked program binaries (glGetProgramBinary), so a warm
+// start skips GLSL compilation entirely.
+//
+//	uint64_t key = ShaderCache::Key(sources, count);
+//	if (!ShaderCache::Load(program, key))
+//	{
+//		... compile, set GL_PROGRAM_BINARY_RETRIEVABLE_HINT, link, check ...
+//		ShaderCache::Store(program, key);
+//	}
+//
+// Keys hash the sources together with the GL vendor, renderer and version
+// strings, so a driver update misses instead of loading a stale binary. A
+// binary the driver refuses anyway is just a miss. Everything needs a current
+// context; the first call reads the driver strings and extensions.
+class ShaderCache
+{
+public:
+	// Where binaries are kept (default "shadercache"), call before the first load
+	static void Init(const char* directory);
+
+	// False if the driver has no program binary formats, loads then always miss
+	static bool Enabled();
+	// GL_KHR_parallel_shader_compile is present, so LinkCompleted doesn't block
+	static bool ParallelCompile();
+
+	// Hash of the driver strings and every part (sources, varyings, ...), null parts count too
+	static uint64_t Key(const char* const* parts, int count);
+
+	// Loads the binary for key into program, true if it linked
+	static bool Load(GLuint program, uint64_t key);
+	// Writes the binary of a linked program
+	static void Store(GLuint program, uint64_t key);
+
+	// True once the program's link has finished; without parallel compile the
+	// driver gives no way to ask so it is always true (and the next query waits)
+	static bool LinkCompleted(GLuint program);
+
+	static GLuint Hits();
+	static GLuint Misses();
+
+private:
+	ShaderCache() {}
+};
+
+#endif
@@ -0,0 +1,308 @@
+#include "texupload.h"
+
+#include <globject/globject.h>
+#include <trace/trace.h>
+
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// Each slice starts on this boundary in the staging buffer
+	const size_t SLICE_ALIGNMENT = 16;
+
+	struct Upload
+	{
+		GLuint						Texture;
+		GLint						Level;
+		GLsizei						Width;
+		GLsizei						Height;
+		GLenum						Format;			// pixel format, or the compressed internal format
+		bool						Compressed;
+		bool						GenerateMipmap;
+		size_t						RowBytes;		// one row of pixels, or one row of 4x4 blocks
+		GLsizei						RowHeight;		// 1, or 4 for blocks
+		GLsizei						Rows;
+		GLsizei						NextRow;
+		std::vector<unsigned char>	Data;
+	};
+
+	// A run of rows copied into the staging buffer this Pump
+	struct Slice
+	{
+		const Upload*	Source;
+		GLsizei			FirstRow;
+		GLsizei			Rows;
+		size_t			Offset;
+		bool			Last;
+	};
+
+	// Owned from Init to Shutdown, a static GLBuffer would be deleted after the context is gone
+	GLBuffer*			g_staging = nullptr;
+	size_t				g_frameBytes = 0;
+	GLuint				g_segment = 0;
+	GLsync				g_fences[TextureUploads::SEGMENTS] = {};
+	std::deque<Upload>	g_queue;
+	std::vector<Slice>	g_slices;
+	size_t				g_pendingBytes = 0;
+
+	GLuint components(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_RED: return 1;
+		case GL_RG: return 2;
+		case GL_RGB: return 3;
+		default: return 4;
+		}
+	}
+
+	void uploadDirect(const Upload& upload, const unsigned char* data, size_t bytes)
+	{
+		GLint alignment;
+		GLint bound;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glBindTexture(GL_TEXTURE_2D, upload.Texture);
+		if (upload.Compressed)
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, upload.Level, 0, 0, upload.Width, upload.Height, upload.Format, (GLsizei)bytes, data);
+		else
+			glTexSubImage2D(GL_TEXTURE_2D, upload.Level, 0, 0, upload.Width, upload.Height, upload.Format, GL_UNSIGNED_BYTE, data);
+		if (upload.GenerateMipmap)
+			glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, bound);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	}
+
+	void enqueue(Upload& upload, const void* data, size_t bytes)
+	{
+		size_t needed = upload.RowBytes * upload.Rows;
+		if (bytes < needed)
+		{
+			std::cout << "ERROR::TEXUPLOAD: " << bytes << " bytes given for a " << upload.Width << "x" << upload.Height
+				<< " upload that needs " << needed << "\n";
+			return;
+		}
+		// Rows that wouldn't fit a segment on their own can never be staged
+		if (!g_staging || upload.RowBytes > g_frameBytes)
+		{
+			if (g_staging)
+				std::cout << "ERROR::TEXUPLOAD: Rows of " << upload.RowBytes << " bytes don't fit the staging buffer, uploading directly\n";
+			uploadDirect(upload, (const unsigned char*)data, needed);
+			return;
+		}
+		upload.Data.assign((const unsigned char*)data, (const unsigned char*)data + needed);
+		g_pendingBytes += upload.Data.size();
+		g_queue.push_back(std::move(upload));
+	}
+
+	// Stages and issues one segment's worth. With wait the segment's fence is
+	// waited on, otherwise a busy segment means nothing is sent this frame.
+	size_t pump(bool wait)
+	{
+		if (g_queue.empty())
+			return 0;
+
+		GLsync fence = g_fences[g_segment];
+		if (fence)
+		{
+			GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while (wait && result == GL_TIMEOUT_EXPIRED)
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			if (result == GL_TIMEOUT_EXPIRED)
+				return 0;
+			glDeleteSync(fence);
+			g_fences[g_segment] = 0;
+		}
+
+		TRACE_ZONE("TextureUploads::Pump");
+		size_t base = g_segment * g_frameBytes;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_staging->ID());
+		// The fence says the GPU is done with this part, nothing to synchronize with
+		unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, base, g_frameBytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (!mapped)
+		{
+			std::cout << "ERROR::TEXUPLOAD: Mapping the staging buffer failed\n";
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return 0;
+		}
+
+		// Copy whole rows until the segment is full
+		g_slices.clear();
+		size_t used = 0;
+		for (Upload& upload : g_queue)
+		{
+			size_t offset = (used + SLICE_ALIGNMENT - 1) / SLICE_ALIGNMENT * SLICE_ALIGNMENT;
+			if (offset >= g_frameBytes)
+				break;
+			GLsizei rows = (GLsizei)((g_frameBytes - offset) / upload.RowBytes);
+			if (rows > upload.Rows - upload.NextRow)
+				rows = upload.Rows - upload.NextRow;
+			if (rows == 0)
+				break;
+			size_t bytes = rows * upload.RowBytes;
+			memcpy(mapped + offset, upload.Data.data() + upload.NextRow * upload.RowBytes, bytes);
+			Slice slice = { &upload, upload.NextRow, rows, base + offset, upload.NextRow + rows == upload.Rows };
+			g_slices.push_back(slice);
+			upload.NextRow += rows;
+			used = offset + bytes;
+			if (!slice.Last)
+				break;
+		}
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		GLint alignment;
+		GLint bound;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		size_t sent = 0;
+		for (const Slice& slice : g_slices)
+		{
+			const Upload& upload = *slice.Source;
+			GLint y = slice.FirstRow * upload.RowHeight;
+			GLsizei height = slice.Rows * upload.RowHeight;
+			if (y + height > upload.Height)
+				height = upload.Height - y;
+			size_t bytes = slice.Rows * upload.RowBytes;
+			glBindTexture(GL_TEXTURE_2D, upload.Texture);
+			if (upload.Compressed)
+				glCompressedTexSubImage2D(GL_TEXTURE_2D, upload.Level, 0, y, upload.Width, height, upload.Format,
+					(GLsizei)bytes, (const void*)slice.Offset);
+			else
+				glTexSubImage2D(GL_TEXTURE_2D, upload.Level, 0, y, upload.Width, height, upload.Format,
+					GL_UNSIGNED_BYTE, (const void*)slice.Offset);
+			if (slice.Last && upload.GenerateMipmap)
+				glGenerateMipmap(GL_TEXTURE_2D);
+			sent += bytes;
+		}
+		glBindTexture(GL_TEXTURE_2D, bound);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+		// Client pointers passed to glTexImage2D elsewhere would be read as offsets otherwise
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		g_fences[g_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		g_segment = (g_segment + 1) % TextureUploads::SEGMENTS;
+
+		// Completed uploads are always at the front, at most the last slice is partial
+		while (!g_queue.empty() && g_queue.front().NextRow == g_queue.front().Rows)
+			g_queue.pop_front();
+		g_pendingBytes -= sent;
+		return sent;
+	}
+}
+
+void TextureUploads::Init(size_t frameBytes)
+{
+	g_frameBytes = frameBytes;
+	g_segment = 0;
+	g_staging = new GLBuffer(GLBuffer::Create("TextureUploads staging"));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_staging->ID());
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, g_frameBytes * SEGMENTS, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	g_staging->SetBytes(g_frameBytes * SEGMENTS);
+	g_slices.reserve(64);
+}
+
+void TextureUploads::Shutdown()
+{
+	for (GLuint i = 0; i < SEGMENTS; ++i)
+	{
+		if (g_fences[i])
+			glDeleteSync(g_fences[i]);
+		g_fences[i] = 0;
+	}
+	g_queue.clear();
+	g_pendingBytes = 0;
+	delete g_staging;
+	g_staging = nullptr;
+}
+
+void TextureUploads::Queue(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum format,
+	const void* pixels, size_t bytes, bool generateMipmap)
+{
+	Upload upload;
+	upload.Texture = texture;
+	upload.Level = level;
+	upload.Width = width;
+	upload.Height = height;
+	upload.Format = format;
+	upload.Compressed = false;
+	upload.GenerateMipmap = generateMipmap;
+	upload.RowBytes = (size_t)width * components(format);
+	upload.RowHeight = 1;
+	upload.Rows = height;
+	upload.NextRow = 0;
+	enqueue(upload, pixels, bytes);
+}
+
+void TextureUploads::QueueCompressed(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum internalFormat,
+	const void* data, size_t bytes)
+{
+	Upload upload;
+	upload.Texture = texture;
+	upload.Level = level;
+	upload.Width = width;
+	upload.Height = height;
+	upload.Format = internalFormat;
+	upload.Compressed = true;
+	upload.GenerateMipmap = false;
+	upload.RowBytes = (size_t)((width + 3) / 4) * GLObjects::BytesPerBlock(internalFormat);
+	upload.RowHeight = 4;
+	upload.Rows = (height + 3) / 4;
+	upload.NextRow = 0;
+	enqueue(upload, data, bytes);
+}
+
+size_t TextureUploads::Pump()
+{
+	return pump(false);
+}
+
+void TextureUploads::Flush()
+{
+	TRACE_ZONE("TextureUploads::Flush");
+	while (!g_queue.empty())
+		pump(true);
+}
+
+void TextureUploads::Cancel(GLuint texture)
+{
+	for (auto upload = g_queue.begin(); upload != g_queue.end();)
+	{
+		if (upload->Texture == texture)
+		{
+			g_pendingBytes -= (upload->Rows - upload->NextRow) * upload->RowBytes;
+			upload = g_queue.erase(upload);
+		}
+		else
+		{
+			++upload;
+		}
+	}
+}
+
+bool TextureUploads::Pending(GLuint texture)
+{
+	for (const Upload& upload : g_queue)
+	{
+		if (upload.Texture == texture)
+			return true;
+	}
+	return false;
+}
+
+size_t TextureUploads::PendingBytes()
+{
+	return g_pendingBytes;
+}
+
+size_t TextureUploads::ImageBytes(GLsizei width, GLsizei height, GLenum format)
+{
+	return (size_t)width * height * components(format);
+}
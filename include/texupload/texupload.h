@@ -0,0 +1,65 @@
+#ifndef _texupload_HG_
+#define _texupload_HG_
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Queue of texture uploads that are copied to the GPU a slice at a time
+// through a pixel unpack buffer, instead of glTexImage2D reading client
+// memory while the frame waits.
+//
+//	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+//	TextureUploads::Queue(id, 0, w, h, GL_RGBA, pixels, w * h * 4);
+//	...
+//	TextureUploads::Pump();		// once a frame
+//
+// Queue copies the pixels and returns. Each Pump copies whole rows, up to
+// the per frame budget, into one part of the staging buffer and issues
+// glTexSubImage2D from it, so the driver's copy is a GPU transfer. Like
+// StreamBuffer the staging buffer is split into SEGMENTS parts with a fence
+// each; a part the GPU is still reading is skipped until a later frame
+// rather than waited on. A large texture therefore arrives over several
+// frames, until then its contents are undefined (Pending is true).
+//
+// Without Init every Queue uploads straight away, the old behaviour.
+class TextureUploads
+{
+public:
+	static const GLuint SEGMENTS = 3;
+	static const size_t DEFAULT_FRAME_BYTES = 4 * 1024 * 1024;
+
+	// Creates the staging buffer, frameBytes is the most one Pump copies.
+	// Needs a current context.
+	static void Init(size_t frameBytes = DEFAULT_FRAME_BYTES);
+	// Drops anything still queued and deletes the staging buffer
+	static void Shutdown();
+
+	// Uploads width x height GL_UNSIGNED_BYTE pixels of format (GL_RED, GL_RG,
+	// GL_RGB or GL_RGBA, rows tightly packed) into level of a 2D texture whose
+	// storage already exists. generateMipmap rebuilds the chain after the last row.
+	static void Queue(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum format,
+		const void* pixels, size_t bytes, bool generateMipmap = false);
+	// Same for one level of a block compressed texture (see GLObjects::BytesPerBlock)
+	static void QueueCompressed(GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum internalFormat,
+		const void* data, size_t bytes);
+
+	// Copies and issues up to the frame budget, returns the bytes sent
+	static size_t Pump();
+	// Uploads everything queued, waiting on the GPU when the staging buffer is
+	// busy. For loading screens, where the first frame needs the textures.
+	static void Flush();
+	// Forgets what is queued for a texture that is being deleted or re-specified
+	static void Cancel(GLuint texture);
+
+	static bool Pending(GLuint texture);
+	static size_t PendingBytes();
+
+	// Size of tightly packed GL_UNSIGNED_BYTE pixels in one of the formats above
+	static size_t ImageBytes(GLsizei width, GLsizei height, GLenum format);
+
+private:
+	TextureUploads() {}
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// ~1.5 MB per thread, a few seconds of gameplay even when running uncapped
+	const uint32_t EVENTS_PER_THREAD = 1 << 16;
+
+	struct ThreadBuffer
+	{
+		uint32_t				ThreadID;
+		const char*				ThreadName;
+		// Only the owning thread writes Count; the release store publishes the
+		// event it just filled in to whoever dumps the buffer.
+		std::atomic<uint32_t>	Count;
+		std::atomic<uint32_t>	Dropped;
+		Trace::Event			Events[EVENTS_PER_THREAD];
+	};
+
+	// Buffers are registered once per thread and never freed so a dump can
+	// still read them after their thread has exited.
+	std::mutex					g_registryMutex;
+	std::vector<ThreadBuffer*>	g_registry;
+
+	const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+	ThreadBuffer* threadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			buffer = new ThreadBuffer();
+			buffer->ThreadName = nullptr;
+			buffer->Count.store(0);
+			buffer->Dropped.store(0);
+
+			std::lock_guard<std::mutex> lock(g_registryMutex);
+			buffer->ThreadID = (uint32_t)g_registry.size() + 1;
+			g_registry.push_back(buffer);
+		}
+		return buffer;
+	}
+
+	void writeEscaped(FILE* file, const char* text)
+	{
+		for (const char* c = text; *c; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+				fputc('\\', file);
+			fputc(*c, file);
+		}
+	}
+}
+
+std::atomic<bool> Trace::s_capturing(true);
+
+uint64_t Trace::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+void Trace::Record(const char* name, uint64_t start, uint64_t end)
+{
+	if (!s_capturing.load(std::memory_order_relaxed))
+		return;
+
+	ThreadBuffer* buffer = threadBuffer();
+	uint32_t count = buffer->Count.load(std::memory_order_relaxed);
+	if (count >= EVENTS_PER_THREAD)
+	{
+		buffer->Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Trace::Event& event = buffer->Events[count];
+	event.Name = name;
+	event.Start = start;
+	event.End = end;
+	buffer->Count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const char* name)
+{
+	threadBuffer()->ThreadName = name;
+}
+
+void Trace::Start()
+{
+	s_capturing.store(true);
+}
+
+void Trace::Stop()
+{
+	s_capturing.store(false);
+}
+
+bool Trace::IsCapturing()
+{
+	return s_capturing.load();
+}
+
+void Trace::Clear()
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	for (ThreadBuffer* buffer : g_registry)
+	{
+		buffer->Count.store(0);
+		buffer->Dropped.store(0);
+	}
+}
+
+bool Trace::Dump(const char* path)
+{
+	FILE* file = nullptr;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path, "w") != 0)
+		file = nullptr;
+#else
+	file = fopen(path, "w");
+#endif
+	if (!file)
+	{
+		std::cout << "ERROR::TRACE: Could not open " << path << " for writing\n";
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+
+	size_t written = 0;
+	uint32_t dropped = 0;
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+	for (ThreadBuffer* buffer : g_registry)
+	{
+		if (buffer->ThreadName)
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+				written ? ",\n" : "", buffer->ThreadID);
+			writeEscaped(file, buffer->ThreadName);
+			fputs("\"}}", file);
+			++written;
+		}
+
+		uint32_t count = buffer->Count.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const Trace::Event& event = buffer->Events[i];
+			// Chrome wants microseconds, keep the sub-microsecond part as a fraction
+			fprintf(file, "%s{\"name\":\"", written ? ",\n" : "");
+			writeEscaped(file, event.Name);
+			fprintf(file, "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				buffer->ThreadID, event.Start / 1000.0, (event.End - event.Start) / 1000.0);
+			++written;
+		}
+		dropped += buffer->Dropped.load();
+	}
+	fputs("\n]}\n", file);
+	fclose(file);
+
+	std::cout << "TRACE: Wrote " << written << " events to " << path;
+	if (dropped > 0)
+		std::cout << " (" << dropped << " zones dropped, buffers were full)";
+	std::cout << "\n";
+	return true;
+}
@@ -0,0 +1,83 @@
+#ifndef _trace_HG_
+#define _trace_HG_
+
+#include <atomic>
+#include <cstdint>
+
+// Lightweight CPU trace zones written out in the Chrome trace event format.
+// Add TRACE_ENABLED to the project's preprocessor definitions to compile the
+// zones in, otherwise every TRACE_ macro expands to nothing.
+//
+//	TRACE_ZONE("Game::Update");		// records the enclosing scope
+//	TRACE_DUMP("trace.json");		// load in chrome://tracing or ui.perfetto.dev
+//
+// Each thread writes into its own fixed size buffer so recording never takes
+// a lock. Once a buffer is full further zones on that thread are dropped (and
+// counted) until the capture is cleared.
+class Trace
+{
+public:
+	struct Event
+	{
+		const char* Name;	// must be a string literal (or outlive the dump)
+		uint64_t	Start;	// nanoseconds since the trace epoch
+		uint64_t	End;
+	};
+
+	// Nanoseconds since the first call into the tracer
+	static uint64_t Now();
+	// Appends a complete zone to the calling thread's buffer
+	static void Record(const char* name, uint64_t start, uint64_t end);
+	// Label shown for the calling thread in the viewer
+	static void SetThreadName(const char* name);
+
+	// Capturing is on from startup so loading shows up in the first dump
+	static void Start();
+	static void Stop();
+	static bool IsCapturing();
+	// Throws away everything recorded so far. Only call this while no other
+	// thread is recording.
+	static void Clear();
+	// Writes all recorded zones as Chrome trace JSON
+	static bool Dump(const char* path);
+
+private:
+	Trace() {}
+	static std::atomic<bool> s_capturing;
+};
+
+// Records the time between construction and destruction as one zone
+class TraceZone
+{
+public:
+	explicit TraceZone(const char* name)
+		: m_name(name)
+		, m_start(Trace::Now())
+	{
+	}
+	~TraceZone()
+	{
+		Trace::Record(m_name, m_start, Trace::Now());
+	}
+
+	TraceZone(const TraceZone&) = delete;
+	TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+	const char* m_name;
+	uint64_t	m_start;
+};
+
+#ifdef TRACE_ENABLED
+	#define TRACE_CONCAT_(a, b) a##b
+	#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+	#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone_, __LINE__)(name)
+	#define TRACE_THREAD_NAME(name) Trace::SetThreadName(name)
+	#define TRACE_DUMP(path) Trace::Dump(path)
+#else
+	#define TRACE_ZONE(name) ((void)0)
+	#define TRACE_THREAD_NAME(name) ((void)0)
+	#define TRACE_DUMP(path) ((void)0)
+#endif
+
+#endif
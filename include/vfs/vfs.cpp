@@ -0,0 +1,299 @@
+#include "vfs.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	struct MountedPack
+	{
+		std::string			Name;
+		void*				Base;
+		size_t				Size;
+		const PackEntry*	Entries;
+		const char*			Paths;
+		uint32_t			EntryCount;
+	};
+
+	std::vector<MountedPack> g_packs;
+
+	// What an empty file views, mapping zero bytes isn't allowed
+	const unsigned char EMPTY_FILE[1] = { 0 };
+
+	// Maps a whole file read-only. False if it can't be opened, an empty file
+	// succeeds with a null base.
+	bool mapFile(const char* path, bool sequential, void*& base, size_t& size)
+	{
+		base = nullptr;
+		size = 0;
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize))
+		{
+			CloseHandle(file);
+			return false;
+		}
+		size = (size_t)fileSize.QuadPart;
+		if (size > 0)
+		{
+			// The view keeps the file open, the handles can go
+			HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping)
+			{
+				base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file);
+#else
+		int file = open(path, O_RDONLY);
+		if (file < 0)
+			return false;
+		struct stat status;
+		if (fstat(file, &status) != 0)
+		{
+			close(file);
+			return false;
+		}
+		size = (size_t)status.st_size;
+		if (size > 0)
+		{
+			void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+			if (mapped != MAP_FAILED)
+			{
+				base = mapped;
+				// Ask for the whole file up front, one sequential read instead of a fault per page
+				if (sequential)
+					madvise(base, size, MADV_WILLNEED);
+			}
+		}
+		close(file);
+#endif
+		return size == 0 || base != nullptr;
+	}
+
+	void unmapFile(void* base, size_t size)
+	{
+		if (!base)
+			return;
+#ifdef _WIN32
+		(void)size;
+		UnmapViewOfFile(base);
+#else
+		munmap(base, size);
+#endif
+	}
+
+	int comparePath(const MountedPack& pack, const PackEntry& entry, const std::string& path)
+	{
+		size_t length = entry.PathLength < path.size() ? entry.PathLength : path.size();
+		int order = memcmp(pack.Paths + entry.PathOffset, path.data(), length);
+		if (order != 0)
+			return order;
+		if (entry.PathLength == path.size())
+			return 0;
+		return entry.PathLength < path.size() ? -1 : 1;
+	}
+
+	const PackEntry* findEntry(const MountedPack& pack, const std::string& path)
+	{
+		uint32_t low = 0;
+		uint32_t high = pack.EntryCount;
+		while (low < high)
+		{
+			uint32_t middle = low + (high - low) / 2;
+			int order = comparePath(pack, pack.Entries[middle], path);
+			if (order == 0)
+				return &pack.Entries[middle];
+			if (order < 0)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		return nullptr;
+	}
+
+	bool validPack(void* base, size_t size, MountedPack& pack)
+	{
+		if (size < sizeof(PackHeader))
+			return false;
+		const PackHeader* header = (const PackHeader*)base;
+		if (memcmp(header->Magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header->Version != PACK_VERSION)
+			return false;
+		uint64_t entriesEnd = header->TocOffset + (uint64_t)header->EntryCount * sizeof(PackEntry);
+		if (header->TocOffset > size || entriesEnd > size)
+			return false;
+
+		pack.Base = base;
+		pack.Size = size;
+		pack.Entries = (const PackEntry*)((const unsigned char*)base + header->TocOffset);
+		pack.Paths = (const char*)base + entriesEnd;
+		pack.EntryCount = header->EntryCount;
+		uint64_t pathBytes = size - entriesEnd;
+		for (uint32_t i = 0; i < pack.EntryCount; ++i)
+		{
+			const PackEntry& entry = pack.Entries[i];
+			if (entry.Offset + entry.Size > header->TocOffset || (uint64_t)entry.PathOffset + entry.PathLength > pathBytes)
+				return false;
+		}
+		return true;
+	}
+}
+
+VfsFile::~VfsFile()
+{
+	unmapFile(this->m_mapping, this->m_size);
+}
+
+VfsFile::VfsFile(VfsFile&& other)
+	: m_data(other.m_data)
+	, m_size(other.m_size)
+	, m_mapping(other.m_mapping)
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_mapping = nullptr;
+}
+
+VfsFile& VfsFile::operator=(VfsFile&& other)
+{
+	if (this != &other)
+	{
+		unmapFile(this->m_mapping, this->m_size);
+		this->m_data = other.m_data;
+		this->m_size = other.m_size;
+		this->m_mapping = other.m_mapping;
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_mapping = nullptr;
+	}
+	return *this;
+}
+
+bool Vfs::Mount(const char* packPath)
+{
+	void* base;
+	size_t size;
+	if (!mapFile(packPath, true, base, size))
+		return false;
+
+	MountedPack pack;
+	pack.Name = packPath;
+	if (!validPack(base, size, pack))
+	{
+		std::cout << "ERROR::VFS: " << packPath << " is not a valid pack\n";
+		unmapFile(base, size);
+		return false;
+	}
+	g_packs.push_back(pack);
+	return true;
+}
+
+void Vfs::UnmountAll()
+{
+	for (const MountedPack& pack : g_packs)
+		unmapFile(pack.Base, pack.Size);
+	g_packs.clear();
+}
+
+VfsFile Vfs::Open(const char* path)
+{
+	std::string normalized = Normalize(path);
+	for (auto pack = g_packs.rbegin(); pack != g_packs.rend(); ++pack)
+	{
+		const PackEntry* entry = findEntry(*pack, normalized);
+		if (entry)
+		{
+			const unsigned char* data = (const unsigned char*)pack->Base + entry->Offset;
+			return VfsFile(entry->Size > 0 ? data : EMPTY_FILE, (size_t)entry->Size);
+		}
+	}
+
+	void* base;
+	size_t size;
+	if (!mapFile(normalized.c_str(), false, base, size))
+		return VfsFile();
+	if (size == 0)
+		return VfsFile(EMPTY_FILE, 0);
+	VfsFile file((const unsigned char*)base, size);
+	file.m_mapping = base;
+	return file;
+}
+
+bool Vfs::Exists(const char* path)
+{
+	std::string normalized = Normalize(path);
+	for (const MountedPack& pack : g_packs)
+	{
+		if (findEntry(pack, normalized))
+			return true;
+	}
+	FILE* file = nullptr;
+#ifdef _MSC_VER
+	if (fopen_s(&file, normalized.c_str(), "rb") != 0)
+		return false;
+#else
+	file = fopen(normalized.c_str(), "rb");
+#endif
+	if (!file)
+		return false;
+	fclose(file);
+	return true;
+}
+
+std::string Vfs::Normalize(const char* path)
+{
+	std::vector<std::string> segments;
+	bool absolute = path[0] == '/' || path[0] == '\\';
+	std::string segment;
+	for (const char* c = path; ; ++c)
+	{
+		if (*c == '/' || *c == '\\' || *c == '\0')
+		{
+			if (segment == "..")
+			{
+				if (!segments.empty() && segments.back() != "..")
+					segments.pop_back();
+				else if (!absolute)
+					segments.push_back(segment);
+			}
+			else if (!segment.empty() && segment != ".")
+			{
+				segments.push_back(segment);
+			}
+			segment.clear();
+			if (*c == '\0')
+				break;
+		}
+		else
+		{
+			segment += *c;
+		}
+	}
+
+	std::string normalized = absolute ? "/" : "";
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		if (i > 0)
+			normalized += '/';
+		normalized += segments[i];
+	}
+	return normalized;
+}
@@ -0,0 +1,89 @@
+#ifndef _vfs_HG_
+#define _vfs_HG_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Pack file layout, little endian, written by tools/pack_assets.py:
+//
+//	PackHeader
+//	file data, each file starting on a PACK_ALIGNMENT boundary
+//	PackEntry[EntryCount] at TocOffset, sorted by path
+//	path strings, PackEntry::PathOffset counts from the end of the entries
+//
+// Paths are relative to the directory that was packed and use '/'.
+const char PACK_MAGIC[4] = { 'P', 'A', 'C', 'K' };
+const uint32_t PACK_VERSION = 1;
+const uint32_t PACK_ALIGNMENT = 16;
+
+struct PackHeader
+{
+	char		Magic[4];
+	uint32_t	Version;
+	uint32_t	EntryCount;
+	uint32_t	Reserved;
+	uint64_t	TocOffset;
+};
+
+struct PackEntry
+{
+	uint64_t	Offset;
+	uint64_t	Size;
+	uint32_t	PathOffset;
+	uint32_t	PathLength;
+};
+
+// A read-only view of one file. Views into a pack point straight at the
+// mapped pack (nothing is copied) and stay valid until the pack is unmounted.
+// A loose file gets its own mapping, owned by the view. Move-only.
+class VfsFile
+{
+public:
+	VfsFile() : m_data(nullptr), m_size(0), m_mapping(nullptr) {}
+	// Borrows memory that outlives the view, e.g. an embedded array
+	VfsFile(const unsigned char* data, size_t size) : m_data(data), m_size(size), m_mapping(nullptr) {}
+	~VfsFile();
+
+	VfsFile(VfsFile&& other);
+	VfsFile& operator=(VfsFile&& other);
+	VfsFile(const VfsFile&) = delete;
+	VfsFile& operator=(const VfsFile&) = delete;
+
+	const unsigned char* Data() const { return this->m_data; }
+	size_t Size() const { return this->m_size; }
+	explicit operator bool() const { return this->m_data != nullptr; }
+
+private:
+	friend class Vfs;
+
+	const unsigned char*	m_data;
+	size_t					m_size;
+	void*					m_mapping;	// base of an owned mapping, null for views into a pack
+};
+
+// Virtual file system over memory mapped pack files. Lookups check the
+// mounted packs (the last one mounted first) and then fall back to mapping the
+// loose file, so everything works unpacked during development.
+//
+//	Vfs::Mount("opengl.pak");
+//	VfsFile file = Vfs::Open("models/rock/rock.obj");
+//	stbi_load_from_memory(file.Data(), (int)file.Size(), ...);
+class Vfs
+{
+public:
+	// Maps a pack, false (and nothing mounted) if it doesn't exist or isn't a valid pack
+	static bool Mount(const char* packPath);
+	static void UnmountAll();
+
+	static VfsFile Open(const char* path);
+	static bool Exists(const char* path);
+
+	// Forward slashes with "." and ".." segments resolved, the form pack paths are stored in
+	static std::string Normalize(const char* path);
+
+private:
+	Vfs() {}
+};
+
+#endif
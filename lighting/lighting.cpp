@@ -8,6 +8,11 @@
 #include "shader_m.hpp"
 #include "camera.hpp"
 
+#include <headless/headless.h>
+#include <memtrack/memtrack.h>
+
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 // Callback functions
@@ -34,40 +39,62 @@ float lastFrame = 0.0f;
 // Lighting 
 glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 
-int main(void) 
+int main(int argc, char** argv) 
 {
-	// glfw init and config
-	// --------------------
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// --headless <frames> renders offscreen with no window and prints frame timings
+	unsigned int headlessFrames = 0;
+	if (argc == 3 && strcmp(argv[1], "--headless") == 0 && atoi(argv[2]) > 0)
+		headlessFrames = (unsigned int)atoi(argv[2]);
+	else if (argc > 1)
+	{
+		std::cout << "Usage: " << argv[0] << " [--headless <frames>]\n";
+		return EXIT_FAILURE;
+	}
+
+	GLFWwindow* window = NULL;
+	GLADloadproc loader = NULL;
+	if (headlessFrames)
+	{
+		if (!Headless::Create(SCR_WIDTH, SCR_HEIGHT, headlessFrames))
+			return EXIT_FAILURE;
+		loader = Headless::Loader();
+	}
+	else
+	{
+		// glfw init and config
+		// --------------------
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
 
-	// glfw window creation
-	// --------------------
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Lighting", NULL, NULL);
-	if (!window) 
-	{
-		std::cout << "Failed to create GLFW window\n";
-		glfwTerminate();
-		return EXIT_FAILURE;
+		// glfw window creation
+		// --------------------
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Lighting", NULL, NULL);
+		if (!window) 
+		{
+			std::cout << "Failed to create GLFW window\n";
+			glfwTerminate();
+			return EXIT_FAILURE;
+		}
+		glfwMakeContextCurrent(window);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		glfwSetCursorPosCallback(window, mouse_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+
+		// Tell GLFW to capture our mouse
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		loader = (GLADloadproc)glfwGetProcAddress;
 	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-
-	// Tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	// glad: load all OpenGL function pointers
 	// ---------------------------------------
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) 
+	if (!gladLoadGLLoader(loader)) 
 	{
 		std::cout << "Failed to initialize GLAD\n";
 		return EXIT_FAILURE;
@@ -158,17 +185,21 @@ int main(void)
 
 	// Render loop
 	// -----------
-	while (!glfwWindowShouldClose(window)) 
+	while (headlessFrames ? Headless::Running() : !glfwWindowShouldClose(window)) 
 	{
 		// Per-frame time logic
 		// --------------------
-		float currentFrame = (float)glfwGetTime();
+		if (headlessFrames)
+			Headless::BeginFrame();
+		double time = headlessFrames ? Headless::Time() : glfwGetTime();
+		float currentFrame = (float)time;
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// Input 
 		// -----
-		process_input(window);
+		if (!headlessFrames)
+			process_input(window);
 
 		// Render
 		// ------
@@ -182,9 +213,9 @@ int main(void)
 
 		// Light properties
 		glm::vec3 lightColor;
-		lightColor.x = (float)sin(glfwGetTime() * 2.0f);
-		lightColor.y = (float)sin(glfwGetTime() * 0.7f);
-		lightColor.z = (float)sin(glfwGetTime() * 1.3f);
+		lightColor.x = (float)sin(time * 2.0f);
+		lightColor.y = (float)sin(time * 0.7f);
+		lightColor.z = (float)sin(time * 1.3f);
 		glm::vec3 diffuseColor = lightColor * glm::vec3(0.5f); // decrease the influence
 		glm::vec3 ambientColor = diffuseColor * glm::vec3(0.2f); // low influence
 		lightingShader.setVec3("light.ambient", ambientColor);
@@ -192,7 +223,7 @@ int main(void)
 		lightingShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
 
 		// Move the light position over time
-		lightPos.x = 1.0f + (float)sin(glfwGetTime()) * 2.0f;
+		lightPos.x = 1.0f + (float)sin(time) * 2.0f;
 		//lightPos.y = (float)sin(glfwGetTime() / 2.0f) * 1.0f;
 
 		// Material properties
@@ -230,14 +261,26 @@ int main(void)
 
 		// swap buffers and poll IO events (key pressed/released, mouse moved etc.)
 		// ------------------------------------------------------------------------
+		if (headlessFrames)
+		{
+			Headless::EndFrame();
+			continue;
+		}
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
+	Headless::Report();
 	// de-allocate all resources once they've outlived their purpose
 	// -------------------------------------------------------------
 	glDeleteVertexArrays(1, &cubeVAO);
 	glDeleteVertexArrays(1, &lightVAO);
 	glDeleteBuffers(1, &VBO);
+	MEMTRACK_REPORT("at exit");
+	if (headlessFrames)
+	{
+		Headless::Destroy();
+		return 0;
+	}
 
 	// terminate, clearing all previously allocated GLFW resources
 	// -----------------------------------------------------------
@@ -1,5 +1,8 @@
 #include "shader_m.hpp"
 
+#include <shadercache/shadercache.h>
+
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -47,38 +50,55 @@ Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const char*
 
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
-	// Compile the shaders
+	const char* gShaderCode = geometryPath != nullptr ? geometryCode.c_str() : nullptr;
+	// Shader program, loaded straight from the binary cache when these sources were linked before
+	ID = glCreateProgram();
+	const char* sources[] = { vShaderCode, fShaderCode, gShaderCode };
+	uint64_t cacheKey = ShaderCache::Key(sources, 3);
+	if (ShaderCache::Load(ID, cacheKey))
+		return;
+
+	// Compile the shaders, nothing is checked until the program is linked so the
+	// driver can work on all stages at once
 	unsigned int vertex, fragment;
 	// Vertex shader
 	vertex = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vertex, 1, &vShaderCode, NULL);
 	glCompileShader(vertex);
-	checkCompileErrors(vertex, "VERTEX");
 	// Fragment shader
 	fragment = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(fragment, 1, &fShaderCode, NULL);
 	glCompileShader(fragment);
-	checkCompileErrors(fragment, "FRAGMENT");
 	// Geometry shader given? Compile the geometry shader
 	unsigned int geometry;
-	if (geometryPath != nullptr) 
+	if (geometryPath != nullptr)
 	{
-		const char* gShaderCode = geometryCode.c_str();
 		geometry = glCreateShader(GL_GEOMETRY_SHADER);
 		glShaderSource(geometry, 1, &gShaderCode, NULL);
 		glCompileShader(geometry);
-		checkCompileErrors(geometry, "GEOMETRY");
 	}
-	// Shader program
-	ID = glCreateProgram();
 	glAttachShader(ID, vertex);
 	glAttachShader(ID, fragment);
-	if (geometryPath != nullptr) 
+	if (geometryPath != nullptr)
 	{
 		glAttachShader(ID, geometry);
 	}
+	if (ShaderCache::Enabled())
+	{
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(ID);
-	checkCompileErrors(ID, "PROGRAM");
+
+	bool compiled = checkCompileErrors(vertex, "VERTEX");
+	compiled = checkCompileErrors(fragment, "FRAGMENT") && compiled;
+	if (geometryPath != nullptr)
+	{
+		compiled = checkCompileErrors(geometry, "GEOMETRY") && compiled;
+	}
+	if (checkCompileErrors(ID, "PROGRAM") && compiled)
+	{
+		ShaderCache::Store(ID, cacheKey);
+	}
 	// Delete the shaders as they're linked into our program now and no longer necessary
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
@@ -151,7 +171,7 @@ void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 }
 
 // Check shader compilation/linking errors
-void Shader::checkCompileErrors(unsigned int shader, std::string type) 
+bool Shader::checkCompileErrors(unsigned int shader, std::string type) 
 {
 	int success;
 	char infoLog[1024];
@@ -173,4 +193,5 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
 			std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- ---------------------------------------------\n";
 		}
 	}
+	return success != 0;
 }
\ No newline at end of file
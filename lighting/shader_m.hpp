@@ -25,5 +25,6 @@ public:
 	//void setMat3(const std::string &name, const glm::mat3 &mat) const;
 	void setMat4(const std::string &name, const glm::mat4 &mat) const;
 private:
-	void checkCompileErrors(unsigned int shader, std::string type);
+	// Prints the log and returns false if compiling or linking failed
+	bool checkCompileErrors(unsigned int shader, std::string type);
 };
\ No newline at end of file
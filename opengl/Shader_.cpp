@@ -1,80 +1,79 @@
 #include "shader_.hpp"
 
 
+#include <shadercache/shadercache.h>
+#include <vfs/vfs.h>
+
+#include <cstdint>
 #include <iostream>
-#include <sstream>
-#include <fstream>
 
-Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const char* geometryPath) {
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::string geometryCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	std::ifstream gShaderFile;
+namespace {
+	std::string contents(const VfsFile& file) {
+		return file ? std::string((const char*)file.Data(), file.Size()) : std::string();
+	}
+}
 
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try {
-		// Open files
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-		// Read file's buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// Close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// Convert streams into strings
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-		// if Geometry shader path is present, also load geometry shader
-		if (geometryPath != nullptr) {
-			gShaderFile.open(geometryPath);
-			std::stringstream gShaderStream;
-			gShaderStream << gShaderFile.rdbuf();
-			gShaderFile.close();
-			geometryCode = gShaderStream.str();
-		}
+Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const char* geometryPath) {
+	// Read through the Vfs, from the mounted pack or the loose files
+	VfsFile vShaderFile = Vfs::Open(vertexPath);
+	VfsFile fShaderFile = Vfs::Open(fragmentPath);
+	VfsFile gShaderFile;
+	if (geometryPath != nullptr) {
+		gShaderFile = Vfs::Open(geometryPath);
 	}
-	catch (std::ifstream::failure e) {
+	if (!vShaderFile || !fShaderFile || (geometryPath != nullptr && !gShaderFile)) {
 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n";
 	}
+	std::string vertexCode = contents(vShaderFile);
+	std::string fragmentCode = contents(fShaderFile);
+	std::string geometryCode = contents(gShaderFile);
 
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
-	// Compile the shaders
+	const char* gShaderCode = geometryPath != nullptr ? geometryCode.c_str() : nullptr;
+	// Shader program, loaded straight from the binary cache when these sources were linked before
+	ID = glCreateProgram();
+	const char* sources[] = { vShaderCode, fShaderCode, gShaderCode };
+	uint64_t cacheKey = ShaderCache::Key(sources, 3);
+	if (ShaderCache::Load(ID, cacheKey))
+		return;
+
+	// Compile the shaders, nothing is checked until the program is linked so the
+	// driver can work on all stages at once
 	unsigned int vertex, fragment;
 	// Vertex shader
 	vertex = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vertex, 1, &vShaderCode, NULL);
 	glCompileShader(vertex);
-	checkCompileErrors(vertex, "VERTEX");
 	// Fragment shader
 	fragment = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(fragment, 1, &fShaderCode, NULL);
 	glCompileShader(fragment);
-	checkCompileErrors(fragment, "FRAGMENT");
 	// Geometry shader given? Compile the geometry shader
 	unsigned int geometry;
 	if (geometryPath != nullptr) {
-		const char* gShaderCode = geometryCode.c_str();
 		geometry = glCreateShader(GL_GEOMETRY_SHADER);
 		glShaderSource(geometry, 1, &gShaderCode, NULL);
 		glCompileShader(geometry);
-		checkCompileErrors(geometry, "GEOMETRY");
 	}
-	// Shader program
-	ID = glCreateProgram();
 	glAttachShader(ID, vertex);
 	glAttachShader(ID, fragment);
 	if (geometryPath != nullptr) {
 		glAttachShader(ID, geometry);
 	}
+	if (ShaderCache::Enabled()) {
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(ID);
-	checkCompileErrors(ID, "PROGRAM");
+
+	bool compiled = checkCompileErrors(vertex, "VERTEX");
+	compiled = checkCompileErrors(fragment, "FRAGMENT") && compiled;
+	if (geometryPath != nullptr) {
+		compiled = checkCompileErrors(geometry, "GEOMETRY") && compiled;
+	}
+	if (checkCompileErrors(ID, "PROGRAM") && compiled) {
+		ShaderCache::Store(ID, cacheKey);
+	}
 	// Delete the shaders as they're linked into our program now and no longer necessary
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
@@ -138,7 +137,7 @@ void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
 }
 
 // Check shader compilation/linking errors
-void Shader::checkCompileErrors(unsigned int shader, std::string type) {
+bool Shader::checkCompileErrors(unsigned int shader, std::string type) {
 	int success;
 	char infoLog[1024];
 	if (type != "PROGRAM") {
@@ -155,4 +154,5 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type) {
 			std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- ---------------------------------------------\n";
 		}
 	}
+	return success != 0;
 }
\ No newline at end of file
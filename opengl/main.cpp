@@ -14,7 +14,16 @@
 #include "camera.hpp"
 #include "model.hpp"
 
+#include <globject/globject.h>
+#include <headless/headless.h>
+#include <memtrack/memtrack.h>
+#include <texupload/texupload.h>
+#include <vfs/vfs.h>
+#include <trace/trace.h>
 
+
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -36,29 +45,48 @@ bool firstMouse = true;
 float deltaTime = 0.0f;	// Time between current frame and last frame
 float lastFrame = 0.0f;
 
-int main() {
-	// glfw: initialize and configure
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	// glfw window creation
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-	if (window == NULL) {
-		std::cout << "Failed to create GLFW window\n";
-		glfwTerminate();
+int main(int argc, char** argv) {
+	// --headless <frames> renders offscreen with no window and prints frame timings
+	unsigned int headlessFrames = 0;
+	if (argc == 3 && strcmp(argv[1], "--headless") == 0 && atoi(argv[2]) > 0)
+		headlessFrames = (unsigned int)atoi(argv[2]);
+	else if (argc > 1) {
+		std::cout << "Usage: " << argv[0] << " [--headless <frames>]\n";
 		return -1;
 	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-	// Tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+	GLFWwindow* window = NULL;
+	GLADloadproc loader = NULL;
+	if (headlessFrames) {
+		if (!Headless::Create(SCR_WIDTH, SCR_HEIGHT, headlessFrames))
+			return -1;
+		loader = Headless::Loader();
+	}
+	else {
+		// glfw: initialize and configure
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// glfw window creation
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		if (window == NULL) {
+			std::cout << "Failed to create GLFW window\n";
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		glfwSetCursorPosCallback(window, mouse_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+		// Tell GLFW to capture our mouse
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		loader = (GLADloadproc)glfwGetProcAddress;
+	}
 
 	// Glad: load all OpenGL function pointers
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+	if (!gladLoadGLLoader(loader)) {
 		std::cout << "Failed to initialize GLAD\n";
 		return -1;
 	}
@@ -66,17 +94,30 @@ int main() {
 	// Configure global opengl state
 	glEnable(GL_DEPTH_TEST);
 
+	TRACE_THREAD_NAME("Main");
+
+	// Shaders and models come from the pack when there is one (tools/pack_assets.py
+	// opengl.pak . shader.vert ... models), loose files relative to the working directory otherwise
+	Vfs::Mount("opengl.pak");
+	// Model textures go through the staging ring, see the Flush below
+	TextureUploads::Init();
+
 	// Build and compile our shader program
 	Shader ourShader("shader.vert", "shader.frag", nullptr);
 	Shader rockShader("vertast.glsl", "fragast.glsl", nullptr);
 
-	Model ourModel("D:/Programming/Cpp/$Graphics/opengl/opengl/models/nanosuit.obj");
-	Model rock("D:/Programming/Cpp/$Graphics/opengl/opengl/models/rock/rock.obj");
+	Model ourModel("models/nanosuit.obj");
+	Model rock("models/rock/rock.obj");
+	// The models' textures only have storage until their pixels and mips are
+	// in, the first frame has to get every one of them whole. Anything loaded
+	// later streams in under the per frame budget.
+	TextureUploads::Flush();
 
 	unsigned int amount = 100000;
 	glm::mat4* modelMatrices;
 	modelMatrices = new glm::mat4[amount];
-	srand(glfwGetTime()); 
+	// Same asteroid field every headless run
+	srand(headlessFrames ? 0 : (unsigned int)glfwGetTime());
 	float radius = 150.0;
 	float offset = 25.0f;
 
@@ -107,6 +148,11 @@ int main() {
 	glGenBuffers(1, &buffer);
 	glBindBuffer(GL_ARRAY_BUFFER, buffer);
 	glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
+	GLObjects::Track(GLOBJECT_BUFFER, buffer, "Asteroid instances");
+	GLObjects::SetBytes(GLOBJECT_BUFFER, buffer, amount * sizeof(glm::mat4));
+	// The buffer has its own copy now
+	delete[] modelMatrices;
+	modelMatrices = nullptr;
 
 	for (unsigned int i = 0; i < rock.meshes.size(); i++)
 	{
@@ -131,15 +177,21 @@ int main() {
 	}
 
 	// Render loop
-	while (!glfwWindowShouldClose(window)) {
+	while (headlessFrames ? Headless::Running() : !glfwWindowShouldClose(window)) {
+		TRACE_ZONE("Frame");
 
 		// Per-frame time logic
-		float currentFrame = glfwGetTime();
+		if (headlessFrames)
+			Headless::BeginFrame();
+		float currentFrame = headlessFrames ? (float)Headless::Time() : (float)glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// Input
-		processInput(window);
+		if (!headlessFrames)
+			processInput(window);
+
+		TextureUploads::Pump();
 
 		// Render
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -176,17 +228,32 @@ int main() {
 		for (unsigned int i = 0; i < rock.meshes.size(); i++)
 		{
 			glBindVertexArray(rock.meshes[i].VAO);
-			glDrawElementsInstanced(GL_TRIANGLES, rock.meshes[i].Indices.size(), GL_UNSIGNED_INT, 0, amount);
+			glDrawElementsInstanced(GL_TRIANGLES, rock.meshes[i].IndexCount, GL_UNSIGNED_INT, 0, amount);
 			glBindVertexArray(0);
 		}
 
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		if (headlessFrames) {
+			Headless::EndFrame();
+			continue;
+		}
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
+	Headless::Report();
 
 
+	TRACE_DUMP("opengl_trace.json");
+	TextureUploads::Shutdown();
+	MEMTRACK_REPORT("at exit");
+	GLObjects::Report("at exit");
+
+	Vfs::UnmountAll();
+	if (headlessFrames) {
+		Headless::Destroy();
+		return 0;
+	}
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	glfwTerminate();
 	return 0;
@@ -197,6 +264,16 @@ void processInput(GLFWwindow *window) {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
 
+	// F4 prints the memory reports once per press
+	static bool reportHeld = false;
+	bool reportDown = glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS;
+	if (reportDown && !reportHeld)
+	{
+		MEMTRACK_REPORT("on demand");
+		GLObjects::Report("on demand");
+	}
+	reportHeld = reportDown;
+
 	float cameraSpeed = 2.5 * deltaTime;
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
 		camera.processKeyboard(FORWARD, deltaTime);
@@ -3,10 +3,13 @@
 
 #include "shader_.hpp"
 
+#include <globject/globject.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
 #include <vector>
 
 
@@ -25,20 +28,19 @@ struct Texture {
 };
 
 
+// Vertices and indices are uploaded once and only kept in GPU buffers, the
+// mesh just remembers how many indices to draw.
 class Mesh {
 public:
-	std::vector<Vertex> Vertices;
 	std::vector<Texture> Textures;
-	std::vector<unsigned int> Indices;
+	unsigned int IndexCount;
 	unsigned int VAO;
 
-	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+	Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, std::vector<Texture> textures)
+		: Textures(std::move(textures))
+		, IndexCount((unsigned int)indices.size())
 	{
-		this->Vertices = vertices;
-		this->Indices = indices;
-		this->Textures = textures;
-
-		setupMesh();
+		setupMesh(vertices, indices);
 	}
 	
 	// Rendering
@@ -70,7 +72,7 @@ public:
 
 		// draw mesh
 		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, Indices.size(), GL_UNSIGNED_INT, 0);
+		glDrawElements(GL_TRIANGLES, IndexCount, GL_UNSIGNED_INT, 0);
 		glBindVertexArray(0);
 
 		glActiveTexture(GL_TEXTURE0); // set back to default
@@ -79,11 +81,17 @@ public:
 private:
 	unsigned int VBO, EBO;
 
-	void setupMesh()
+	void setupMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
 	{
 		glGenVertexArrays(1, &VAO);
 		glGenBuffers(1, &VBO);
 		glGenBuffers(1, &EBO);
+		// Meshes live as long as the program, they are only tracked for the VRAM totals
+		GLObjects::Track(GLOBJECT_VERTEX_ARRAY, VAO, "Mesh");
+		GLObjects::Track(GLOBJECT_BUFFER, VBO, "Mesh vertices");
+		GLObjects::Track(GLOBJECT_BUFFER, EBO, "Mesh indices");
+		GLObjects::SetBytes(GLOBJECT_BUFFER, VBO, vertices.size() * sizeof(Vertex));
+		GLObjects::SetBytes(GLOBJECT_BUFFER, EBO, indices.size() * sizeof(unsigned int));
 
 		glBindVertexArray(VAO);
 		//Load data into vertex buffers
@@ -91,10 +99,10 @@ private:
 		// A great thing about structs is that their memory layout is sequential for all its items.
 		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
 		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(Vertex), &Vertices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), &Indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
 		// Set the vertex attribute pointers
 		// vertex positions
@@ -12,6 +12,12 @@
 
 #include "mesh.hpp"
 #include "shader_.hpp"
+#include "vfsiosystem.hpp"
+
+#include <dds/dds.h>
+#include <memtrack/memtrack.h>
+#include <texupload/texupload.h>
+#include <trace/trace.h>
 
 #include <string>
 #include <fstream>
@@ -50,9 +56,16 @@ private:
 	// loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
 	void loadModel(std::string const& path)
 	{
-		// read file via ASSIMP
+		TRACE_ZONE("Model::loadModel");
+		MEMTRACK_SCOPE(MEM_MODEL);
+		// read file via ASSIMP, through the Vfs so packed models load too (the importer owns the handler)
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		importer.SetIOHandler(new VfsIOSystem());
+		const aiScene* scene;
+		{
+			TRACE_ZONE("Assimp::ReadFile");
+			scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		}
 		// check for errors
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 		{
@@ -60,7 +73,8 @@ private:
 			return;
 		}
 		// retrieve the directory path of the filepath
-		directory = path.substr(0, path.find_last_of('/'));
+		std::string normalized = Vfs::Normalize(path.c_str());
+		directory = normalized.substr(0, normalized.find_last_of('/'));
 
 		// process ASSIMP's root node recursively
 		processNode(scene->mRootNode, scene);
@@ -69,6 +83,7 @@ private:
 	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
 	void processNode(aiNode* node, const aiScene* scene)
 	{
+		TRACE_ZONE("Model::processNode");
 		// process each mesh located at the current node
 		for (unsigned int i = 0; i < node->mNumMeshes; i++)
 		{
@@ -87,10 +102,13 @@ private:
 
 	Mesh processMesh(aiMesh* mesh, const aiScene* scene)
 	{
+		TRACE_ZONE("Model::processMesh");
 		// data to fill
 		std::vector<Vertex> vertices;
 		std::vector<unsigned int> indices;
 		std::vector<Texture> textures;
+		vertices.reserve(mesh->mNumVertices);
+		indices.reserve(mesh->mNumFaces * 3);
 
 		// Walk through each of the mesh's vertices
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -161,8 +179,9 @@ private:
 		std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-		// return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures);
+		// return a mesh object created from the extracted mesh data, vertices
+		// and indices are freed once they are uploaded
+		return Mesh(vertices, indices, std::move(textures));
 	}
 
 	// checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -202,14 +221,39 @@ private:
 
 unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma)
 {
+	TRACE_ZONE("TextureFromFile");
+	MEMTRACK_SCOPE(MEM_ASSETS);
 	std::string filename = std::string(path);
 	filename = directory + '/' + filename;
 
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
+	GLObjects::Track(GLOBJECT_TEXTURE, textureID, "Model texture");
+	GLObjects::SetLabel(GLOBJECT_TEXTURE, textureID, filename);
+
+	// Prefer the cooked .dds, its mips are already built and it stays compressed in VRAM
+	VfsFile cooked = Vfs::Open(Dds::CookedPath(filename).c_str());
+	DdsImage image;
+	if (cooked && Dds::Parse(cooked.Data(), cooked.Size(), image) && (!image.Compressed || Dds::CompressedSupported()))
+	{
+		const DdsLevel& top = image.Levels[0];
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		Dds::Upload(image);
+		GLObjects::SetBytes(GLOBJECT_TEXTURE, textureID,
+			GLObjects::TextureBytes(image.InternalFormat, top.Width, top.Height, 1, (GLuint)image.Levels.size()));
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return textureID;
+	}
 
 	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+	VfsFile source = Vfs::Open(filename.c_str());
+	unsigned char* data = source
+		? stbi_load_from_memory(source.Data(), (int)source.Size(), &width, &height, &nrComponents, 0)
+		: nullptr;
 	if (data)
 	{
 		GLenum format;
@@ -220,9 +264,12 @@ unsigned int TextureFromFile(const char* path, const std::string& directory, boo
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
+		// Storage now, the pixels stream in over the next frames and the mips are built once they're all there
 		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+		TextureUploads::Queue(textureID, 0, width, height, format, data, TextureUploads::ImageBytes(width, height, format), true);
+		GLObjects::SetBytes(GLOBJECT_TEXTURE, textureID,
+			GLObjects::TextureBytes(format, width, height, 1, GLObjects::MipLevels(width, height)));
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
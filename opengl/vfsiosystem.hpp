@@ -0,0 +1,79 @@
+#ifndef vfsiosystem_HG_
+#define vfsiosystem_HG_
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <vfs/vfs.h>
+
+#include <cstring>
+#include <utility>
+
+// Read-only Assimp stream over a Vfs view, nothing is copied
+class VfsIOStream : public Assimp::IOStream
+{
+public:
+	explicit VfsIOStream(VfsFile file) : m_file(std::move(file)), m_position(0) {}
+
+	size_t Read(void* buffer, size_t size, size_t count) override
+	{
+		if (size == 0)
+			return 0;
+		size_t available = (m_file.Size() - m_position) / size;
+		if (count > available)
+			count = available;
+		memcpy(buffer, m_file.Data() + m_position, size * count);
+		m_position += size * count;
+		return count;
+	}
+
+	size_t Write(const void*, size_t, size_t) override { return 0; }
+
+	aiReturn Seek(size_t offset, aiOrigin origin) override
+	{
+		size_t position;
+		switch (origin)
+		{
+		case aiOrigin_SET: position = offset; break;
+		case aiOrigin_CUR: position = m_position + offset; break;
+		case aiOrigin_END: position = m_file.Size() - offset; break;
+		default: return aiReturn_FAILURE;
+		}
+		if (position > m_file.Size())
+			return aiReturn_FAILURE;
+		m_position = position;
+		return aiReturn_SUCCESS;
+	}
+
+	size_t Tell() const override { return m_position; }
+	size_t FileSize() const override { return m_file.Size(); }
+	void Flush() override {}
+
+private:
+	VfsFile m_file;
+	size_t m_position;
+};
+
+// Lets Assimp open a model and everything it references (.mtl files) through
+// the Vfs, so a packed model loads the same as a loose one
+class VfsIOSystem : public Assimp::IOSystem
+{
+public:
+	bool Exists(const char* file) const override { return Vfs::Exists(file); }
+	char getOsSeparator() const override { return '/'; }
+
+	Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+	{
+		// Packs are read-only
+		if (strchr(mode, 'w') || strchr(mode, 'a'))
+			return nullptr;
+		VfsFile view = Vfs::Open(file);
+		if (!view)
+			return nullptr;
+		return new VfsIOStream(std::move(view));
+	}
+
+	void Close(Assimp::IOStream* stream) override { delete stream; }
+};
+
+#endif
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Cooks images into DDS files with a full mip chain, block compressed by default.
+
+    cook_textures.py [--format auto|bc1|bc3|rgba] [--flip-y] <root> [<file or directory> ...]
+
+Every .png/.jpg/.tga/.bmp found is written next to itself as <name>.dds, which
+the loaders ask for before the source image (see include/dds/dds.h). Files whose
+.dds is newer than the image are skipped. Without a list the whole root is cooked.
+
+    auto    BC3 (DXT5) if the image has any transparency, BC1 (DXT1) otherwise
+    bc1     4 bits per texel, no alpha
+    bc3     8 bits per texel, interpolated alpha
+    rgba    32 bits per texel, mips only
+
+--flip-y stores rows bottom up, the way breakout loads its textures (stbi flips
+them on load), so breakout is cooked with:
+
+    cook_textures.py --flip-y breakout textures
+
+Decoding needs Pillow (pip install pillow).
+"""
+
+import argparse
+import multiprocessing
+import os
+import struct
+import sys
+
+try:
+    from PIL import Image
+except ImportError:
+    Image = None
+
+SOURCE_EXTENSIONS = (".png", ".jpg", ".jpeg", ".tga", ".bmp")
+
+# DDS_HEADER and DDS_PIXELFORMAT, see the DirectX "DDS File Layout" docs
+DDS_MAGIC = b"DDS "
+DDSD_CAPS = 0x1
+DDSD_HEIGHT = 0x2
+DDSD_WIDTH = 0x4
+DDSD_PITCH = 0x8
+DDSD_PIXELFORMAT = 0x1000
+DDSD_MIPMAPCOUNT = 0x20000
+DDSD_LINEARSIZE = 0x80000
+DDPF_ALPHAPIXELS = 0x1
+DDPF_FOURCC = 0x4
+DDPF_RGB = 0x40
+DDSCAPS_COMPLEX = 0x8
+DDSCAPS_TEXTURE = 0x1000
+DDSCAPS_MIPMAP = 0x400000
+
+
+# --- Mip chain --------------------------------------------------------------
+
+def mip_chain(image):
+    levels = [image]
+    while image.width > 1 or image.height > 1:
+        size = (max(1, image.width // 2), max(1, image.height // 2))
+        # Box filter each level from the one above, Pillow premultiplies RGBA while resizing
+        image = image.resize(size, Image.BOX)
+        levels.append(image)
+    return levels
+
+
+def pixels(image):
+    return image.tobytes(), image.width, image.height
+
+
+# --- Block compression ------------------------------------------------------
+
+def pack565(r, g, b):
+    return ((r * 31 + 127) // 255) << 11 | ((g * 63 + 127) // 255) << 5 | ((b * 31 + 127) // 255)
+
+
+def unpack565(c):
+    r = (c >> 11) & 31
+    g = (c >> 5) & 63
+    b = c & 31
+    return (r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2)
+
+
+def block_texels(data, width, height, bx, by):
+    """The 4x4 block at (bx, by) as 16 RGBA tuples, edges clamped for sizes that aren't a multiple of 4."""
+    texels = []
+    for y in range(4):
+        row = min(by * 4 + y, height - 1) * width
+        for x in range(4):
+            i = (row + min(bx * 4 + x, width - 1)) * 4
+            texels.append((data[i], data[i + 1], data[i + 2], data[i + 3]))
+    return texels
+
+
+def encode_color(texels):
+    """One 8 byte BC1 color block, always in four color mode so it is also valid inside BC3."""
+    # Endpoints from the bounding box, inset by 1/16 so noise at the corners doesn't stretch the palette
+    lo = [min(t[c] for t in texels) for c in range(3)]
+    hi = [max(t[c] for t in texels) for c in range(3)]
+    inset = [(hi[c] - lo[c]) >> 4 for c in range(3)]
+    c0 = pack565(*[min(255, hi[c] - inset[c]) for c in range(3)])
+    c1 = pack565(*[max(0, lo[c] + inset[c]) for c in range(3)])
+
+    # Diagonal of the box, flip channels that run the other way so the endpoints follow the colors
+    mean = [sum(t[c] for t in texels) / 16.0 for c in range(3)]
+    covariance = [sum((t[c] - mean[c]) * (t[1] - mean[1]) for t in texels) for c in range(3)]
+    if covariance[0] < 0 or covariance[2] < 0:
+        r0, g0, b0 = unpack565(c0)
+        r1, g1, b1 = unpack565(c1)
+        if covariance[0] < 0:
+            r0, r1 = r1, r0
+        if covariance[2] < 0:
+            b0, b1 = b1, b0
+        c0 = pack565(r0, g0, b0)
+        c1 = pack565(r1, g1, b1)
+
+    if c0 == c1:
+        return struct.pack("<HHI", c0, c1, 0)
+    swap = c0 < c1
+    if swap:
+        c0, c1 = c1, c0
+    e0 = unpack565(c0)
+    e1 = unpack565(c1)
+    palette = [
+        e0,
+        e1,
+        tuple((2 * e0[c] + e1[c]) // 3 for c in range(3)),
+        tuple((e0[c] + 2 * e1[c]) // 3 for c in range(3)),
+    ]
+    indices = 0
+    for i, t in enumerate(texels):
+        best = 0
+        best_distance = 1 << 30
+        for index, p in enumerate(palette):
+            dr = t[0] - p[0]
+            dg = t[1] - p[1]
+            db = t[2] - p[2]
+            distance = dr * dr + dg * dg + db * db
+            if distance < best_distance:
+                best = index
+                best_distance = distance
+        indices |= best << (2 * i)
+    return struct.pack("<HHI", c0, c1, indices)
+
+
+def encode_alpha(texels):
+    """One 8 byte BC3 alpha block using the eight value mode between the block's extremes."""
+    a0 = max(t[3] for t in texels)
+    a1 = min(t[3] for t in texels)
+    if a0 == a1:
+        return struct.pack("<BB6s", a0, a1, b"\0" * 6)
+    palette = [a0, a1] + [((7 - i) * a0 + i * a1) // 7 for i in range(1, 7)]
+    indices = 0
+    for i, t in enumerate(texels):
+        best = min(range(8), key=lambda index: abs(t[3] - palette[index]))
+        indices |= best << (3 * i)
+    return struct.pack("<BB", a0, a1) + indices.to_bytes(6, "little")
+
+
+def compress(data, width, height, alpha):
+    blocks = bytearray()
+    for by in range((height + 3) // 4):
+        for bx in range((width + 3) // 4):
+            texels = block_texels(data, width, height, bx, by)
+            if alpha:
+                blocks += encode_alpha(texels)
+            blocks += encode_color(texels)
+    return bytes(blocks)
+
+
+# --- DDS --------------------------------------------------------------------
+
+def dds_header(width, height, levels, fmt, top_size):
+    flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT
+    caps = DDSCAPS_TEXTURE | (DDSCAPS_COMPLEX | DDSCAPS_MIPMAP if levels > 1 else 0)
+    if fmt == "rgba":
+        flags |= DDSD_PITCH
+        pixel_format = struct.pack("<II4sIIIII", 32, DDPF_RGB | DDPF_ALPHAPIXELS, b"\0" * 4, 32,
+                                   0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000)
+        pitch = width * 4
+    else:
+        flags |= DDSD_LINEARSIZE
+        pixel_format = struct.pack("<II4sIIIII", 32, DDPF_FOURCC, b"DXT1" if fmt == "bc1" else b"DXT5", 0, 0, 0, 0, 0)
+        pitch = top_size
+    header = struct.pack("<IIIIIII", 124, flags, height, width, pitch, 0, levels)
+    header += b"\0" * 44  # dwReserved1[11]
+    header += pixel_format
+    header += struct.pack("<IIIII", caps, 0, 0, 0, 0)
+    return DDS_MAGIC + header
+
+
+def cook(job):
+    source, target, fmt, flip = job
+    image = Image.open(source)
+    image.load()
+    image = image.convert("RGBA")
+    if flip:
+        image = image.transpose(Image.FLIP_TOP_BOTTOM)
+    if fmt == "auto":
+        opaque = image.getchannel("A").getextrema()[0] == 255
+        fmt = "bc1" if opaque else "bc3"
+
+    payload = []
+    for level in mip_chain(image):
+        data, width, height = pixels(level)
+        payload.append(data if fmt == "rgba" else compress(data, width, height, fmt == "bc3"))
+
+    # Written beside the target and renamed, a half written .dds would be loaded over the image
+    temporary = target + ".tmp"
+    with open(temporary, "wb") as stream:
+        stream.write(dds_header(image.width, image.height, len(payload), fmt, len(payload[0])))
+        for level in payload:
+            stream.write(level)
+    os.replace(temporary, target)
+    return "%s: %dx%d %s, %d levels, %.1f KB" % (
+        target, image.width, image.height, fmt, len(payload), sum(len(level) for level in payload) / 1024.0)
+
+
+def collect(root, selections):
+    sources = []
+    for selection in selections or ["."]:
+        top = os.path.join(root, selection)
+        if os.path.isfile(top):
+            candidates = [top]
+        elif os.path.isdir(top):
+            candidates = [os.path.join(parent, name) for parent, _, names in os.walk(top) for name in names]
+        else:
+            print("ERROR::COOK: %s doesn't exist" % top)
+            sys.exit(1)
+        sources += [path for path in candidates if path.lower().endswith(SOURCE_EXTENSIONS)]
+    return sorted(set(sources))
+
+
+def main():
+    parser = argparse.ArgumentParser(usage=__doc__.strip().splitlines()[2].strip())
+    parser.add_argument("--format", choices=["auto", "bc1", "bc3", "rgba"], default="auto")
+    parser.add_argument("--flip-y", action="store_true")
+    parser.add_argument("root")
+    parser.add_argument("selections", nargs="*")
+    arguments = parser.parse_args()
+    if Image is None:
+        print("ERROR::COOK: Pillow is needed to decode images (pip install pillow)")
+        return 1
+
+    jobs = []
+    for source in collect(arguments.root, arguments.selections):
+        target = os.path.splitext(source)[0] + ".dds"
+        if os.path.exists(target) and os.path.getmtime(target) >= os.path.getmtime(source):
+            continue
+        jobs.append((source, target, arguments.format, arguments.flip_y))
+
+    # Compression is pure Python, spread the images over every core
+    with multiprocessing.Pool() as pool:
+        for line in pool.imap_unordered(cook, jobs):
+            print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
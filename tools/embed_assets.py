@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Writes a C++ file with the game's core assets embedded as byte arrays.
+
+    embed_assets.py <game directory> <output .cpp>
+
+Every file under the asset directories is embedded under its path relative
+to the game directory ("shaders/vert_text.glsl"), which is the path the
+loaders ask Assets::Find for. An image with a cooked .dds beside it (see
+cook_textures.py) is left out, the loader only falls back to it when there is
+no .dds. The output is only rewritten when it changes, so an unchanged build
+doesn't recompile it.
+"""
+
+import os
+import sys
+
+ASSET_DIRECTORIES = ["shaders", "levels", "fonts", "textures", "particles"]
+COOKED_EXTENSIONS = (".png", ".jpg", ".jpeg", ".tga", ".bmp")
+BYTES_PER_LINE = 24
+
+
+def collect(root):
+    assets = []
+    for directory in ASSET_DIRECTORIES:
+        top = os.path.join(root, directory)
+        for parent, _, files in os.walk(top):
+            for name in files:
+                path = os.path.join(parent, name)
+                stem, extension = os.path.splitext(name)
+                if extension.lower() in COOKED_EXTENSIONS and stem + ".dds" in files:
+                    continue
+                relative = os.path.relpath(path, root).replace(os.sep, "/")
+                assets.append((relative, path))
+    # Sorted so Assets::Find can binary search the table
+    assets.sort(key=lambda asset: asset[0].encode("utf-8"))
+    return assets
+
+
+def generate(assets):
+    lines = [
+        "// Generated by tools/embed_assets.py, do not edit",
+        '#include "assets.h"',
+        "",
+        "namespace",
+        "{",
+    ]
+    for index, (relative, path) in enumerate(assets):
+        with open(path, "rb") as asset:
+            data = asset.read()
+        lines.append("\t// %s" % relative)
+        # One byte past the end is a terminator, text assets can be used as C strings
+        lines.append("\tconstexpr unsigned char ASSET_%d[%d] = {" % (index, len(data) + 1))
+        for start in range(0, len(data), BYTES_PER_LINE):
+            chunk = data[start:start + BYTES_PER_LINE]
+            lines.append("\t\t" + ",".join(str(byte) for byte in chunk) + ",")
+        lines.append("\t\t0")
+        lines.append("\t};")
+    lines.append("}")
+    lines.append("")
+
+    lines.append("extern const EmbeddedAsset EMBEDDED_ASSETS[] =")
+    lines.append("{")
+    for index, (relative, path) in enumerate(assets):
+        lines.append('\t{ "%s", ASSET_%d, sizeof(ASSET_%d) - 1 },' % (relative, index, index))
+    if not assets:
+        lines.append("\t{ nullptr, nullptr, 0 },")
+    lines.append("};")
+    lines.append("extern const size_t EMBEDDED_ASSET_COUNT = %d;" % len(assets))
+    lines.append("")
+    return "\n".join(lines)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("Usage: embed_assets.py <game directory> <output .cpp>")
+        return 1
+    root, output = sys.argv[1], sys.argv[2]
+
+    source = generate(collect(root))
+    if os.path.exists(output):
+        with open(output, "r", newline="\n") as existing:
+            if existing.read() == source:
+                return 0
+    with open(output, "w", newline="\n") as generated:
+        generated.write(source)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
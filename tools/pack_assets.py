@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Packs files into one archive the Vfs can memory map (see include/vfs/vfs.h).
+
+    pack_assets.py <output.pak> <root directory> [<file or directory> ...]
+
+Entries are stored under their path relative to the root ("models/rock/rock.obj"),
+which is what Vfs::Open is asked for. Without a list the whole root is packed.
+"""
+
+import os
+import struct
+import sys
+
+PACK_MAGIC = b"PACK"
+PACK_VERSION = 1
+PACK_ALIGNMENT = 16
+HEADER = struct.Struct("<4sIIIQ")	# Magic, Version, EntryCount, Reserved, TocOffset
+ENTRY = struct.Struct("<QQII")		# Offset, Size, PathOffset, PathLength
+
+
+def collect(root, selections, output):
+    files = {}
+    for selection in selections or ["."]:
+        top = os.path.join(root, selection)
+        if os.path.isfile(top):
+            candidates = [top]
+        elif os.path.isdir(top):
+            candidates = [os.path.join(parent, name) for parent, _, names in os.walk(top) for name in names]
+        else:
+            print("ERROR::PACK: %s doesn't exist" % top)
+            sys.exit(1)
+        for path in candidates:
+            if os.path.abspath(path) == os.path.abspath(output):
+                continue
+            relative = os.path.normpath(os.path.relpath(path, root)).replace(os.sep, "/")
+            files[relative.encode("utf-8")] = path
+    # Sorted by the raw bytes, Vfs binary searches with memcmp
+    return sorted(files.items())
+
+
+def pad(stream, alignment):
+    remainder = stream.tell() % alignment
+    if remainder:
+        stream.write(b"\0" * (alignment - remainder))
+
+
+def write_pack(output, files):
+    entries = []
+    paths = bytearray()
+    with open(output, "wb") as pack:
+        pack.write(b"\0" * HEADER.size)
+        for relative, path in files:
+            pad(pack, PACK_ALIGNMENT)
+            offset = pack.tell()
+            with open(path, "rb") as source:
+                data = source.read()
+            pack.write(data)
+            entries.append(ENTRY.pack(offset, len(data), len(paths), len(relative)))
+            paths += relative
+
+        pad(pack, PACK_ALIGNMENT)
+        toc_offset = pack.tell()
+        for entry in entries:
+            pack.write(entry)
+        pack.write(bytes(paths))
+
+        pack.seek(0)
+        pack.write(HEADER.pack(PACK_MAGIC, PACK_VERSION, len(entries), 0, toc_offset))
+    return toc_offset
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__.strip())
+        return 1
+    output, root, selections = sys.argv[1], sys.argv[2], sys.argv[3:]
+
+    files = collect(root, selections, output)
+    data_bytes = write_pack(output, files)
+    print("%s: %d files, %.1f KB" % (output, len(files), data_bytes / 1024.0))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())